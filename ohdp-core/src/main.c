@@ -37,10 +37,17 @@
 	#include <fcntl.h>
 	#include <io.h>
 	#include <float.h>
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+	#include <intrin.h>
 
 	#define ALIGN1 __declspec(align(1))
 	#define ALIGN16 __declspec(align(16))
 	#define ALIGN32 __declspec(align(32))
+	#define DP_THREADLOCAL __declspec(thread)
+	#define DP_ATOMIC_FETCHADD( _p, _v ) InterlockedExchangeAdd( (volatile LONG*)(_p), (LONG)(_v) )
+	#define DP_TARGET_SSE2
+	#define DP_TARGET_AVX2
 
 	#define dup2 _dup2
 	#define dup _dup
@@ -105,10 +112,16 @@
 	#endif
 #else
 	#include <unistd.h>
+	#include <pthread.h>
+	#include <time.h>
 
 	#define ALIGN1 __attribute__((aligned(1)))
 	#define ALIGN16 __attribute__((aligned(16)))
 	#define ALIGN32 __attribute__((aligned(32)))
+	#define DP_THREADLOCAL __thread
+	#define DP_ATOMIC_FETCHADD( _p, _v ) __sync_fetch_and_add( (_p), (_v) )
+	#define DP_TARGET_SSE2 __attribute__((target("sse2")))
+	#define DP_TARGET_AVX2 __attribute__((target("avx2")))
 
 	#ifndef _DEBUG
 		#define DP_INLINE  inline static
@@ -135,7 +148,7 @@
 
 /**********************************************/
 
-static UINT32 s_uException = 0;
+static DP_THREADLOCAL UINT32 s_uException = 0;
 EXTERNC void ex_clear() { s_uException = 0; }
 EXTERNC void ex_set() { s_uException = 1; }
 EXTERNC UINT32 ex_didFail() { return s_uException; }
@@ -158,7 +171,7 @@ EXTERNC UINT32 ex_didFail() { return s_uException; }
 
 //#define ENABLE_OUTOFLINE_NUMERICAL_CLEANUP
 #define ENABLE_INLINE_NUMERICAL_CLEANUP
-//#define ENABLE_SPECIFIED_MINMAX_STATE // buggy, don't enable yet
+#define ENABLE_SPECIFIED_MINMAX_STATE // solve only the plant loads between min and max, see dp_resize_band
 #define ENABLE_PRIORITIZEDSTAGES
 #define ENABLE_FORWARDPASS_PRIORITY_ORDER_SCAN // provides improvement?
 #define ENABLE_NONMAPPABLEELEMENTS
@@ -166,31 +179,68 @@ EXTERNC UINT32 ex_didFail() { return s_uException; }
 #define ENABLE_NEWHEADSCALING
 #define ENABLE_SYMMETRIC_FINDLARGER
 #define ENABLE_MALLOC_CACHE
+#define ENABLE_HK_CACHE // reuse a unit's HK table rows when nothing it depends on changed
+#define ENABLE_CONCAVE_MERGE // experimental, merge two concave unit tables by bisection in the merge engines, see dp_merge_leaf_concave
+#define ENABLE_BACKPASS_RESUME // resume the backpass below the units that did not change, needs ENABLE_HK_CACHE
+#define ENABLE_BACKPASS_BOUND // stop a backpass row once no decision left in it can win, see dp_backpass_bound
 #define ENABLE_NEW_CALCS
 #define ENABLE_NEW_DYNLOSS
 #define ENABLE_ADAPTIVEFAILURE
 #define ENABLE_HK_SCALING // changes solution, but don't disable yet
+#define ENABLE_THREADPOOL
+#define ENABLE_SIMD // x86 only, see below
 
 //#define DEBUG_BACKWARDPASS
 //#define DEBUG_FORWARDPASS
 //#define DEBUG_INITPASS
 //#define DEBUG_MEMORY
+//#define DEBUG_POISON
 //#define DEBUG_RELATION_FINDLARGER_SIDEDNESS
 
+#if defined(ENABLE_SIMD) && !( defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__) )
+	#undef ENABLE_SIMD
+#endif
+#ifdef ENABLE_SIMD
+	#include <emmintrin.h>
+	#include <immintrin.h>
+#endif
+
 /**********************************************/
 /* constants */
 
-/* I'll tell you why this is not safe to change: the dp
- * assumes memory is clear and zero when computing the
- * solution. The solution computing process only writes
- * non-zero solutions to memory, leaving untouched memory
- * left as 'no solution' ie 0.
+/* the parse and cache buffers are handed out cleared. the solver
+ * workspace is not: dp() writes every cell it reads, including the
+ * 'no solution' zeros it used to get from cleared memory. build with
+ * DEBUG_POISON to fill the workspace with DP_POISON_BYTE on every
+ * solve and check that nothing stale leaks into the solution.
  */
 #define DP_MALLOC_BYTE 0x00
+#define DP_POISON_BYTE 0x7F /* floats 3.4e38, UINT16 32639, UINT8 127 */
 
 #define DP_OPTIMIZE_FOR_POWER (1)
 #define DP_OPTIMIZE_FOR_FLOW  (2)
 
+#define DP_SIMD_NONE (0) /* scalar reference kernels */
+#define DP_SIMD_SSE2 (1)
+#define DP_SIMD_AVX2 (2)
+
+#define DP_FORWARDPASS_GREEDY (0) /* rescan the unmarked stages for each remaining allocation */
+#define DP_FORWARDPASS_WALK (1) /* follow the backpass decisions, one stage at a time */
+
+#define DP_ENGINE_BACKPASS (0) /* prioritized stages, one stage at a time */
+#define DP_ENGINE_GROUPED (1) /* identical units merged into one table each, see dp_merge_plan_grouped */
+#define DP_ENGINE_TREE (2) /* stages merged pairwise, see dp_merge_plan_tree */
+
+#define DP_REFINE_BAND (1) /* coarse steps either side of the coarse decision, see dp_backpass_band */
+#define DP_BOUND_CHUNK (32) /* local decisions per vector kernel call between bound checks */
+#define DP_BANDED( _pDP ) ( (_pDP)->uRefineStates || (_pDP)->uPrune )
+#define DP_REFINE_COARSE( _pDP ) ( (_pDP)->uRefineFactor > 1 && !(_pDP)->uRefineStates && (_pDP)->uEngine == DP_ENGINE_BACKPASS )
+
+/* unit operating conditions found while building the HK table, see dp_report_conditions */
+#define DP_CONDITION_DISCH_EXCEEDS_MAX	(1<<0)
+#define DP_CONDITION_EFF_BELOW_TOL		(1<<1)
+#define DP_CONDITION_POW_EXCEEDS_MAX	(1<<2)
+
 #define DP_WEIGHT_RELATIVE		(1<<30)
 #define DP_WEIGHT_CODEMASK		((1<<16) - 1)
 #define DP_WEIGHT_DEFAULT		(0)
@@ -228,24 +278,12 @@ CHAR* gsImperialUnits[] = { "ft", "cfs", "kcfs", 0 };
 CHAR* gsMetricUnits[] = { "m", "cms", 0 };
 CHAR* gszHuh = " ? ";
 
-UINT32 guMWMode = 0; /* 0 or 1 switches between kw/cfs and mw/kcfs */
-UINT32 guUnitMode = DP_UNITS_UNDEFINED;
-
-EXTERNC FLOAT gfConvFactor = DP_CONV_UNDEFINED;
-EXTERNC FLOAT gfPlantLossCoef = 0.0; /* % power production loss from hydraulic, generator and transmission systems to the calib*/
-EXTERNC FLOAT gfCoordinationFactorA = 0.95; /* sets % of capacity @ optimum to be leftover for later stages in the backpass */
-EXTERNC FLOAT gfCoordinationFactorB = 0.6; /* sets minimum operation as a % of max capacity during backpass */
-
 /**********************************************/
 
-UINT32 guDebugMode = 0;
-UINT32 guMALLOC = 0;
-UINT32 guMemCacheOn = 0;
-
 /**********************************************/
 
 #define DP_MAX_PRINTBUF_CHARS 512
-CHAR gcPrintBuff[ DP_MAX_PRINTBUF_CHARS + 1 ];
+DP_THREADLOCAL CHAR gcPrintBuff[ DP_MAX_PRINTBUF_CHARS + 1 ];
 
 /**********************************************/
 
@@ -272,7 +310,219 @@ DP_INLINE float modff_ddkhack( float a, float* pb )
 
 /**********************************************/
 
-void* dp_mem_alloc( int _n, char* _f, int _l)
+/* all state of one plant model and its solver workspace. */
+/* separate contexts may be solved concurrently from separate threads. */
+
+typedef struct tagStageRank
+{
+	FLOAT fMetric;
+	UINT16 u16Stage;
+} StageRank;
+
+/* one table of a merge plan. a leaf is an HK row, the others combine two tables */
+typedef struct tagDPMergeNode
+{
+	UINT16 u16Left, u16Right; /* child nodes, MAX_UINT16 for a leaf */
+	UINT16 u16Row; /* leaf only */
+	UINT16 u16Units; /* leaves below, counting repeats */
+	UINT16 u16MaxState; /* largest allocation the node can take */
+	UINT16 u16Concave; /* both children are concave leaves, see dp_merge_leaf_concave */
+} DPMergeNode;
+
+/* an engine plan never needs more than a leaf and two merges per unit, an outage scan three */
+#define DP_MERGE_NODES( _pDP ) ( (_pDP)->uOutageScan ? 4 * (_pDP)->uStages : ( (_pDP)->uEngine == DP_ENGINE_BACKPASS ? 0 : 3 * (_pDP)->uStages ) )
+
+typedef struct tagDPContext
+{
+	UINT32 uMWMode; /* 0 or 1 switches between kw/cfs and mw/kcfs */
+	UINT32 uUnitMode;
+	FLOAT fConvFactor;
+	FLOAT fPlantLossCoef; /* % power production loss from hydraulic, generator and transmission systems to the calib*/
+	FLOAT fCoordinationFactorA; /* sets % of capacity @ optimum to be leftover for later stages in the backpass */
+	FLOAT fCoordinationFactorB; /* sets minimum operation as a % of max capacity during backpass */
+
+	UINT32 uMALLOC; /* bytes allocated for the solver workspace */
+	UINT32 uParseMALLOC; /* bytes allocated by DP_MALLOC, the parser blocks */
+	UINT32 uDebugMode; /* set by the debug command or -D */
+	UINT32 uMemCacheOn;
+
+	/* the solver workspace. every dp_malloc array is carved out of this one block */
+	void* pArenaBlock; /* as returned by malloc */
+	UINT8* pArena; /* pArenaBlock rounded up to DP_ARENA_ALIGN */
+	UINT32 uArenaSize; /* bytes available at pArena */
+
+	/* what each unit's HK table rows in the arena were built from, see dp_hk_cache_lookup */
+	struct tagHKTableEntry* pHKEntries; /* [ rows ] */
+	UINT32 uHKEntries;
+	FLOAT* pfHKRows; /* pfHKTableValues when the entries were stored, 0 when none are valid */
+	UINT32 uHKCacheRows;
+	UINT32 uHKHits; /* rows the last solve reused */
+
+	/* what the backpass rows in the arena were solved for, see dp_backpass_resume_count */
+	FLOAT* pfResumeRows; /* pfGlobalDecisionValues when the record was stored, 0 when none is valid */
+	UINT32 uResumeStates;
+	UINT32 uResumeStages;
+	UINT32 uResumeActiveStages;
+	FLOAT fResumeCoordinationFactorA;
+	FLOAT fResumeCoordinationFactorB;
+	UINT32 uResumePrune;
+	UINT32 uResumedStages; /* positions the last solve did not recompute */
+
+	UINT32 uThreads; /* worker count for the par loops. 0 or 1 is serial */
+	struct tagDPThreadPool* pPool;
+	UINT32 uSimd; /* DP_SIMD_* kernels in use, never more than the cpu supports */
+	UINT32 uForwardpass; /* DP_FORWARDPASS_* reconstruction */
+	UINT32 uEngine; /* DP_ENGINE_* */
+	UINT32 uOutageScan; /* also build pfOutageHK and pfOutageSolution, see dp_outage_scan */
+	UINT32 uRefineFactor; /* fine steps per coarse step of a refined solve, 0 or 1 is none */
+	UINT32 uPrune; /* above its maximum a unit only tries its near-optimum to maximum range */
+	FLOAT fBandCells; /* backpass cells the last banded solve tried */
+	FLOAT fFullCells; /* and would have tried without the band */
+	FLOAT fBoundSkipped; /* backpass cells the last solve skipped on their bound */
+	FLOAT fBoundCells; /* of the cells in the rows that were bounded */
+
+	/* the coarse solve a refined backpass searches around, see dp_backpass_band */
+	UINT16* pu16RefineMap; /* [ stages, refine states ] pu16GlobalDecisionStateMap of the coarse solve, then its pu16StageMap */
+	UINT32 uRefineEntries; /* allocated */
+	UINT32 uRefineStates; /* states of the coarse solve, 0 until there is one */
+	FLOAT fRefineDelta; /* fSolutionDelta of the coarse solve */
+
+	UINT32 uBudgetMB; /* workspace limit for dp_resize, 0 is none */
+	UINT32 uBudgetMs; /* predicted solve time limit for dp_resize, 0 is none */
+	FLOAT fCellNs; /* backpass cost per decision cell, measured by the last solve */
+
+	UINT32 uBuiltinCurves;
+	UINT32 uCurves;
+	struct tagCurveDef* pCurves;
+	UINT32 uTurbs;
+	struct tagTurbineDef* pTurbs;
+
+	UINT32 uWeightCode;
+	UINT32 uSolveMode; /* which problem are we solving? */
+	FLOAT fHeadCurr;
+
+	UINT32 uUserStepCount; /* number of objective function discretizations */
+	UINT32 uProblemStepCount; /* adjusted number of objective function discretizations */
+
+	FLOAT fSolutionDelta; /* determined from uProblemStepCount and the sizes of the units */
+	FLOAT fOtherSolutionDelta;
+
+	UINT32 uStages; /* simply, number of units */
+	UINT32 uActiveStages; /* units with a weight, the first ones in gpu16StageMap */
+	UINT32 uStates; /* number of solution discretizations */
+
+	FLOAT fStateMin, fStateMax; /* the band of plant loads to solve, 0 leaves that end open */
+	UINT32 uStateLo; /* first state of the band, the states below it are not reported */
+
+	/* a cache of the objective function values for each stage and statestep. identical
+	 * units share a row, index a stage's row with DP_HK_ROW */
+	UINT32 uHKRows; /* distinct units, see dp_assign_rows */
+	UINT16* pu16HKRowStages; /* [ rows ] first stage using each row */
+	FLOAT* pfFlowAllocations; /* [ rows, steps ] */
+	FLOAT* pfPowerAllocations; /* [ rows, steps ] */
+	FLOAT* pfHKTableValues; /* [ rows, steps ] */
+	UINT8* pu8Conditions; /* [ rows, steps ] DP_CONDITION_ bits */
+
+	/* a matrix that accumulates the allocation decisions. reevaluated for each scenario until the global decision matrix is filled */
+	/* only allocated for DEBUG_BACKWARDPASS, the backpass reduces each row as it goes */
+	FLOAT* pfScenarioDecisionValues; /* [ states, states ] but actually triangular */ /* THE BIG KAHUNA */
+	UINT16* pu16ScenarioDecisionStates;
+	UINT8* pu8ScenarioDecisionCounts;
+
+	/* these are the accumulated value of particular state decisions made in the current stage */
+	UINT16* pu16StateOfMax; /* [ states ] but also known as [ scenario ] */
+	UINT16* pu16HandedOfMax; /* [ states ] but also known as [ scenario ] */
+	FLOAT* pfValueOfMax; /* [ states ] but also known as [ scenario ] */
+	UINT8* pu8CountOfMax; /* [ states ] but also known as [ scenario ] */
+
+	FLOAT* pfSolutionAllocations; /* [ states ] */
+	FLOAT* pfOtherSolutionAllocations; /* [ states ] */
+	FLOAT* pfHKSolutionAverages; /* [ states ] */
+
+	/* the final decision matrices holding the allocations */
+	FLOAT* pfGlobalDecisionValues; /* [ stages, states ] */
+	UINT8* pu8GlobalDecisionCounts; /* [ stages, states ] */
+	UINT16* pu16GlobalDecisionStateMap; /* [ stages, states ] */
+	UINT16* pu16GlobalDecisionHandedMap; /* [ stages, states ] the state handed to the next stage in priority order */
+	FLOAT* pfGlobalDecisionAllocations; /* [ stages, states ] */
+
+	/* state-major copies of the decision matrices for the forwardpass scan,
+	 * the values are stored already divided by their counts */
+	FLOAT* pfForwardDecisionAverages; /* [ states, stages ] */
+	UINT16* pu16ForwardDecisionStateMap; /* [ states, stages ] */
+
+	UINT16* pu16Solution; /* [ stages, states ] */
+	FLOAT* pfSolution; /* [ stages, states ] */
+	FLOAT* pfOtherSolution; /* [ stages, states ] */
+	FLOAT* pfHKSolution; /* [ stages, states ] */
+
+	UINT16* pu16LocalNearOptimumStates; /* [ stages ] */
+	UINT16* pu16LocalMaximumStates; /* [ stages ] */
+	UINT16* pu16LocalOptimumStates; /* [ stages ] */
+	UINT8* pu8StageChecklist; /* [ stages ] */
+	UINT8* pu8StageChecklistCopy; /* [ threads, stages ] one padded copy per thread */
+	UINT16* pu16WalkPassedStages; /* [ threads, stages ] the stages the walk forwardpass passed over, one padded list per thread */
+
+	UINT16* pu16LocalDecisions; /* [ states ] */
+	StageRank* pStageRanks; /* [ stages ] */
+
+	/* backpass operands laid out for the vector kernels, rebuilt each stage */
+	FLOAT* pfLocalValues; /* [ states ] value of each state's local decision */
+	FLOAT* pfLocalCounts; /* [ states ] 1 where the local decision is not zero */
+	FLOAT* pfReversedValues; /* [ states ] previous stage's decision values, back to front */
+	FLOAT* pfReversedCounts; /* [ states ] previous stage's decision counts, back to front */
+
+	/* tables of the merge engines, see dp_merge_solve. the root is the last node */
+	UINT32 uNodes; /* in the current plan */
+	UINT32 uConcaveMerges; /* merges of the last run that bisected instead of scanning */
+	DPMergeNode* pNodes; /* [ nodes ] */
+	FLOAT* pfNodeValues; /* [ nodes, states ] summed HK of the best allocation */
+	UINT8* pu8NodeCounts; /* [ nodes, states ] units running in it */
+	UINT16* pu16NodeSplits; /* [ nodes, states ] what the left child takes */
+	UINT16* pu16PlanStages; /* [ stages ] the stage of each leaf visit, in visiting order */
+	FLOAT* pfOutageHK; /* [ stages, states ] plant HK with each unit taken out */
+	FLOAT* pfOutageSolution; /* [ stages, stages, states ] the solution with each unit taken out, in solvemode units */
+	UINT16* pu16StageMap; /* [ stages ] active stages in priority order, then the rest */
+	UINT16* pu16ResumeStageMap; /* [ stages ] pu16StageMap of the last backpass */
+	UINT16* pu16ResumeRows; /* [ stages ] the HK row of each stage in the last backpass */
+	UINT16* pu16BandLo; /* [ states ] lowest local decision a refined backpass tries */
+	UINT16* pu16BandHi; /* [ states ] highest */
+
+	/* see dp_backpass_bound, rebuilt each stage */
+	FLOAT* pfBoundLocal; /* [ states ] best local HK from each decision up to the unit maximum */
+	FLOAT* pfBoundGlobal; /* [ states ] best higher-stage average at or below each state */
+	UINT16* pu16BoundSkips; /* [ states ] cells each row skipped */
+
+	/* [0] == total of faceplate capacities, head-adjusted and adjusted for overcapacity */
+	/* [1] == total of faceplate capacities and adjusted for overcapacity */
+	/* [2] == total of faceplate capacities */
+	FLOAT fTotalPower[ 3 ], fTotalFlow[ 3 ]; /* max plant power output */
+
+	/* [0] == faceplate capacity, head-adjusted and adjusted for overcapacity */
+	/* [1] == faceplate capacities, adjusted for overcapacity */
+	/* [2] == faceplate capacities */
+	FLOAT fMaxPower[ 3 ], fMaxFlow[ 3 ]; /* max plant discharge */
+	FLOAT fMinMaxPower[ 3 ], fMinMaxFlow[ 3 ]; /* largest output of the smallest unit */
+
+	/* operating point regression */
+	UINT32 uOPoints;
+	UINT32 uOPRegressions; /* mod 2 */
+	FLOAT fOPDependent[ 2 ];
+	FLOAT* pfOPCapacity; /* [ opoints ] */
+	FLOAT* pfOPValue; /* [ opoints, 2 ] */
+	FLOAT* pfOPCoefM; /* [ opoints ] */
+	FLOAT* pfOPCoefB; /* [ opoints ] */
+
+	/* unit dispatch */
+	FLOAT fDispatch;
+	FLOAT* pfUDSolution; /* [ stages ] */
+	FLOAT* pfUDOtherSolution; /* [ stages ] */
+	FLOAT* pfUDHKSolution; /* [ stages ] */
+} DPContext;
+
+/**********************************************/
+
+void* dp_mem_alloc( DPContext* pDP, int _n, char* _f, int _l)
 {
 	void* _p = ( _n <= 0 ) ? 0 : (void*)malloc( _n );
 	assert( _p );
@@ -283,7 +533,7 @@ void* dp_mem_alloc( int _n, char* _f, int _l)
 		exit(-1);
 	}
 	memset( _p, DP_MALLOC_BYTE, _n );
-	guMALLOC += _n;
+	pDP->uParseMALLOC += _n;
 	return _p;
 }
 
@@ -297,30 +547,30 @@ void dp_mem_free( void* _p )
 }
 
 #define DP_FREE( _p ) do{ if( _p ) { dp_mem_free( _p ); _p = 0; } }while(0)
-#define DP_MALLOC( _p, _t, _n, _f, _l ) do{ assert( !_p ); if( _p ) { free( _p ); } _p = (_t*)dp_mem_alloc( sizeof(_t) * _n, _f, _l ); }while(0)
+#define DP_MALLOC( _p, _t, _n, _f, _l ) do{ assert( !_p ); if( _p ) { free( _p ); } _p = (_t*)dp_mem_alloc( pDP, sizeof(_t) * _n, _f, _l ); }while(0)
 
 /**********************************************/
 
 #define DP_CACHE_ADDR_INFO( _pData ) ((int*)(   ((int*)_pData)-1   ))
 #define DP_CACHE_ADDR_DATA( _pInfo ) ((void*)(   ((int*)_pInfo)+1   ))
 
-void* dp_cache_alloc( void* _pData, int _n, char* _f, int _l)
+void* dp_cache_alloc( DPContext* pDP, void* _pData, int _n, char* _f, int _l)
 {
 	int* _pInfo = _pData ? DP_CACHE_ADDR_INFO( _pData ) : 0;
 	assert( _n > 0 );
 	if( _pData )
 	{
-		if( guMemCacheOn && ( *_pInfo >= _n ) ) /* == or >= ? */
+		if( pDP->uMemCacheOn && ( *_pInfo >= _n ) ) /* == or >= ? */
 		{
 			goto clearandreturn;
 		}
 		_pInfo = DP_CACHE_ADDR_INFO( _pData );
 		free( _pInfo );
-		guMALLOC -= _n + sizeof(int);
+		pDP->uMALLOC -= _n + sizeof(int);
 	}
 	_pInfo = (int*)malloc( _n + sizeof(int) ); assert( _pInfo );
 	_pData = DP_CACHE_ADDR_DATA( _pInfo );
-	guMALLOC += _n + sizeof(int);
+	pDP->uMALLOC += _n + sizeof(int);
 	*_pInfo = _n;
 #ifdef DEBUG_MEMORY
 	sprintf( gcPrintBuff, "memory: allocation of %d at %X\n", _n, _pData );
@@ -331,7 +581,7 @@ clearandreturn:
 	return _pData;
 }
 
-void* dp_cache_free( void* _pData )
+void* dp_cache_free( DPContext* pDP, void* _pData )
 {
 	if( !_pData ) { return 0; }
 
@@ -339,8 +589,7 @@ void* dp_cache_free( void* _pData )
 		int* _pInfo = DP_CACHE_ADDR_INFO( _pData );
 		int _n = *_pInfo;
 
-		memset( _pData, DP_MALLOC_BYTE, _n );
-		if( guMemCacheOn ) { return _pData; }
+		if( pDP->uMemCacheOn ) { return _pData; } /* cleared again when it is handed out */
 
 #ifdef DEBUG_MEMORY
 		sprintf( gcPrintBuff, "memory: deallocation at %X\n", _pData );
@@ -348,30 +597,398 @@ void* dp_cache_free( void* _pData )
 #endif //DEBUG_MEMORY
 
 		free( _pInfo );
-		guMALLOC -= _n + sizeof(int);
+		pDP->uMALLOC -= _n + sizeof(int);
 		return 0;
 	}
 }
 
 #ifdef ENABLE_MALLOC_CACHE
-	#define DP_FREE_CACHE( _p, _t ) do{ _p = (_t*)dp_cache_free( _p ); }while(0)
-	#define DP_MALLOC_CACHE( _p, _t, _n, _f, _l ) do{ _p = (_t*)dp_cache_alloc( _p, sizeof(_t) * _n, _f, _l ); }while(0)
+	#define DP_FREE_CACHE( _p, _t ) do{ _p = (_t*)dp_cache_free( pDP, _p ); }while(0)
+	#define DP_MALLOC_CACHE( _p, _t, _n, _f, _l ) do{ _p = (_t*)dp_cache_alloc( pDP, _p, sizeof(_t) * _n, _f, _l ); }while(0)
 #else
 	#define DP_FREE_CACHE DP_FREE
 	#define DP_MALLOC_CACHE DP_MALLOC
 #endif
 
+/**********************************************/
+
+#define DP_ARENA_ALIGN 64 /* a cache line, and enough for any of the simd loads */
+#define DP_ARENA_ROUND( _n ) ( ( (UINT32)(_n) + DP_ARENA_ALIGN - 1 ) & ~(UINT32)( DP_ARENA_ALIGN - 1 ) )
+
+/* grows the arena to hold uSize bytes. it never shrinks, so a session only
+ * pays for the allocation when the problem gets bigger. */
+void dp_arena_reserve( DPContext* pDP, UINT32 uSize, char* _f, int _l )
+{
+	if( pDP->pArenaBlock && pDP->uArenaSize >= uSize ) { return; }
+
+	pDP->pfHKRows = 0; /* the cached rows go with the block */
+	pDP->pfResumeRows = 0;
+	free( pDP->pArenaBlock );
+	pDP->pArenaBlock = malloc( uSize + DP_ARENA_ALIGN - 1 ); assert( pDP->pArenaBlock );
+	if( !pDP->pArenaBlock )
+	{
+		sprintf( gcPrintBuff, "%s:%d (" VERSIONED_NAME  ") malloc failure.\n", _f, _l );
+		PRINT_STDERR( gcPrintBuff );
+		exit(-1);
+	}
+	pDP->pArena = (UINT8*)( ( (size_t)pDP->pArenaBlock + DP_ARENA_ALIGN - 1 ) & ~(size_t)( DP_ARENA_ALIGN - 1 ) );
+	pDP->uArenaSize = uSize;
+#ifdef DEBUG_MEMORY
+	sprintf( gcPrintBuff, "memory: arena of %lu at %X\n", uSize, pDP->pArena );
+	PRINT_STDERR( gcPrintBuff );
+#endif //DEBUG_MEMORY
+}
+
+void dp_arena_free( DPContext* pDP )
+{
+	pDP->pfHKRows = 0;
+	pDP->pfResumeRows = 0;
+	free( pDP->pArenaBlock );
+	pDP->pArenaBlock = 0;
+	pDP->pArena = 0;
+	pDP->uArenaSize = 0;
+}
+
+/*********************************************/
+
+/* a pool of worker threads for the par loops. the calling thread
+ * takes part in every job, so a pool for n threads starts n-1 workers.
+ * rows are handed out in blocks through an atomic counter and every
+ * row is written by exactly one thread, so results do not depend on
+ * the scheduling. */
+
+#define DP_MAX_THREADS 64
+#define DP_THREAD_GRAIN 8
+#define DP_CHECKLIST_STRIDE( _n ) ( ( (_n) + 63 ) & ~63 ) /* keep per-thread scratch on separate cache lines */
+
+/* uThread is 0 for the calling thread and 1..n-1 for the workers, for per-thread scratch */
+typedef void fnParallelJob( DPContext* pDP, void* pJob, UINT32 uThread, UINT32 uBegin, UINT32 uEnd );
+
+typedef struct tagDPWorker
+{
+	struct tagDPThreadPool* pPool;
+	UINT32 uThread;
+} DPWorker;
+
+typedef struct tagDPThreadPool
+{
+	DPContext* pDP;
+	UINT32 uWorkers;
+	fnParallelJob* pfnJob;
+	void* pJob;
+	UINT32 uFirst;
+	UINT32 uCount;
+	volatile INT32 iTaken; /* rows handed out so far */
+	volatile UINT32 uQuit;
+	DPWorker workers[ DP_MAX_THREADS ];
+#ifdef _WIN32
+	HANDLE hThreads[ DP_MAX_THREADS ];
+	HANDLE hStart[ DP_MAX_THREADS ];
+	HANDLE hDone[ DP_MAX_THREADS ];
+#else
+	pthread_t hThreads[ DP_MAX_THREADS ];
+	pthread_mutex_t mutex;
+	pthread_cond_t condStart;
+	pthread_cond_t condDone;
+	UINT32 uGeneration;
+	UINT32 uBusy;
+#endif
+} DPThreadPool;
+
+void dp_pool_drain( DPThreadPool* pPool, UINT32 uThread )
+{
+	while( 1 )
+	{
+		/* row cost grows with the row index, so hand out the heaviest rows first */
+		UINT32 uTaken = (UINT32)DP_ATOMIC_FETCHADD( &(pPool->iTaken), DP_THREAD_GRAIN );
+		UINT32 uEnd, uBegin;
+		if( uTaken >= pPool->uCount ) { break; }
+		uEnd = pPool->uCount - uTaken;
+		uBegin = ( uEnd > DP_THREAD_GRAIN ) ? uEnd - DP_THREAD_GRAIN : 0;
+		(*pPool->pfnJob)( pPool->pDP, pPool->pJob, uThread, pPool->uFirst + uBegin, pPool->uFirst + uEnd );
+	}
+}
+
+#ifdef ENABLE_THREADPOOL
+
+#ifdef _WIN32
+
+DWORD WINAPI dp_pool_worker( LPVOID pArg )
+{
+	DPWorker* pWorker = (DPWorker*)pArg;
+	DPThreadPool* pPool = pWorker->pPool;
+	UINT32 uWorker = pWorker->uThread - 1;
+	while( 1 )
+	{
+		WaitForSingleObject( pPool->hStart[ uWorker ], INFINITE );
+		if( pPool->uQuit ) { break; }
+		dp_pool_drain( pPool, pWorker->uThread );
+		SetEvent( pPool->hDone[ uWorker ] );
+	}
+	return 0;
+}
+
+#else
+
+void* dp_pool_worker( void* pArg )
+{
+	DPWorker* pWorker = (DPWorker*)pArg;
+	DPThreadPool* pPool = pWorker->pPool;
+	UINT32 uGeneration = 0;
+	while( 1 )
+	{
+		UINT32 uQuit;
+		pthread_mutex_lock( &(pPool->mutex) );
+		while( pPool->uGeneration == uGeneration && !pPool->uQuit ) { pthread_cond_wait( &(pPool->condStart), &(pPool->mutex) ); }
+		uGeneration = pPool->uGeneration;
+		uQuit = pPool->uQuit;
+		pthread_mutex_unlock( &(pPool->mutex) );
+		if( uQuit ) { break; }
+
+		dp_pool_drain( pPool, pWorker->uThread );
+
+		pthread_mutex_lock( &(pPool->mutex) );
+		if( --pPool->uBusy == 0 ) { pthread_cond_signal( &(pPool->condDone) ); }
+		pthread_mutex_unlock( &(pPool->mutex) );
+	}
+	return 0;
+}
+
+#endif
+
+void dp_pool_destroy( DPContext* pDP )
+{
+	DPThreadPool* pPool = pDP->pPool;
+	UINT32 u;
+	if( !pPool ) { return; }
+
+	pPool->uQuit = 1;
+#ifdef _WIN32
+	for( u = 0; u < pPool->uWorkers; u++ ) { SetEvent( pPool->hStart[ u ] ); }
+	WaitForMultipleObjects( pPool->uWorkers, pPool->hThreads, TRUE, INFINITE );
+	for( u = 0; u < pPool->uWorkers; u++ )
+	{
+		CloseHandle( pPool->hThreads[ u ] );
+		CloseHandle( pPool->hStart[ u ] );
+		CloseHandle( pPool->hDone[ u ] );
+	}
+#else
+	pthread_mutex_lock( &(pPool->mutex) );
+	pthread_cond_broadcast( &(pPool->condStart) );
+	pthread_mutex_unlock( &(pPool->mutex) );
+	for( u = 0; u < pPool->uWorkers; u++ ) { pthread_join( pPool->hThreads[ u ], 0 ); }
+	pthread_cond_destroy( &(pPool->condDone) );
+	pthread_cond_destroy( &(pPool->condStart) );
+	pthread_mutex_destroy( &(pPool->mutex) );
+#endif
+	free( pPool );
+	pDP->pPool = 0;
+}
+
+void dp_pool_create( DPContext* pDP, UINT32 uThreads )
+{
+	DPThreadPool* pPool;
+	UINT32 u;
+
+	dp_pool_destroy( pDP );
+	if( uThreads < 2 ) { return; }
+
+	pPool = (DPThreadPool*)calloc( 1, sizeof(DPThreadPool) );
+	if( !pPool ) { return; }
+	pPool->pDP = pDP;
+
+#ifdef _WIN32
+	for( u = 0; u < uThreads - 1; u++ )
+	{
+		pPool->workers[ u ].pPool = pPool;
+		pPool->workers[ u ].uThread = u + 1;
+		pPool->hStart[ u ] = CreateEvent( 0, FALSE, FALSE, 0 );
+		pPool->hDone[ u ] = CreateEvent( 0, FALSE, FALSE, 0 );
+		pPool->hThreads[ u ] = CreateThread( 0, 0, dp_pool_worker, &(pPool->workers[ u ]), 0, 0 );
+		if( !pPool->hThreads[ u ] )
+		{
+			CloseHandle( pPool->hStart[ u ] );
+			CloseHandle( pPool->hDone[ u ] );
+			break;
+		}
+		pPool->uWorkers++;
+	}
+#else
+	pthread_mutex_init( &(pPool->mutex), 0 );
+	pthread_cond_init( &(pPool->condStart), 0 );
+	pthread_cond_init( &(pPool->condDone), 0 );
+	for( u = 0; u < uThreads - 1; u++ )
+	{
+		pPool->workers[ u ].pPool = pPool;
+		pPool->workers[ u ].uThread = u + 1;
+		if( pthread_create( &(pPool->hThreads[ u ]), 0, dp_pool_worker, &(pPool->workers[ u ]) ) != 0 ) { break; }
+		pPool->uWorkers++;
+	}
+#endif
+
+	pDP->pPool = pPool;
+	if( pPool->uWorkers + 1 < uThreads )
+	{
+		sprintf( gcPrintBuff, "only %lu of %lu threads could be started.\n", pPool->uWorkers + 1, uThreads );
+		PRINT_STDOUT( gcPrintBuff );
+	}
+	if( pPool->uWorkers == 0 ) { dp_pool_destroy( pDP ); }
+}
+
+#else
+
+void dp_pool_destroy( DPContext* pDP ) { pDP->pPool = 0; }
+void dp_pool_create( DPContext* pDP, UINT32 uThreads ) { pDP->pPool = 0; }
+
+#endif //ENABLE_THREADPOOL
+
+/* runs pfnJob over rows [0, uCount), split across the pool when there is one */
+/* the same as dp_pool_run over the rows [uFirst, uEnd) */
+void dp_pool_run_from( DPContext* pDP, fnParallelJob* pfnJob, void* pJob, UINT32 uFirst, UINT32 uEnd )
+{
+	DPThreadPool* pPool = pDP->pPool;
+	UINT32 uCount = ( uEnd > uFirst ) ? uEnd - uFirst : 0;
+	if( !pPool || uCount <= DP_THREAD_GRAIN )
+	{
+		(*pfnJob)( pDP, pJob, 0, uFirst, uFirst + uCount );
+		return;
+	}
+
+	pPool->pfnJob = pfnJob;
+	pPool->pJob = pJob;
+	pPool->uFirst = uFirst;
+	pPool->uCount = uCount;
+	pPool->iTaken = 0;
+
+#ifdef ENABLE_THREADPOOL
+#ifdef _WIN32
+	{
+		UINT32 u;
+		for( u = 0; u < pPool->uWorkers; u++ ) { SetEvent( pPool->hStart[ u ] ); }
+		dp_pool_drain( pPool, 0 );
+		WaitForMultipleObjects( pPool->uWorkers, pPool->hDone, TRUE, INFINITE );
+	}
+#else
+	pthread_mutex_lock( &(pPool->mutex) );
+	pPool->uBusy = pPool->uWorkers;
+	pPool->uGeneration++;
+	pthread_cond_broadcast( &(pPool->condStart) );
+	pthread_mutex_unlock( &(pPool->mutex) );
+
+	dp_pool_drain( pPool, 0 );
+
+	pthread_mutex_lock( &(pPool->mutex) );
+	while( pPool->uBusy ) { pthread_cond_wait( &(pPool->condDone), &(pPool->mutex) ); }
+	pthread_mutex_unlock( &(pPool->mutex) );
+#endif
+#endif //ENABLE_THREADPOOL
+}
+
+void dp_pool_run( DPContext* pDP, fnParallelJob* pfnJob, void* pJob, UINT32 uCount )
+{
+	dp_pool_run_from( pDP, pfnJob, pJob, 0, uCount );
+}
+
+EXTERNC void dp_set_threads( DPContext* pDP, UINT32 uThreads )
+{
+	if( uThreads > DP_MAX_THREADS ) { uThreads = DP_MAX_THREADS; }
+	pDP->uThreads = uThreads;
+	dp_pool_create( pDP, uThreads );
+}
+
+/*********************************************/
+
+/* best DP_SIMD_* kernel set this cpu (and os) can run */
+UINT32 dp_simd_detect()
+{
+#ifdef ENABLE_SIMD
+#ifdef _WIN32
+	int regs[ 4 ];
+	__cpuid( regs, 0 );
+	if( regs[ 0 ] >= 7 )
+	{
+		__cpuid( regs, 1 );
+		/* avx state must be enabled by the os as well */
+		if( ( regs[ 2 ] & ( 1 << 27 ) ) && ( regs[ 2 ] & ( 1 << 28 ) ) && ( _xgetbv( 0 ) & 6 ) == 6 )
+		{
+			__cpuidex( regs, 7, 0 );
+			if( regs[ 1 ] & ( 1 << 5 ) ) { return DP_SIMD_AVX2; }
+		}
+	}
+	__cpuid( regs, 1 );
+	return ( regs[ 3 ] & ( 1 << 26 ) ) ? DP_SIMD_SSE2 : DP_SIMD_NONE;
+#else
+	__builtin_cpu_init();
+	if( __builtin_cpu_supports( "avx2" ) ) { return DP_SIMD_AVX2; }
+	if( __builtin_cpu_supports( "sse2" ) ) { return DP_SIMD_SSE2; }
+	return DP_SIMD_NONE;
+#endif
+#else
+	return DP_SIMD_NONE;
+#endif //ENABLE_SIMD
+}
+
+/* select the backpass kernels, capped at what the cpu supports. DP_SIMD_NONE is the scalar reference. */
+EXTERNC void dp_set_simd( DPContext* pDP, UINT32 uSimd )
+{
+	UINT32 uSupported = dp_simd_detect();
+	pDP->uSimd = MIN( uSimd, uSupported );
+}
+
+/* limits for dp_resize, 0 is no limit */
+EXTERNC void dp_set_budget_memory( DPContext* pDP, UINT32 uMB ) { pDP->uBudgetMB = uMB; }
+EXTERNC void dp_set_budget_time( DPContext* pDP, UINT32 uMs ) { pDP->uBudgetMs = uMs; }
+
+/* DP_FORWARDPASS_WALK is the default, DP_FORWARDPASS_GREEDY the rescan it reproduces, for comparison */
+EXTERNC void dp_set_forwardpass( DPContext* pDP, UINT32 uForwardpass )
+{
+	pDP->uForwardpass = ( uForwardpass == DP_FORWARDPASS_WALK ) ? DP_FORWARDPASS_WALK : DP_FORWARDPASS_GREEDY;
+}
+
+/* with uOutageScan the next solve also builds the DP_RESULT_OUTAGEHK and DP_RESULT_OUTAGESOLUTION tables.
+ * they come from merging the unit HK tables whatever uEngine is, so they can differ from
+ * solving again with the unit's weight at 0, most with the backpass engine */
+EXTERNC void dp_set_outage_scan( DPContext* pDP, UINT32 uOutageScan ) { pDP->uOutageScan = uOutageScan ? 1 : 0; }
+
+/* with a uFactor above 1 a solve is two passes through dp_resize, dp_malloc and dp. the first
+ * solves with uFactor times fewer unitsteps, the second solves at full resolution but only
+ * tries the local decisions within DP_REFINE_BAND coarse steps of what the first chose. */
+EXTERNC void dp_set_refine( DPContext* pDP, UINT32 uFactor )
+{
+	pDP->uRefineFactor = uFactor;
+	pDP->uRefineStates = 0;
+}
+
+/* with uPrune the backpass stops trying decisions between 0 and a unit's near-optimum state
+ * once the scenario is above the unit's maximum. the solution can change, see dp_print_prune. */
+EXTERNC void dp_set_prune( DPContext* pDP, UINT32 uPrune ) { pDP->uPrune = uPrune ? 1 : 0; }
+
+/* the band of plant loads the next solve reports, in the units of the solvemode. a 0 leaves
+ * that end open. the results still index states from 0, see dp_get_first_state. */
+EXTERNC void dp_set_band( DPContext* pDP, FLOAT fMin, FLOAT fMax )
+{
+	pDP->fStateMin = fMin;
+	pDP->fStateMax = fMax;
+}
+
+/* DP_ENGINE_BACKPASS is the reference solver */
+EXTERNC void dp_set_engine( DPContext* pDP, UINT32 uEngine )
+{
+	pDP->uEngine = ( uEngine == DP_ENGINE_GROUPED || uEngine == DP_ENGINE_TREE ) ? uEngine : DP_ENGINE_BACKPASS;
+}
+
 /*********************************************/
 
 /*********************************************/
 
 /* forward references */
-EXTERNC void dp_cleanup();
+EXTERNC void dp_cleanup( DPContext* pDP );
+UINT32 dp_arena_layout( DPContext* pDP, UINT8* pBase, UINT32 uCarve );
 
 void parse_freeallblocks();
-void dp_cleanup_fatal();
-char* char_units( UINT32 iUnitType );
-void ui_parse_units( char* szType );
+void dp_cleanup_fatal( DPContext* pDP );
+char* char_units( DPContext* pDP, UINT32 iUnitType );
+void ui_parse_units( DPContext* pDP, char* szType );
 
 /*********************************************/
 
@@ -401,20 +1018,20 @@ CHAR* strtokRestore( CHAR* pCurrent, CHAR* pRestore, CHAR cEraser )
 	return pRestore;
 }
 
-char* char_units( UINT32 iUnitType )
+char* char_units( DPContext* pDP, UINT32 iUnitType )
 {
-	if( guUnitMode == DP_UNITS_UNDEFINED )
+	if( pDP->uUnitMode == DP_UNITS_UNDEFINED )
 	{
 		return gszHuh;
 	} else {
 		if( iUnitType == DP_UNIT_POWER )
 		{
-			return gsUniversalUnits[ guMWMode ];
+			return gsUniversalUnits[ pDP->uMWMode ];
 		} else {
-			if( guUnitMode == DP_UNITS_METRIC )
+			if( pDP->uUnitMode == DP_UNITS_METRIC )
 				return gsMetricUnits[ iUnitType ];
 			else
-				return gsImperialUnits[ iUnitType + guMWMode ];
+				return gsImperialUnits[ iUnitType + pDP->uMWMode ];
 		}
 	}
 }
@@ -465,7 +1082,8 @@ DP_INLINE FLOAT float_interpolate5( FLOAT v, FLOAT f0, FLOAT t0, FLOAT f1, FLOAT
 // Jim Gordon Equation
 DP_INLINE FLOAT float_EffAdjFactor( float hNet, float hRated, float fExp )
 {
-	FLOAT fEffAdj = 0.5 * powf( fabs( hNet - hRated ) / hRated, fExp );
+	FLOAT fRel = fabs( hNet - hRated ) / hRated;
+	FLOAT fEffAdj = 0.5 * ( fExp == 2.0 ? fRel * fRel : powf( fRel, fExp ) ); /* folds when inlined */
 	fEffAdj = MIN( 0.20, fEffAdj ); /* sanity check: max eff loss from head is 20% */
 	return ( hNet < hRated ) ? 1.0 - fEffAdj : 1.0 + fEffAdj;
 }
@@ -637,13 +1255,10 @@ DP_INLINE void arr_float_copy_indirect( FLOAT* pDest, FLOAT* pSrc, UINT16* pMap,
 	UINT16 i;
 	for( i=0; i<num; i++ ) {
 #ifdef ENABLE_NONMAPPABLEELEMENTS
-		if( pMap[ i ] != MAX_UINT16 )
-		{
+		pDest[i] = ( pMap[ i ] != MAX_UINT16 ) ? pSrc[ pMap[ i ] ] : 0;
 #else
-		{
+		pDest[i] = pSrc[ pMap[ i ] ];
 #endif
-			pDest[i] = pSrc[ pMap[ i ] ];
-		}
 	}
 }
 
@@ -696,6 +1311,157 @@ DP_INLINE void arr_float_max_nostride_count_pos( UINT16* puIndex, FLOAT* pFloat,
 	if( uIndex != MAX_UINT16 ) { *puIndex = uIndex; }
 }
 
+/* max-plus step of the backpass over one run of states whose local decisions
+ * are consecutive. pLocal* are indexed by state, pRev* are the previous stage's
+ * decision tables stored back to front, so as the state goes up the global
+ * decision (scenario - local decision) goes down and the loads stay contiguous.
+ * lanes whose local decision is zero read the scenario's own cell instead.
+ * fThreshold drops local decisions whose global count is below it.
+ * the best value/count above *pfBest, first state on ties, is returned through
+ * pfBest/puBest. arr_float_maxplus is the reference for the vector versions. */
+
+void arr_float_maxplus( FLOAT* pfBest, UINT32* puBest,
+	FLOAT* pLocalValues, FLOAT* pLocalCounts, FLOAT* pRevValues, FLOAT* pRevCounts,
+	FLOAT fScenarioValue, FLOAT fScenarioCount, FLOAT fThreshold, UINT32 uFirst, UINT32 n )
+{
+	FLOAT fBest = *pfBest;
+	UINT32 uBest = *puBest;
+	UINT32 i;
+	for( i = 0; i < n; i++ )
+	{
+		FLOAT fLocal = pLocalValues[ i ];
+		FLOAT fLocalCount = pLocalCounts[ i ];
+		FLOAT fGlobal = ( fLocalCount == 0 ) ? fScenarioValue : pRevValues[ i ];
+		FLOAT fGlobalCount = ( fLocalCount == 0 ) ? fScenarioCount : pRevCounts[ i ];
+		FLOAT fCount;
+		if( fGlobalCount < fThreshold ) { fLocal = 0; fLocalCount = 0; }
+		fCount = fGlobalCount + fLocalCount;
+		if( fCount > 0 )
+		{
+			FLOAT v = ( fLocal + fGlobal ) / fCount;
+			if( v > fBest ) { fBest = v; uBest = uFirst + i; }
+		}
+	}
+	*pfBest = fBest;
+	*puBest = uBest;
+}
+
+#ifdef ENABLE_SIMD
+
+/* merge per-lane winners. each lane holds the first state of its own maximum. */
+DP_INLINE void arr_float_maxplus_reduce( FLOAT* pfBest, UINT32* puBest, FLOAT* pLaneBest, int* pLaneState, UINT32 uLanes )
+{
+	UINT32 i;
+	for( i = 0; i < uLanes; i++ )
+	{
+		if( pLaneState[ i ] < 0 ) { continue; } /* lane never improved */
+		if( pLaneBest[ i ] > *pfBest || ( pLaneBest[ i ] == *pfBest && (UINT32)pLaneState[ i ] < *puBest ) )
+		{
+			*pfBest = pLaneBest[ i ];
+			*puBest = (UINT32)pLaneState[ i ];
+		}
+	}
+}
+
+DP_TARGET_SSE2 void arr_float_maxplus_sse2( FLOAT* pfBest, UINT32* puBest,
+	FLOAT* pLocalValues, FLOAT* pLocalCounts, FLOAT* pRevValues, FLOAT* pRevCounts,
+	FLOAT fScenarioValue, FLOAT fScenarioCount, FLOAT fThreshold, UINT32 uFirst, UINT32 n )
+{
+	ALIGN16 FLOAT fLaneBest[ 4 ];
+	ALIGN16 int iLaneState[ 4 ];
+	__m128 xBest = _mm_set1_ps( *pfBest );
+	__m128i xBestState = _mm_set1_epi32( -1 );
+	__m128i xState = _mm_add_epi32( _mm_set1_epi32( (int)uFirst ), _mm_setr_epi32( 0, 1, 2, 3 ) );
+	__m128i xFour = _mm_set1_epi32( 4 );
+	__m128 xScenarioValue = _mm_set1_ps( fScenarioValue );
+	__m128 xScenarioCount = _mm_set1_ps( fScenarioCount );
+	__m128 xThreshold = _mm_set1_ps( fThreshold );
+	__m128 xZero = _mm_setzero_ps();
+	__m128 xOne = _mm_set1_ps( 1.0f );
+	UINT32 i;
+
+	for( i = 0; i + 4 <= n; i += 4 )
+	{
+		__m128 xLocal = _mm_loadu_ps( pLocalValues + i );
+		__m128 xLocalCount = _mm_loadu_ps( pLocalCounts + i );
+		__m128 xOwn = _mm_cmpeq_ps( xLocalCount, xZero );
+		__m128 xGlobal = _mm_or_ps( _mm_and_ps( xOwn, xScenarioValue ), _mm_andnot_ps( xOwn, _mm_loadu_ps( pRevValues + i ) ) );
+		__m128 xGlobalCount = _mm_or_ps( _mm_and_ps( xOwn, xScenarioCount ), _mm_andnot_ps( xOwn, _mm_loadu_ps( pRevCounts + i ) ) );
+		__m128 xDrop = _mm_cmplt_ps( xGlobalCount, xThreshold );
+		__m128 xCount, xValue, xBetter;
+		xLocal = _mm_andnot_ps( xDrop, xLocal );
+		xLocalCount = _mm_andnot_ps( xDrop, xLocalCount );
+		xCount = _mm_add_ps( xGlobalCount, xLocalCount );
+		xValue = _mm_div_ps( _mm_add_ps( xLocal, xGlobal ), _mm_max_ps( xCount, xOne ) );
+		xValue = _mm_and_ps( _mm_cmpgt_ps( xCount, xZero ), xValue );
+		xBetter = _mm_cmpgt_ps( xValue, xBest );
+		xBest = _mm_or_ps( _mm_and_ps( xBetter, xValue ), _mm_andnot_ps( xBetter, xBest ) );
+		xBestState = _mm_or_si128( _mm_and_si128( _mm_castps_si128( xBetter ), xState ), _mm_andnot_si128( _mm_castps_si128( xBetter ), xBestState ) );
+		xState = _mm_add_epi32( xState, xFour );
+	}
+
+	_mm_store_ps( fLaneBest, xBest );
+	_mm_store_si128( (__m128i*)iLaneState, xBestState );
+	arr_float_maxplus_reduce( pfBest, puBest, fLaneBest, iLaneState, 4 );
+
+	if( i < n )
+	{
+		arr_float_maxplus( pfBest, puBest, pLocalValues + i, pLocalCounts + i, pRevValues + i, pRevCounts + i,
+			fScenarioValue, fScenarioCount, fThreshold, uFirst + i, n - i );
+	}
+}
+
+DP_TARGET_AVX2 void arr_float_maxplus_avx2( FLOAT* pfBest, UINT32* puBest,
+	FLOAT* pLocalValues, FLOAT* pLocalCounts, FLOAT* pRevValues, FLOAT* pRevCounts,
+	FLOAT fScenarioValue, FLOAT fScenarioCount, FLOAT fThreshold, UINT32 uFirst, UINT32 n )
+{
+	ALIGN32 FLOAT fLaneBest[ 8 ];
+	ALIGN32 int iLaneState[ 8 ];
+	__m256 xBest = _mm256_set1_ps( *pfBest );
+	__m256i xBestState = _mm256_set1_epi32( -1 );
+	__m256i xState = _mm256_add_epi32( _mm256_set1_epi32( (int)uFirst ), _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7 ) );
+	__m256i xEight = _mm256_set1_epi32( 8 );
+	__m256 xScenarioValue = _mm256_set1_ps( fScenarioValue );
+	__m256 xScenarioCount = _mm256_set1_ps( fScenarioCount );
+	__m256 xThreshold = _mm256_set1_ps( fThreshold );
+	__m256 xZero = _mm256_setzero_ps();
+	__m256 xOne = _mm256_set1_ps( 1.0f );
+	UINT32 i;
+
+	for( i = 0; i + 8 <= n; i += 8 )
+	{
+		__m256 xLocal = _mm256_loadu_ps( pLocalValues + i );
+		__m256 xLocalCount = _mm256_loadu_ps( pLocalCounts + i );
+		__m256 xOwn = _mm256_cmp_ps( xLocalCount, xZero, _CMP_EQ_OQ );
+		__m256 xGlobal = _mm256_blendv_ps( _mm256_loadu_ps( pRevValues + i ), xScenarioValue, xOwn );
+		__m256 xGlobalCount = _mm256_blendv_ps( _mm256_loadu_ps( pRevCounts + i ), xScenarioCount, xOwn );
+		__m256 xDrop = _mm256_cmp_ps( xGlobalCount, xThreshold, _CMP_LT_OQ );
+		__m256 xCount, xValue, xBetter;
+		xLocal = _mm256_andnot_ps( xDrop, xLocal );
+		xLocalCount = _mm256_andnot_ps( xDrop, xLocalCount );
+		xCount = _mm256_add_ps( xGlobalCount, xLocalCount );
+		xValue = _mm256_div_ps( _mm256_add_ps( xLocal, xGlobal ), _mm256_max_ps( xCount, xOne ) );
+		xValue = _mm256_and_ps( _mm256_cmp_ps( xCount, xZero, _CMP_GT_OQ ), xValue );
+		xBetter = _mm256_cmp_ps( xValue, xBest, _CMP_GT_OQ );
+		xBest = _mm256_blendv_ps( xBest, xValue, xBetter );
+		xBestState = _mm256_blendv_epi8( xBestState, xState, _mm256_castps_si256( xBetter ) );
+		xState = _mm256_add_epi32( xState, xEight );
+	}
+
+	_mm256_store_ps( fLaneBest, xBest );
+	_mm256_store_si256( (__m256i*)iLaneState, xBestState );
+	_mm256_zeroupper(); /* avoid the avx to sse transition penalty in the callers */
+	arr_float_maxplus_reduce( pfBest, puBest, fLaneBest, iLaneState, 8 );
+
+	if( i < n )
+	{
+		arr_float_maxplus( pfBest, puBest, pLocalValues + i, pLocalCounts + i, pRevValues + i, pRevCounts + i,
+			fScenarioValue, fScenarioCount, fThreshold, uFirst + i, n - i );
+	}
+}
+
+#endif //ENABLE_SIMD
+
 DP_INLINE void arr_float_max_count_pos( UINT16* puIndex, FLOAT* pFloat, UINT8* pCount, UINT32 n, UINT32 uStride )
 {
 #if 0
@@ -773,8 +1539,9 @@ DP_INLINE void arr_float_last_nonzero_nostride( UINT16* puIndex, FLOAT* pFloat,
 	*puIndex = uIndex;
 }
 
-DP_INLINE void arr_float_max_unmarked_prioritized_count(
-	UINT16* puStage, FLOAT* pValues, UINT8* pCounts, UINT8* pMarklist, UINT16* pPriorityOrder, UINT32 uStages, UINT32 uStride
+/* pAverages is one state's row of the [ states, stages ] forwardpass table */
+DP_INLINE void arr_float_max_unmarked_prioritized(
+	UINT16* puStage, FLOAT* pAverages, UINT8* pMarklist, UINT16* pPriorityOrder, UINT32 uStages
 )
 {
 	FLOAT fNextBestValue = 0;
@@ -787,15 +1554,11 @@ DP_INLINE void arr_float_max_unmarked_prioritized_count(
 #endif
 	{
 		UINT16 u16PrioritizedStage = pPriorityOrder[ s ];
-		UINT8 u8 = pCounts[ u16PrioritizedStage * uStride ]; // TODO: cache ick
-		if( u8 > 0 && (pMarklist[ u16PrioritizedStage ] != MAX_UINT8) )
+		FLOAT v = pAverages[ u16PrioritizedStage ];
+		if( v > fNextBestValue && (pMarklist[ u16PrioritizedStage ] != MAX_UINT8) )
 		{
-			FLOAT v = pValues[ u16PrioritizedStage * uStride ] / u8; // TODO: cache ick
-			if( v > fNextBestValue )
-			{
-				fNextBestValue = v;
-				uNextBestStage = u16PrioritizedStage;
-			}
+			fNextBestValue = v;
+			uNextBestStage = u16PrioritizedStage;
 		}
 	}
 	if( uNextBestStage != MAX_UINT16 ) { *puStage = uNextBestStage; }
@@ -873,6 +1636,12 @@ void arr_uint8_clear_conditional( UINT8* pDest, UINT16* pTest, UINT32 num )
 	for( i=0; i<num; i++ ) { if( pTest[i] == 0 ) { pDest[i] = 0; } }
 }
 
+void arr_uint8_set( UINT8* pDest, UINT8 uValue, UINT32 num )
+{
+	UINT16 i;
+	for( i=0; i<num; i++ ) { pDest[i] = uValue; }
+}
+
 void arr_uint8_copy( UINT8* pDest, UINT8* pSrc, UINT32 num )
 {
 	UINT16 i;
@@ -995,6 +1764,17 @@ void arr_uint32_transpose( UINT32* pDest, UINT32* pSrc, UINT32 uVectSize, UINT32
 
 /*********************************************/
 
+#define CURVE_GRID_MAXSTEPS (1024)
+
+/* uniform resampling of one curve axis so lookups don't search the points */
+typedef struct tagCurveGrid
+{
+	UINT32 uSteps;		/* 0 when the axis isn't ascending, lookups then use arr_float_findlarger */
+	FLOAT  fOrigin;		/* axis value of step 0 */
+	FLOAT  fScale;		/* steps per unit of the axis */
+	UINT8* pu8Point;	/* [ steps ] last point at or below the start of each step */
+} CurveGrid;
+
 typedef struct tagCurveDef
 {
 	CHAR*  szName;
@@ -1002,175 +1782,245 @@ typedef struct tagCurveDef
 	FLOAT* pfFloFact; /* capacity factor: % cfs */
 	FLOAT* pfEffFact; /* efficiency factor: % energy conversion */
 	FLOAT* pfPowFact; /* power factor: kw / ft-cfs */
+	CurveGrid sFloGrid;
+	CurveGrid sPowGrid;
 } CurveDef;
 
-UINT32 guBuiltinCurves = 0;
-UINT32    guCurves = 0;
-CurveDef* gpCurves = 0;
+void curve_grid_free( CurveGrid* pGrid )
+{
+	if( pGrid->pu8Point ) { free( pGrid->pu8Point ); }
+	memset( pGrid, 0, sizeof(CurveGrid) );
+}
+
+/* returns 0 if malloc failed */
+UINT32 curve_grid_compile( CurveGrid* pGrid, FLOAT* pfAxis, UINT32 uPoints )
+{
+	UINT32 u, uStep;
+	FLOAT fRange, fSpacing;
+
+	memset( pGrid, 0, sizeof(CurveGrid) );
+	if( uPoints < 2 || uPoints > MAX_UINT8 ) { return 1; }
+
+	// symmetric (backside) curves need the search
+	fSpacing = pfAxis[ uPoints - 1 ] - pfAxis[ 0 ];
+	for( u = 0; u < uPoints - 1; u++ )
+	{
+		if( !( pfAxis[ u ] < pfAxis[ u + 1 ] ) ) { return 1; }
+		fSpacing = MIN( fSpacing, pfAxis[ u + 1 ] - pfAxis[ u ] );
+	}
+
+	// step no wider than the closest points so a lookup moves at most one point.
+	// points closer than the capped grid resolves keep the search
+	fRange = pfAxis[ uPoints - 1 ] - pfAxis[ 0 ];
+	if( !( ceil( fRange / fSpacing ) <= CURVE_GRID_MAXSTEPS ) ) { return 1; }
+	uStep = MAX( 1, (UINT32)ceil( fRange / fSpacing ) );
+
+	pGrid->pu8Point = (UINT8*)malloc( uStep * sizeof(UINT8) );
+	if( pGrid->pu8Point == 0 ) { return 0; }
 
-EXTERNC void curve_cleanup()
+	pGrid->uSteps = uStep;
+	pGrid->fOrigin = pfAxis[ 0 ];
+	pGrid->fScale = uStep / fRange;
+	for( u = 0, uStep = 0; uStep < pGrid->uSteps; uStep++ )
+	{
+		FLOAT fStart = pGrid->fOrigin + uStep / pGrid->fScale;
+		while( u < uPoints - 2 && pfAxis[ u + 1 ] <= fStart ) { u++; }
+		pGrid->pu8Point[ uStep ] = (UINT8)u;
+	}
+	return 1;
+}
+
+EXTERNC void curve_cleanup( DPContext* pDP )
 {
-	if( gpCurves ) { free( gpCurves ); gpCurves = 0; }
-	guCurves = 0;
+	UINT32 uCurve;
+	for( uCurve = 0; uCurve < pDP->uCurves; uCurve++ )
+	{
+		curve_grid_free( &pDP->pCurves[ uCurve ].sFloGrid );
+		curve_grid_free( &pDP->pCurves[ uCurve ].sPowGrid );
+	}
+	if( pDP->pCurves ) { free( pDP->pCurves ); pDP->pCurves = 0; }
+	pDP->uCurves = 0;
 }
 
-UINT32 curve_find( CHAR* szCurveName )
+UINT32 curve_find( DPContext* pDP, CHAR* szCurveName )
 {
 	UINT32 uCurve;
-	for( uCurve = 0; uCurve < guCurves; uCurve++ ) {
-		if( strcasecmp( gpCurves[ uCurve ].szName, szCurveName ) == 0 ) { return uCurve; }
+	for( uCurve = 0; uCurve < pDP->uCurves; uCurve++ ) {
+		if( strcasecmp( pDP->pCurves[ uCurve ].szName, szCurveName ) == 0 ) { return uCurve; }
 	}
 	{
 		sprintf( gcPrintBuff, "%s:%d (" VERSIONED_NAME  ") Curve '%s' not found\n", __FILE__, __LINE__, szCurveName );
 		PRINT_STDERR( gcPrintBuff );
-		dp_cleanup_fatal();
+		dp_cleanup_fatal( pDP );
 	}
 	return MAX_UINT32;
 }
 
-EXTERNC UINT32 curve_register_n( UINT32 np, FLOAT* pCap, FLOAT* pPow, FLOAT* pEff )
+EXTERNC UINT32 curve_register_n( DPContext* pDP, UINT32 np, FLOAT* pCap, FLOAT* pPow, FLOAT* pEff )
 {
-	void* pVoid = realloc( gpCurves, ( guCurves + 1 ) * sizeof(CurveDef) );
+	void* pVoid = realloc( pDP->pCurves, ( pDP->uCurves + 1 ) * sizeof(CurveDef) );
 	if( pVoid == 0 )
 	{
-		sprintf( gcPrintBuff, "%s:%d (" VERSIONED_NAME  ") realloc failed\n", __FILE__, __LINE__ ); dp_cleanup_fatal();
+		sprintf( gcPrintBuff, "%s:%d (" VERSIONED_NAME  ") realloc failed\n", __FILE__, __LINE__ ); dp_cleanup_fatal( pDP );
 		PRINT_STDERR( gcPrintBuff );
 		return 0;
 	}
-	gpCurves = (CurveDef*)pVoid;
-
-	gpCurves[ guCurves ].szName = "N/A";
-	gpCurves[ guCurves ].uPoints = np;
-	gpCurves[ guCurves ].pfFloFact = pCap;
-	gpCurves[ guCurves ].pfEffFact = pEff;
-	gpCurves[ guCurves ].pfPowFact = pPow;
-	guCurves++;
-	return guCurves-1;
+	pDP->pCurves = (CurveDef*)pVoid;
+
+	pDP->pCurves[ pDP->uCurves ].szName = "N/A";
+	pDP->pCurves[ pDP->uCurves ].uPoints = np;
+	pDP->pCurves[ pDP->uCurves ].pfFloFact = pCap;
+	pDP->pCurves[ pDP->uCurves ].pfEffFact = pEff;
+	pDP->pCurves[ pDP->uCurves ].pfPowFact = pPow;
+	if( !curve_grid_compile( &pDP->pCurves[ pDP->uCurves ].sFloGrid, pCap, np ) ||
+		!curve_grid_compile( &pDP->pCurves[ pDP->uCurves ].sPowGrid, pPow, np ) )
+	{
+		curve_grid_free( &pDP->pCurves[ pDP->uCurves ].sFloGrid );
+		sprintf( gcPrintBuff, "%s:%d (" VERSIONED_NAME  ") malloc failed\n", __FILE__, __LINE__ );
+		PRINT_STDERR( gcPrintBuff );
+		dp_cleanup_fatal( pDP );
+		return 0;
+	}
+	pDP->uCurves++;
+	return pDP->uCurves-1;
 }
 
 // caller owned memory
-void curve_register( CHAR* szCurveName, UINT32 np, FLOAT* pCap, FLOAT* pPow, FLOAT* pEff )
+void curve_register( DPContext* pDP, CHAR* szCurveName, UINT32 np, FLOAT* pCap, FLOAT* pPow, FLOAT* pEff )
 {
 	UINT32 uCurve;
-	for( uCurve = 0; uCurve < guCurves; uCurve++ ) {
-		if( strcasecmp( gpCurves[ uCurve ].szName, szCurveName ) == 0 )
+	for( uCurve = 0; uCurve < pDP->uCurves; uCurve++ ) {
+		if( strcasecmp( pDP->pCurves[ uCurve ].szName, szCurveName ) == 0 )
 		{
 			sprintf( gcPrintBuff, "%s:%d (" VERSIONED_NAME  ") Curve '%s' already named\n", __FILE__, __LINE__, szCurveName );
 			PRINT_STDERR( gcPrintBuff );
-			dp_cleanup_fatal();
+			dp_cleanup_fatal( pDP );
 			return;
 		}
 	}
-	uCurve = curve_register_n( np, pCap, pPow, pEff );
-	gpCurves[ uCurve ].szName = szCurveName;
+	uCurve = curve_register_n( pDP, np, pCap, pPow, pEff );
+	pDP->pCurves[ uCurve ].szName = szCurveName;
 }
 
-void curve_list( UINT32 uUserCurves )
+/* FNV-1a of the curve points, so cached HK tables notice an edited curve */
+UINT32 curve_hash( DPContext* pDP, UINT32 uCurve )
 {
-	UINT32 uCurve, uPoints;
-	for( uCurve = ( uUserCurves ? guBuiltinCurves : 0 ); uCurve < guCurves; uCurve++ )
+	CurveDef* pCurve = &pDP->pCurves[ uCurve ];
+	FLOAT* apf[ 3 ];
+	UINT32 uHash = 2166136261UL;
+	UINT32 u, uByte;
+	apf[ 0 ] = pCurve->pfFloFact; apf[ 1 ] = pCurve->pfPowFact; apf[ 2 ] = pCurve->pfEffFact;
+	for( u = 0; u < 3; u++ )
 	{
-		fprintf( stdout, "curve %s flo ", gpCurves[ uCurve ].szName );
-		for( uPoints = 0; uPoints < gpCurves[ uCurve ].uPoints; uPoints++ )
-		{ fprintf( stdout, float_format( gpCurves[ uCurve ].pfFloFact[ uPoints ] ), gpCurves[ uCurve ].pfFloFact[ uPoints ] ); fprintf( stdout, " " ); } fprintf( stdout, "\n" );
-		fprintf( stdout, "curve %s pow ", gpCurves[ uCurve ].szName );
-		for( uPoints = 0; uPoints < gpCurves[ uCurve ].uPoints; uPoints++ )
-		{ fprintf( stdout, float_format( gpCurves[ uCurve ].pfPowFact[ uPoints ] ), gpCurves[ uCurve ].pfPowFact[ uPoints ] ); fprintf( stdout, " " ); } fprintf( stdout, "\n" );
-		fprintf( stdout, "curve %s eff ", gpCurves[ uCurve ].szName );
-		for( uPoints = 0; uPoints < gpCurves[ uCurve ].uPoints; uPoints++ )
-		{ fprintf( stdout, float_format( gpCurves[ uCurve ].pfEffFact[ uPoints ] ), gpCurves[ uCurve ].pfEffFact[ uPoints ] ); fprintf( stdout, " " ); } fprintf( stdout, "\n" );
+		UINT8* pu8 = (UINT8*)apf[ u ];
+		for( uByte = 0; uByte < pCurve->uPoints * sizeof(FLOAT); uByte++ ) { uHash = ( uHash ^ pu8[ uByte ] ) * 16777619UL; }
 	}
+	return ( uHash ^ pCurve->uPoints ) * 16777619UL;
 }
 
-// takes [0,1] returns [0,1]
-DP_INLINE FLOAT curve_eff_from_qfact( UINT32 uCurve, FLOAT fQFact )
+void curve_list( DPContext* pDP, UINT32 uUserCurves )
 {
-	FLOAT f1;
-	UINT32 i1;
-	arr_float_findlarger( gpCurves[ uCurve ].pfFloFact, gpCurves[ uCurve ].uPoints, fQFact, &f1, &i1 );
-	if( i1 == 0 )
+	UINT32 uCurve, uPoints;
+	for( uCurve = ( uUserCurves ? pDP->uBuiltinCurves : 0 ); uCurve < pDP->uCurves; uCurve++ )
 	{
-		return 0; /* assume discontinuity is intentional */
-	} else {
-		UINT32 i0 = i1 - 1;
-		FLOAT f0 = gpCurves[ uCurve ].pfFloFact[ i0 ];
-		FLOAT t0 = gpCurves[ uCurve ].pfEffFact[ i0 ];
-		FLOAT t1 = gpCurves[ uCurve ].pfEffFact[ i1 ];
-		return float_interpolate5( fQFact, f0, t0, f1, t1 );
+		fprintf( stdout, "curve %s flo ", pDP->pCurves[ uCurve ].szName );
+		for( uPoints = 0; uPoints < pDP->pCurves[ uCurve ].uPoints; uPoints++ )
+		{ fprintf( stdout, float_format( pDP->pCurves[ uCurve ].pfFloFact[ uPoints ] ), pDP->pCurves[ uCurve ].pfFloFact[ uPoints ] ); fprintf( stdout, " " ); } fprintf( stdout, "\n" );
+		fprintf( stdout, "curve %s pow ", pDP->pCurves[ uCurve ].szName );
+		for( uPoints = 0; uPoints < pDP->pCurves[ uCurve ].uPoints; uPoints++ )
+		{ fprintf( stdout, float_format( pDP->pCurves[ uCurve ].pfPowFact[ uPoints ] ), pDP->pCurves[ uCurve ].pfPowFact[ uPoints ] ); fprintf( stdout, " " ); } fprintf( stdout, "\n" );
+		fprintf( stdout, "curve %s eff ", pDP->pCurves[ uCurve ].szName );
+		for( uPoints = 0; uPoints < pDP->pCurves[ uCurve ].uPoints; uPoints++ )
+		{ fprintf( stdout, float_format( pDP->pCurves[ uCurve ].pfEffFact[ uPoints ] ), pDP->pCurves[ uCurve ].pfEffFact[ uPoints ] ); fprintf( stdout, " " ); } fprintf( stdout, "\n" );
 	}
 }
 
-// takes [0,1] returns [0,1]
-DP_INLINE FLOAT curve_eff_from_pfact( UINT32 uCurve, FLOAT fPFact )
+// takes an axis value, returns efficiency
+DP_INLINE FLOAT curve_grid_eff( CurveGrid* pGrid, FLOAT* pfAxis, FLOAT* pfEff, UINT32 uPoints, FLOAT fValue )
 {
-	FLOAT f1;
+	FLOAT fStep, f1;
 	UINT32 i1;
-	arr_float_findlarger( gpCurves[ uCurve ].pfPowFact, gpCurves[ uCurve ].uPoints, fPFact, &f1, &i1 );
-	if( i1 == 0 )
+	if( pGrid->uSteps == 0 )
 	{
-		return 0; /* assume discontinuity is intentional */
-	} else {
-		UINT32 i0 = i1 - 1;
-		FLOAT f0 = gpCurves[ uCurve ].pfPowFact[ i0 ];
-		FLOAT t0 = gpCurves[ uCurve ].pfEffFact[ i0 ];
-		FLOAT t1 = gpCurves[ uCurve ].pfEffFact[ i1 ];
-		return float_interpolate5( fPFact, f0, t0, f1, t1 );
+		arr_float_findlarger( pfAxis, uPoints, fValue, &f1, &i1 );
+		if( i1 == 0 ) { return 0; } /* assume discontinuity is intentional */
+		return float_interpolate5( fValue, pfAxis[ i1 - 1 ], pfEff[ i1 - 1 ], f1, pfEff[ i1 ] );
 	}
+	if( !( fValue >= pfAxis[ 0 ] ) ) { return 0; } /* not in table, as arr_float_findlarger */
+	fStep = ( fValue - pGrid->fOrigin ) * pGrid->fScale;
+	i1 = pGrid->pu8Point[ ( fStep < pGrid->uSteps ) ? (UINT32)fStep : pGrid->uSteps - 1 ];
+	i1 += ( i1 < uPoints - 2 ) && ( pfAxis[ i1 + 1 ] <= fValue ); /* step straddles a point */
+	i1 -= ( i1 > 0 ) && ( pfAxis[ i1 ] > fValue ); /* rounding at the step start */
+	return float_interpolate5( fValue, pfAxis[ i1 ], pfEff[ i1 ], pfAxis[ i1 + 1 ], pfEff[ i1 + 1 ] );
+}
+
+// takes [0,1] returns [0,1]
+DP_INLINE FLOAT curve_eff_from_qfact( DPContext* pDP, UINT32 uCurve, FLOAT fQFact )
+{
+	CurveDef* pCurve = &pDP->pCurves[ uCurve ];
+	return curve_grid_eff( &pCurve->sFloGrid, pCurve->pfFloFact, pCurve->pfEffFact, pCurve->uPoints, fQFact );
+}
+
+// takes [0,1] returns [0,1]
+DP_INLINE FLOAT curve_eff_from_pfact( DPContext* pDP, UINT32 uCurve, FLOAT fPFact )
+{
+	CurveDef* pCurve = &pDP->pCurves[ uCurve ];
+	return curve_grid_eff( &pCurve->sPowGrid, pCurve->pfPowFact, pCurve->pfEffFact, pCurve->uPoints, fPFact );
 }
 
-EXTERNC void curve_register_builtins()
+EXTERNC void curve_register_builtins( DPContext* pDP )
 {
 	{
 		static CHAR* szCurve = "CrossFlow";
 		static FLOAT flo[] = {0,.10,.11,.13,.16,.182,.21,.232,.275,.31,.35,.40,.48,.60,.80,.91,1.00,1.10};
 		static FLOAT pow[] = {0,.10,.11,.13,.16,.182,.21,.232,.275,.31,.35,.40,.48,.60,.80,.91,1.00,1.10};
 		static FLOAT eff[] = {0,.655,.68,.71,.735,.75,.765,.775,.79,.80,.81,.8175,.825,.83,.83,.825,.82,.815};
-		curve_register( szCurve, sizeof(flo) / sizeof(FLOAT), flo, pow, eff );
+		curve_register( pDP, szCurve, sizeof(flo) / sizeof(FLOAT), flo, pow, eff );
 	}{
 		static CHAR* szCurve = "FixedPropeller";
 		static FLOAT flo[] = {0,.175,.22,.25,.285,.325,.375,.435,.485,.525,.60,.68,.75,.82,.91,1.00,1.08};
 		static FLOAT pow[] = {0,.175,.22,.25,.285,.325,.375,.435,.485,.525,.60,.68,.75,.82,.91,1.00,1.08};
 		static FLOAT eff[] = {0,.65,.70,.725,.75,.775,.80,.825,.84,.85,.86,.865,.8675,.8675,.865,.858,.85};
-		curve_register( szCurve, sizeof(flo) / sizeof(FLOAT), flo, pow, eff );
+		curve_register( pDP, szCurve, sizeof(flo) / sizeof(FLOAT), flo, pow, eff );
 	}{
 		static CHAR* szCurve = "Francis";
 		static FLOAT flo[] = {0,.25,.30,.34,.388,.44,.477,.49,.54,.66,.71,.765,.82,.89,.91,.94,1.00};
 		static FLOAT pow[] = {0,.25,.30,.34,.388,.44,.477,.49,.54,.66,.71,.765,.82,.89,.91,.94,1.00};
 		static FLOAT eff[] = {0,.435,.50,.55,.60,.65,.68,.70,.73,.80,.825,.85,.87,.89,.89,.885,.85};
-		curve_register( szCurve, sizeof(flo) / sizeof(FLOAT), flo, pow, eff );
+		curve_register( pDP, szCurve, sizeof(flo) / sizeof(FLOAT), flo, pow, eff );
 	}{
 		static CHAR* szCurve = "Kaplan";
 		static FLOAT flo[] = {0,.161,.20,.24,.288,.338,.406,.482,.565,.663,.80,.88,.91,1.00};
 		static FLOAT pow[] = {0,.161,.20,.24,.288,.338,.406,.482,.565,.663,.80,.88,.91,1.00};
 		static FLOAT eff[] = {0,.45,.50,.55,.60,.65,.70,.75,.80,.85,.90,.92,.92,.88};
-		curve_register( szCurve, sizeof(flo) / sizeof(FLOAT), flo, pow, eff );
+		curve_register( pDP, szCurve, sizeof(flo) / sizeof(FLOAT), flo, pow, eff );
 	}{
 		static CHAR* szCurve = "Pelton";
 		static FLOAT flo[] = {0,.035,.05,.066,.079,.089,.102,.12,.145,.172,.21,.264,.345,.42,.495,.56,.68,.85,1.00,1.10};
 		static FLOAT pow[] = {0,.035,.05,.066,.079,.089,.102,.12,.145,.172,.21,.264,.345,.42,.495,.56,.68,.85,1.00,1.10};
 		static FLOAT eff[] = {0,.40,.50,.60,.65,.675,.70,.725,.75,.775,.80,.825,.85,.865,.875,.88,.885,.885,.88,.875};
-		curve_register( szCurve, sizeof(flo) / sizeof(FLOAT), flo, pow, eff );
+		curve_register( pDP, szCurve, sizeof(flo) / sizeof(FLOAT), flo, pow, eff );
 	}{
 		static CHAR* szCurve = "Turgo";
 		static FLOAT flo[] = {0,.12,.15,.18,.21,.25,.28,.325,.37,.43,.49,.60,.68,.80,.90,1.00,1.10};
 		static FLOAT pow[] = {0,.12,.15,.18,.21,.25,.28,.325,.37,.43,.49,.60,.68,.80,.90,1.00,1.10};
 		static FLOAT eff[] = {0,.61,.68,.72,.75,.78,.80,.82,.835,.85,.86,.87,.873,.872,.869,.864,.856};
-		curve_register( szCurve, sizeof(flo) / sizeof(FLOAT), flo, pow, eff );
+		curve_register( pDP, szCurve, sizeof(flo) / sizeof(FLOAT), flo, pow, eff );
 	}
-	guBuiltinCurves = guCurves;
+	pDP->uBuiltinCurves = pDP->uCurves;
 }
 
-void curve_test()
+void curve_test( DPContext* pDP )
 {
 	/* ensure ascending values */
 /*
 	CHAR* szCurve = "CrossFlow";
-	UINT32 uCurve = curve_find( szCurve );
-	float_print( stdout, gpCurves[ uCurve ].uPoints, gpCurves[ uCurve ].pfFloFact );
-	float_print( stdout, gpCurves[ uCurve ].uPoints, gpCurves[ uCurve ].pfEffFact );
-	float_print( stdout, gpCurves[ uCurve ].uPoints, gpCurves[ uCurve ].pfPowFact );
+	UINT32 uCurve = curve_find( pDP, szCurve );
+	float_print( stdout, pDP->pCurves[ uCurve ].uPoints, pDP->pCurves[ uCurve ].pfFloFact );
+	float_print( stdout, pDP->pCurves[ uCurve ].uPoints, pDP->pCurves[ uCurve ].pfEffFact );
+	float_print( stdout, pDP->pCurves[ uCurve ].uPoints, pDP->pCurves[ uCurve ].pfPowFact );
 */
-	if( guDebugMode ) {
+	if( pDP->uDebugMode ) {
 		sprintf( gcPrintBuff, "%s:%d (" VERSIONED_NAME  ") Curve_test complete\n", __FILE__, __LINE__ );
 		PRINT_STDERR( gcPrintBuff );
 	}
@@ -1191,160 +2041,180 @@ typedef struct tagTurbineDef
 	FLOAT fGenCapacity; /* % extension of unit maxpower or maxflow  */
 	FLOAT fGenEfficiency; /* energy conversion efficiency [0-1] */
 	UINT32 uGenCurveNum; /* gen efficiency curve, in liu of a fixed effficiency constant. when MAX_UINT, curve is not used. */
+	UINT32 uHKRow; /* row of the HK tables, shared by identical units. see dp_assign_rows */
 } TurbineDef;
 
-UINT32 guTurbs = 0;
-TurbineDef* gpTurbs = 0;
+#define DP_HK_ROW( _pDP, _uStage ) ( (_pDP)->pTurbs[ _uStage ].uHKRow * (_pDP)->uProblemStepCount )
+
+/* everything a unit's rows of the HK tables are computed from. only 4 byte
+ * members so memcmp sees no padding */
+typedef struct tagHKTableKey
+{
+	UINT32 uCurveHash, uGenCurveHash;
+	UINT32 uSolveMode, uProblemStepCount;
+	FLOAT fRatedHead, fMaxFlow, fMaxPower, fWeight, fHeadloss, fGenCapacity, fGenEfficiency;
+	FLOAT fHeadCurr, fSolutionDelta, fPlantLossCoef, fConvFactor, fHeadEffectOnUnit;
+} HKTableKey;
+
+typedef struct tagHKTableEntry
+{
+	HKTableKey sKey;
+	UINT32 uValid; /* the unit's rows hold the tables for sKey */
+	UINT32 uHit; /* the current solve reuses the rows */
+} HKTableEntry;
+
 
-EXTERNC void turbine_cleanup()
+EXTERNC void turbine_cleanup( DPContext* pDP )
 {
-	if( gpTurbs ) { free( gpTurbs ); gpTurbs = 0; }
-	guTurbs = 0;
+	if( pDP->pTurbs ) { free( pDP->pTurbs ); pDP->pTurbs = 0; }
+	pDP->uTurbs = 0;
+	pDP->uHKRows = 0;
 }
 
-UINT32 turbine_find( CHAR* szTurbineName )
+UINT32 turbine_find( DPContext* pDP, CHAR* szTurbineName )
 {
 	UINT32 uCurve;
-	for( uCurve = 0; uCurve < guTurbs; uCurve++ ) {
-		if( strcasecmp( gpTurbs[ uCurve ].szName, szTurbineName ) == 0 ) { return uCurve; }
+	for( uCurve = 0; uCurve < pDP->uTurbs; uCurve++ ) {
+		if( strcasecmp( pDP->pTurbs[ uCurve ].szName, szTurbineName ) == 0 ) { return uCurve; }
 	}
 	{
 		sprintf( gcPrintBuff, "%s:%d (" VERSIONED_NAME  ") Turbine '%s' not found\n", __FILE__, __LINE__, szTurbineName );
 		PRINT_STDERR( gcPrintBuff );
-		dp_cleanup_fatal();
+		dp_cleanup_fatal( pDP );
 	}
 	return MAX_UINT32;
 }
 
-UINT32 turbine_find_err( CHAR* szTurbineName )
+UINT32 turbine_find_err( DPContext* pDP, CHAR* szTurbineName )
 {
 	UINT32 uCurve;
-	for( uCurve = 0; uCurve < guTurbs; uCurve++ ) {
-		if( strcasecmp( gpTurbs[ uCurve ].szName, szTurbineName ) == 0 ) { return uCurve; }
+	for( uCurve = 0; uCurve < pDP->uTurbs; uCurve++ ) {
+		if( strcasecmp( pDP->pTurbs[ uCurve ].szName, szTurbineName ) == 0 ) { return uCurve; }
 	}
 	return MAX_UINT32;
 }
 
-EXTERNC UINT32 turbine_register_n( UINT32 uType, FLOAT h, FLOAT q, FLOAT p )
+EXTERNC UINT32 turbine_register_n( DPContext* pDP, UINT32 uType, FLOAT h, FLOAT q, FLOAT p )
 {
-	void* pVoid = realloc( (void*)gpTurbs, ( guTurbs + 1 ) * sizeof(TurbineDef) );
+	void* pVoid = realloc( (void*)pDP->pTurbs, ( pDP->uTurbs + 1 ) * sizeof(TurbineDef) );
 	if( pVoid == 0 )
 	{
-		sprintf( gcPrintBuff, "%s:%d (" VERSIONED_NAME  ") realloc failed\n", __FILE__, __LINE__ ); dp_cleanup_fatal();
+		sprintf( gcPrintBuff, "%s:%d (" VERSIONED_NAME  ") realloc failed\n", __FILE__, __LINE__ ); dp_cleanup_fatal( pDP );
 		PRINT_STDERR( gcPrintBuff );
 		return 0;
 	}
-	gpTurbs = (TurbineDef*)pVoid;
-
-	gpTurbs[ guTurbs ].szName = "N/A"; /* default name in case of using the DLL api */
-	gpTurbs[ guTurbs ].uCurveNum = uType;
-	gpTurbs[ guTurbs ].fRatedHead = h;
-	gpTurbs[ guTurbs ].fMaxFlow = q;
-	gpTurbs[ guTurbs ].fMaxPower = p;
-	gpTurbs[ guTurbs ].fWeight = 1.0; /* default to equal weighting */
-	gpTurbs[ guTurbs ].fHeadloss = 0; /* default to no hydraulic losses k*Qmax/Qmax*/
-	gpTurbs[ guTurbs ].fGenCapacity = 1.0; /* default to turbine limited */
-	gpTurbs[ guTurbs ].fGenEfficiency = .95; /* default to 95% efficiency */
-	gpTurbs[ guTurbs ].uGenCurveNum = MAX_UINT32;
-	guTurbs++;
-	return guTurbs-1;
+	pDP->pTurbs = (TurbineDef*)pVoid;
+
+	pDP->pTurbs[ pDP->uTurbs ].szName = "N/A"; /* default name in case of using the DLL api */
+	pDP->pTurbs[ pDP->uTurbs ].uCurveNum = uType;
+	pDP->pTurbs[ pDP->uTurbs ].fRatedHead = h;
+	pDP->pTurbs[ pDP->uTurbs ].fMaxFlow = q;
+	pDP->pTurbs[ pDP->uTurbs ].fMaxPower = p;
+	pDP->pTurbs[ pDP->uTurbs ].fWeight = 1.0; /* default to equal weighting */
+	pDP->pTurbs[ pDP->uTurbs ].fHeadloss = 0; /* default to no hydraulic losses k*Qmax/Qmax*/
+	pDP->pTurbs[ pDP->uTurbs ].fGenCapacity = 1.0; /* default to turbine limited */
+	pDP->pTurbs[ pDP->uTurbs ].fGenEfficiency = .95; /* default to 95% efficiency */
+	pDP->pTurbs[ pDP->uTurbs ].uGenCurveNum = MAX_UINT32;
+	pDP->pTurbs[ pDP->uTurbs ].uHKRow = pDP->uHKRows++; /* until dp_assign_weights finds its twins */
+	pDP->uTurbs++;
+	return pDP->uTurbs-1;
 }
 
 // caller owned memory
-void turbine_register( CHAR* szTurbineName, CHAR* szCurveName, FLOAT h, FLOAT q, FLOAT p )
+void turbine_register( DPContext* pDP, CHAR* szTurbineName, CHAR* szCurveName, FLOAT h, FLOAT q, FLOAT p )
 {
 	UINT32 uTurb;
-	for( uTurb = 0; uTurb < guTurbs; uTurb++ )
+	for( uTurb = 0; uTurb < pDP->uTurbs; uTurb++ )
 	{
-		if( strcasecmp( gpTurbs[ uTurb ].szName, szTurbineName ) == 0 )
+		if( strcasecmp( pDP->pTurbs[ uTurb ].szName, szTurbineName ) == 0 )
 		{
 			sprintf( gcPrintBuff, "%s:%d (" VERSIONED_NAME  ") Turbine '%s' already named\n", __FILE__, __LINE__, szTurbineName );
 			PRINT_STDERR( gcPrintBuff );
-			dp_cleanup_fatal();
+			dp_cleanup_fatal( pDP );
 			return;
 		}
 	}
 	{
-		UINT32 uType = curve_find( szCurveName );
+		UINT32 uType = curve_find( pDP, szCurveName );
 		if( uType == MAX_UINT32 )
 		{
 			sprintf( gcPrintBuff, "%s:%d (" VERSIONED_NAME  ") Curve '%s' not found\n", __FILE__, __LINE__, szCurveName );
 			PRINT_STDERR( gcPrintBuff );
-			dp_cleanup_fatal();
+			dp_cleanup_fatal( pDP );
 			return;
 		}
 		{
-			uTurb = turbine_register_n( uType, h, q, p );
-			gpTurbs[ uTurb ].szName = szTurbineName;
+			uTurb = turbine_register_n( pDP, uType, h, q, p );
+			pDP->pTurbs[ uTurb ].szName = szTurbineName;
 		}
 	}
 }
 
-EXTERNC void turbine_geneff( UINT32 uTurbine, FLOAT fGenEfficiency )
+EXTERNC void turbine_geneff( DPContext* pDP, UINT32 uTurbine, FLOAT fGenEfficiency )
 {
 	/* only apply one not both  */
-	gpTurbs[ uTurbine ].fGenEfficiency = fGenEfficiency;
-	gpTurbs[ uTurbine ].uGenCurveNum = MAX_UINT32;
+	pDP->pTurbs[ uTurbine ].fGenEfficiency = fGenEfficiency;
+	pDP->pTurbs[ uTurbine ].uGenCurveNum = MAX_UINT32;
 }
 
-EXTERNC void turbine_headloss( UINT32 uTurbine, FLOAT fHeadloss )
+EXTERNC void turbine_headloss( DPContext* pDP, UINT32 uTurbine, FLOAT fHeadloss )
 {
-	gpTurbs[ uTurbine ].fHeadloss = fHeadloss;
+	pDP->pTurbs[ uTurbine ].fHeadloss = fHeadloss;
 }
 
-EXTERNC void turbine_weight( UINT32 uTurbine, FLOAT fWeight )
+EXTERNC void turbine_weight( DPContext* pDP, UINT32 uTurbine, FLOAT fWeight )
 {
-	gpTurbs[ uTurbine ].fWeight = fWeight;
+	pDP->pTurbs[ uTurbine ].fWeight = fWeight;
 }
 
-EXTERNC void turbine_gencap( UINT32 uTurbine, FLOAT fGenCapacity )
+EXTERNC void turbine_gencap( DPContext* pDP, UINT32 uTurbine, FLOAT fGenCapacity )
 {
-	gpTurbs[ uTurbine ].fGenCapacity = fGenCapacity;
+	pDP->pTurbs[ uTurbine ].fGenCapacity = fGenCapacity;
 }
 
-EXTERNC void turbine_gencurve( UINT32 uTurbine, UINT32 uGenCurveNum )
+EXTERNC void turbine_gencurve( DPContext* pDP, UINT32 uTurbine, UINT32 uGenCurveNum )
 {
 	/* only apply one not both  */
-	gpTurbs[ uTurbine ].fGenEfficiency = 1.0;
-	gpTurbs[ uTurbine ].uGenCurveNum = uGenCurveNum;
+	pDP->pTurbs[ uTurbine ].fGenEfficiency = 1.0;
+	pDP->pTurbs[ uTurbine ].uGenCurveNum = uGenCurveNum;
 }
 
-void turbine_gencurvename( UINT32 uTurbine, CHAR* szCurveName )
+void turbine_gencurvename( DPContext* pDP, UINT32 uTurbine, CHAR* szCurveName )
 {
-	UINT32 uType = curve_find( szCurveName );
+	UINT32 uType = curve_find( pDP, szCurveName );
 	if( uType == MAX_UINT32 )
 	{
 		sprintf( gcPrintBuff, "%s:%d (" VERSIONED_NAME  ") Curve '%s' not found\n", __FILE__, __LINE__, szCurveName );
 		PRINT_STDERR( gcPrintBuff );
-		dp_cleanup_fatal();
+		dp_cleanup_fatal( pDP );
 		return;
 	}
 	/* only apply one not both  */
-	gpTurbs[ uTurbine ].fGenEfficiency = 1.0;
-	gpTurbs[ uTurbine ].uGenCurveNum = uType;
+	pDP->pTurbs[ uTurbine ].fGenEfficiency = 1.0;
+	pDP->pTurbs[ uTurbine ].uGenCurveNum = uType;
 }
 
-void turbine_list()
+void turbine_list( DPContext* pDP )
 {
 	UINT32 uTurb;
-	for( uTurb = 0; uTurb < guTurbs; uTurb++ )
-	{
-		fprintf( stdout, "unit %s %s ", gpTurbs[ uTurb ].szName, gpCurves[ gpTurbs[ uTurb ].uCurveNum ].szName );
-		fprintf( stdout, float_format( gpTurbs[ uTurb ].fRatedHead ), gpTurbs[ uTurb ].fRatedHead );
-		fprintf( stdout, " %s ", char_units( DP_UNIT_LENGTH ) );
-		fprintf( stdout, float_format( gpTurbs[ uTurb ].fMaxFlow ), gpTurbs[ uTurb ].fMaxFlow );
-		fprintf( stdout, " %s ", char_units( DP_UNIT_FLOW ) );
-		fprintf( stdout, float_format( gpTurbs[ uTurb ].fMaxPower ), gpTurbs[ uTurb ].fMaxPower );
-		fprintf( stdout, " %s", char_units( DP_UNIT_POWER ) );
+	for( uTurb = 0; uTurb < pDP->uTurbs; uTurb++ )
+	{
+		fprintf( stdout, "unit %s %s ", pDP->pTurbs[ uTurb ].szName, pDP->pCurves[ pDP->pTurbs[ uTurb ].uCurveNum ].szName );
+		fprintf( stdout, float_format( pDP->pTurbs[ uTurb ].fRatedHead ), pDP->pTurbs[ uTurb ].fRatedHead );
+		fprintf( stdout, " %s ", char_units( pDP, DP_UNIT_LENGTH ) );
+		fprintf( stdout, float_format( pDP->pTurbs[ uTurb ].fMaxFlow ), pDP->pTurbs[ uTurb ].fMaxFlow );
+		fprintf( stdout, " %s ", char_units( pDP, DP_UNIT_FLOW ) );
+		fprintf( stdout, float_format( pDP->pTurbs[ uTurb ].fMaxPower ), pDP->pTurbs[ uTurb ].fMaxPower );
+		fprintf( stdout, " %s", char_units( pDP, DP_UNIT_POWER ) );
 		fprintf( stdout, " capacity " );
-		fprintf( stdout, float_format( gpTurbs[ uTurb ].fGenCapacity ), gpTurbs[ uTurb ].fGenCapacity );
+		fprintf( stdout, float_format( pDP->pTurbs[ uTurb ].fGenCapacity ), pDP->pTurbs[ uTurb ].fGenCapacity );
 		fprintf( stdout, " weight " );
-		fprintf( stdout, float_format( gpTurbs[ uTurb ].fWeight ), gpTurbs[ uTurb ].fWeight );
+		fprintf( stdout, float_format( pDP->pTurbs[ uTurb ].fWeight ), pDP->pTurbs[ uTurb ].fWeight );
 		fprintf( stdout, " headloss " );
-		fprintf( stdout, float_format( gpTurbs[ uTurb ].fHeadloss ), gpTurbs[ uTurb ].fHeadloss );
+		fprintf( stdout, float_format( pDP->pTurbs[ uTurb ].fHeadloss ), pDP->pTurbs[ uTurb ].fHeadloss );
 		fprintf( stdout, " geneff " );
-		fprintf( stdout, float_format( gpTurbs[ uTurb ].fGenEfficiency ), gpTurbs[ uTurb ].fGenEfficiency );
-		fprintf( stdout, " gencurve %s ", (gpTurbs[ uTurb ].uGenCurveNum == MAX_UINT32) ? "nil" : gpCurves[ gpTurbs[ uTurb ].uGenCurveNum ].szName );
+		fprintf( stdout, float_format( pDP->pTurbs[ uTurb ].fGenEfficiency ), pDP->pTurbs[ uTurb ].fGenEfficiency );
+		fprintf( stdout, " gencurve %s ", (pDP->pTurbs[ uTurb ].uGenCurveNum == MAX_UINT32) ? "nil" : pDP->pCurves[ pDP->pTurbs[ uTurb ].uGenCurveNum ].szName );
 		fprintf( stdout, "\n" );
 	}
 }
@@ -1352,51 +2222,21 @@ void turbine_list()
 /*****************/
 
 // takes [0,1] returns [0,1]
-DP_INLINE FLOAT turbine_eff_from_qfact( UINT32 uTurb, FLOAT fQFact )
+DP_INLINE FLOAT turbine_eff_from_qfact( DPContext* pDP, UINT32 uTurb, FLOAT fQFact )
 {
-	TurbineDef* pTurb = &gpTurbs[ uTurb ];
-	CurveDef* pCurve = &gpCurves[ pTurb->uCurveNum ];
-
-	FLOAT f1;
-	UINT32 i1;
-	arr_float_findlarger( pCurve->pfFloFact, pCurve->uPoints, fQFact, &f1, &i1 );
-	if( i1 == 0 )
-	{
-		return 0; /* assume discontinuity is intentional */
-	} else {
-		UINT32 i0 = i1 - 1;
-		FLOAT f0 = pCurve->pfFloFact[ i0 ];
-		FLOAT t0 = pCurve->pfEffFact[ i0 ];
-		FLOAT t1 = pCurve->pfEffFact[ i1 ];
-		return float_interpolate5( fQFact, f0, t0, f1, t1 );
-	}
+	return curve_eff_from_qfact( pDP, pDP->pTurbs[ uTurb ].uCurveNum, fQFact );
 }
 
 // takes [0,1] returns [0,1]
-DP_INLINE FLOAT turbine_eff_from_pfact( UINT32 uTurb, FLOAT fPFact )
+DP_INLINE FLOAT turbine_eff_from_pfact( DPContext* pDP, UINT32 uTurb, FLOAT fPFact )
 {
-	TurbineDef* pTurb = &gpTurbs[ uTurb ];
-	CurveDef* pCurve = &gpCurves[ pTurb->uCurveNum ];
+	return curve_eff_from_pfact( pDP, pDP->pTurbs[ uTurb ].uCurveNum, fPFact );
+}
 
-	FLOAT f1;
-	UINT32 i1;
-	arr_float_findlarger( pCurve->pfPowFact, pCurve->uPoints, fPFact, &f1, &i1 );
-	if( i1 == 0 )
-	{
-		return 0; /* assume discontinuity is intentional */
-	} else {
-		UINT32 i0 = i1 - 1;
-		FLOAT f0 = pCurve->pfPowFact[ i0 ];
-		FLOAT t0 = pCurve->pfEffFact[ i0 ];
-		FLOAT t1 = pCurve->pfEffFact[ i1 ];
-		return float_interpolate5( fPFact, f0, t0, f1, t1 );
-	}
-}
-
-DP_INLINE FLOAT turbine_maxpower_at_currenthead( UINT32 uTurb, FLOAT h )
+DP_INLINE FLOAT turbine_maxpower_at_currenthead( DPContext* pDP, UINT32 uTurb, FLOAT h )
 {
-	FLOAT pMax = gpTurbs[ uTurb ].fMaxPower;
-	FLOAT hRated = gpTurbs[ uTurb ].fRatedHead;
+	FLOAT pMax = pDP->pTurbs[ uTurb ].fMaxPower;
+	FLOAT hRated = pDP->pTurbs[ uTurb ].fRatedHead;
 #ifdef ENABLE_NEW_CALCS
 	FLOAT pAtCurrentHead = pMax * float_EffAdjFactor( h, hRated, 2.0 );
 #else /* ENABLE_NEW_CALCS */
@@ -1405,10 +2245,10 @@ DP_INLINE FLOAT turbine_maxpower_at_currenthead( UINT32 uTurb, FLOAT h )
 	return pAtCurrentHead;
 }
 
-DP_INLINE FLOAT turbine_maxdischarge_at_currenthead( UINT32 uTurb, FLOAT h )
+DP_INLINE FLOAT turbine_maxdischarge_at_currenthead( DPContext* pDP, UINT32 uTurb, FLOAT h )
 {
-	FLOAT qMax = gpTurbs[ uTurb ].fMaxFlow;
-	FLOAT hRated = gpTurbs[ uTurb ].fRatedHead;
+	FLOAT qMax = pDP->pTurbs[ uTurb ].fMaxFlow;
+	FLOAT hRated = pDP->pTurbs[ uTurb ].fRatedHead;
 #ifdef ENABLE_NEW_CALCS
 	FLOAT qAtCurrentHead = qMax * float_EffAdjFactor( h, hRated, 2.0 );
 #else /* ENABLE_NEW_CALCS */
@@ -1417,89 +2257,59 @@ DP_INLINE FLOAT turbine_maxdischarge_at_currenthead( UINT32 uTurb, FLOAT h )
 	return qAtCurrentHead;
 }
 
-DP_INLINE FLOAT turbine_power( UINT32 uTurb, FLOAT hCurrent, FLOAT qCurrent )
+/* pu8Condition receives the DP_CONDITION_ bits, 0 to ignore them */
+DP_INLINE FLOAT turbine_power( DPContext* pDP, UINT32 uTurb, FLOAT hCurrent, FLOAT qCurrent, UINT8* pu8Condition )
 {
 #ifdef ENABLE_NEW_CALCS
-	FLOAT qMax = gpTurbs[ uTurb ].fMaxFlow;
-	FLOAT pMax = gpTurbs[ uTurb ].fMaxPower;
-	FLOAT hRated = gpTurbs[ uTurb ].fRatedHead;
-	FLOAT hLossCoef = gpTurbs[ uTurb ].fHeadloss;
+	FLOAT qMax = pDP->pTurbs[ uTurb ].fMaxFlow;
+	FLOAT pMax = pDP->pTurbs[ uTurb ].fMaxPower;
+	FLOAT hRated = pDP->pTurbs[ uTurb ].fRatedHead;
+	FLOAT hLossCoef = pDP->pTurbs[ uTurb ].fHeadloss;
 	FLOAT fTol = 1E-3;
 	/**/
-	FLOAT fGenEfficiency = gpTurbs[ uTurb ].uGenCurveNum != MAX_UINT32 ?
-								curve_eff_from_qfact( gpTurbs[ uTurb ].uGenCurveNum, qCurrent / qMax ) :
-								gpTurbs[ uTurb ].fGenEfficiency;
+	FLOAT fGenEfficiency = pDP->pTurbs[ uTurb ].uGenCurveNum != MAX_UINT32 ?
+								curve_eff_from_qfact( pDP, pDP->pTurbs[ uTurb ].uGenCurveNum, qCurrent / qMax ) :
+								pDP->pTurbs[ uTurb ].fGenEfficiency;
 	/**/
 	int bDischExceedsMax = ( qCurrent > qMax );
 #ifdef ENABLE_NEW_DYNLOSS
-	FLOAT hHydraulicLoss = hLossCoef * powf( qCurrent / qMax, 2.0 );
+	FLOAT qFact = qCurrent / qMax;
+	FLOAT hHydraulicLoss = hLossCoef * ( qFact * qFact );
 #else
 	FLOAT hHydraulicLoss = powf( hLossCoef * qMax / qCurrent, 2.0 );
 #endif /* ENABLE_NEW_DYNLOSS */
 	FLOAT hNet = hCurrent - hHydraulicLoss;
 	FLOAT fEffAdjFact = float_EffAdjFactor( hNet, hRated, 2.0 );
-	FLOAT fGeneratorAndYardLoss = ( 1.0 - gfPlantLossCoef ) * fGenEfficiency;
+	FLOAT fGeneratorAndYardLoss = ( 1.0 - pDP->fPlantLossCoef ) * fGenEfficiency;
 	/**/
-	FLOAT fEff = turbine_eff_from_qfact( uTurb, qCurrent / qMax );
+	FLOAT fEff = turbine_eff_from_qfact( pDP, uTurb, qCurrent / qMax );
 	int bEffSmallerThanTol = ( fEff < fTol );
 	/**/
-	FLOAT pCurrent = MAX( 0, fEffAdjFact * fEff * ( qCurrent * hCurrent * gfConvFactor ) * fGeneratorAndYardLoss ); /* sanity check */
+	FLOAT pCurrent = MAX( 0, fEffAdjFact * fEff * ( qCurrent * hCurrent * pDP->fConvFactor ) * fGeneratorAndYardLoss ); /* sanity check */
 	int bPowExceedsMax = ( pCurrent > pMax );
 #else /* ENABLE_NEW_CALCS */
-	FLOAT pMax = gpTurbs[ uTurb ].fMaxPower;
-	FLOAT qMax = gpTurbs[ uTurb ].fMaxFlow;
-	FLOAT hRated = gpTurbs[ uTurb ].fRatedHead;
+	FLOAT pMax = pDP->pTurbs[ uTurb ].fMaxPower;
+	FLOAT qMax = pDP->pTurbs[ uTurb ].fMaxFlow;
+	FLOAT hRated = pDP->pTurbs[ uTurb ].fRatedHead;
 	int bDischExceedsMax = ( qCurrent > qMax );
-	FLOAT fEff = turbine_eff_from_qfact( uTurb, qCurrent / qMax );
+	FLOAT fEff = turbine_eff_from_qfact( pDP, uTurb, qCurrent / qMax );
 	FLOAT fTol = 1E-3;
 	int bEffSmallerThanTol = ( fEff < fTol );
 #ifdef ENABLE_NEWHEADSCALING
-	FLOAT hNet = hRated - hCurrent - gpTurbs[ uTurb ].fHeadloss;
+	FLOAT hNet = hRated - hCurrent - pDP->pTurbs[ uTurb ].fHeadloss;
 	FLOAT hScaling = ( 1 + (hNet > hRated ? +0.5 : -0.5) * powf( hNet / hRated, 2.0 ) );
 #else // ENABLE_NEWHEADSCALING
 	FLOAT hScaling = powf( (hCurrent / hRated), 1.5 ) ;
 #endif // ENABLE_NEWHEADSCALING
-	FLOAT fGenEfficiency = gpTurbs[ uTurb ].fGenEfficiency;
-	FLOAT pAtRatedHead = fEff * ( qCurrent * hCurrent * gfConvFactor );
-	FLOAT pCurrent = pAtRatedHead * hScaling * ( 1.0 - gfPlantLossCoef ) * ( fGenEfficiency );
+	FLOAT fGenEfficiency = pDP->pTurbs[ uTurb ].fGenEfficiency;
+	FLOAT pAtRatedHead = fEff * ( qCurrent * hCurrent * pDP->fConvFactor );
+	FLOAT pCurrent = pAtRatedHead * hScaling * ( 1.0 - pDP->fPlantLossCoef ) * ( fGenEfficiency );
 	int bPowExceedsMax = ( pCurrent > pMax );
 #endif /* ENABLE_NEW_CALCS */
-	/* check flags */
-	if( guDebugMode )
+	if( pu8Condition )
 	{
-		if( bDischExceedsMax )
-		{
-			char* szFlow = char_units( DP_UNIT_FLOW );
-			char* szLength = char_units( DP_UNIT_LENGTH );
-			fprintf( stdout, "condition on unit %s: %f %s at %f %s exceeds maximum rating (%f %s at %f %s).\n",
-					gpTurbs[ uTurb ].szName,
-					qCurrent, szFlow,
-					hCurrent, szLength,
-					qMax, szFlow,
-					hRated, szLength );
-		}
-		if( bEffSmallerThanTol )
-		{
-			char* szFlow = char_units( DP_UNIT_FLOW );
-			char* szLength = char_units( DP_UNIT_LENGTH );
-			fprintf( stdout, "condition on unit %s: efficiency of %f at %f %s too low for rating of %f %s at %f %s.\n",
-					gpTurbs[ uTurb ].szName,
-					fEff,
-					qCurrent, szFlow,
-					qMax, szFlow,
-					hRated, szLength );
-		}
-		if( bPowExceedsMax )
-		{
-			char* szPower = char_units( DP_UNIT_POWER );
-			char* szLength = char_units( DP_UNIT_LENGTH );
-			fprintf( stdout, "condition on unit %s: %f %s at %f %s exceeds maximum rating (%f %s at %f %s).\n",
-					gpTurbs[ uTurb ].szName,
-					pCurrent, szPower,
-					hCurrent, szLength,
-					pMax, szPower,
-					hRated, szLength );
-		}
+		*pu8Condition = (UINT8)( ( bDischExceedsMax ? DP_CONDITION_DISCH_EXCEEDS_MAX : 0 ) |
+			( bEffSmallerThanTol ? DP_CONDITION_EFF_BELOW_TOL : 0 ) | ( bPowExceedsMax ? DP_CONDITION_POW_EXCEEDS_MAX : 0 ) );
 	}
 #ifdef ENABLE_INLINE_NUMERICAL_CLEANUP
 	return ( isnanf( pCurrent ) || isinff( pCurrent ) ? 0 : pCurrent );
@@ -1508,92 +2318,62 @@ DP_INLINE FLOAT turbine_power( UINT32 uTurb, FLOAT hCurrent, FLOAT qCurrent )
 #endif
 }
 
-DP_INLINE FLOAT turbine_discharge( UINT32 uTurb, FLOAT hCurrent, FLOAT pCurrent )
+/* pu8Condition receives the DP_CONDITION_ bits, 0 to ignore them */
+DP_INLINE FLOAT turbine_discharge( DPContext* pDP, UINT32 uTurb, FLOAT hCurrent, FLOAT pCurrent, UINT8* pu8Condition )
 {
 #ifdef ENABLE_NEW_CALCS
-	FLOAT pMax = gpTurbs[ uTurb ].fMaxPower;
-	FLOAT qMax = gpTurbs[ uTurb ].fMaxFlow;
-	FLOAT hRated = gpTurbs[ uTurb ].fRatedHead;
-	FLOAT hLossCoef = gpTurbs[ uTurb ].fHeadloss;
+	FLOAT pMax = pDP->pTurbs[ uTurb ].fMaxPower;
+	FLOAT qMax = pDP->pTurbs[ uTurb ].fMaxFlow;
+	FLOAT hRated = pDP->pTurbs[ uTurb ].fRatedHead;
+	FLOAT hLossCoef = pDP->pTurbs[ uTurb ].fHeadloss;
 	FLOAT fTol = 1E-3;
 	/**/
-	FLOAT fGenEfficiency = gpTurbs[ uTurb ].uGenCurveNum != MAX_UINT32 ?
-								curve_eff_from_qfact( gpTurbs[ uTurb ].uGenCurveNum, pCurrent / pMax ) : /* note: approx */
-								gpTurbs[ uTurb ].fGenEfficiency;
+	FLOAT fGenEfficiency = pDP->pTurbs[ uTurb ].uGenCurveNum != MAX_UINT32 ?
+								curve_eff_from_qfact( pDP, pDP->pTurbs[ uTurb ].uGenCurveNum, pCurrent / pMax ) : /* note: approx */
+								pDP->pTurbs[ uTurb ].fGenEfficiency;
 	/**/
 #ifdef ENABLE_NEW_DYNLOSS
-	FLOAT hHydraulicLoss = hLossCoef * powf( pCurrent / pMax, 2.0 );
+	FLOAT pFact = pCurrent / pMax;
+	FLOAT hHydraulicLoss = hLossCoef * ( pFact * pFact );
 #else
 	FLOAT hHydraulicLoss = powf( hLossCoef * pMax / pCurrent, 2.0 );
 #endif /* ENABLE_NEW_DYNLOSS */
 	FLOAT hNet = hCurrent - hHydraulicLoss;
 	FLOAT fEffAdjFact = float_EffAdjFactor( hNet, hRated, 2.0 );
-	FLOAT fGeneratorAndYardLoss = ( 1.0 - gfPlantLossCoef ) * fGenEfficiency;
+	FLOAT fGeneratorAndYardLoss = ( 1.0 - pDP->fPlantLossCoef ) * fGenEfficiency;
 	/**/
 	FLOAT pTurbine = pCurrent / fGeneratorAndYardLoss;
 	int bPowExceedsMax = ( pTurbine > pMax );
-	FLOAT fEff = turbine_eff_from_pfact( uTurb, pTurbine / pMax );
+	FLOAT fEff = turbine_eff_from_pfact( pDP, uTurb, pTurbine / pMax );
 	int bEffSmallerThanTol = ( fEff < fTol );
 	/**/
-	FLOAT qCurrent = MAX( 0, pTurbine / ( fEffAdjFact * fEff * ( hCurrent * gfConvFactor ) ) ); /* sanity check */
+	FLOAT qCurrent = MAX( 0, pTurbine / ( fEffAdjFact * fEff * ( hCurrent * pDP->fConvFactor ) ) ); /* sanity check */
 	int bDischExceedsMax = ( qCurrent > qMax );
 #else /* ENABLE_NEW_CALCS */
-	FLOAT pMax = gpTurbs[ uTurb ].fMaxPower;
-	FLOAT qMax = gpTurbs[ uTurb ].fMaxFlow;
-	FLOAT hRated = gpTurbs[ uTurb ].fRatedHead;
-	FLOAT fGenEfficiency = gpTurbs[ uTurb ].fGenEfficiency;
-	FLOAT pAtSpindle = pCurrent * ( 1.0 + gfPlantLossCoef ) * ( 2.0 - fGenEfficiency );
+	FLOAT pMax = pDP->pTurbs[ uTurb ].fMaxPower;
+	FLOAT qMax = pDP->pTurbs[ uTurb ].fMaxFlow;
+	FLOAT hRated = pDP->pTurbs[ uTurb ].fRatedHead;
+	FLOAT fGenEfficiency = pDP->pTurbs[ uTurb ].fGenEfficiency;
+	FLOAT pAtSpindle = pCurrent * ( 1.0 + pDP->fPlantLossCoef ) * ( 2.0 - fGenEfficiency );
 #ifdef ENABLE_NEWHEADSCALING
-	FLOAT hNet = hRated - hCurrent - gpTurbs[ uTurb ].fHeadloss;
+	FLOAT hNet = hRated - hCurrent - pDP->pTurbs[ uTurb ].fHeadloss;
 	FLOAT hScaling = ( 1 + (hNet > hRated ? +0.5 : -0.5) * powf( hNet / hRated, 2.0 ) );
 #else // ENABLE_NEWHEADSCALING
 	FLOAT hScaling = powf( (hCurrent / hRated), 1.5 );
 #endif // ENABLE_NEWHEADSCALING
 	FLOAT pAtRatedHead = pAtSpindle / hScaling;
 	int bPowExceedsMax = ( pAtRatedHead > pMax );
-	FLOAT fEff = turbine_eff_from_pfact( uTurb, pAtRatedHead / pMax );
+	FLOAT fEff = turbine_eff_from_pfact( pDP, uTurb, pAtRatedHead / pMax );
 	FLOAT qCurrent = 0;
 	FLOAT fTol = 1E-3; /* 0.1% */
 	int bEffSmallerThanTol = ( fEff < fTol );
-	qCurrent = bEffSmallerThanTol ? 0 : ( pAtSpindle / ( fEff * ( hScaling * ( hCurrent * gfConvFactor ) ) ) );
+	qCurrent = bEffSmallerThanTol ? 0 : ( pAtSpindle / ( fEff * ( hScaling * ( hCurrent * pDP->fConvFactor ) ) ) );
 	int bDischExceedsMax = ( qCurrent > qMax );
 #endif /* ENABLE_NEW_CALCS */
-	/* check flags */
-	if( guDebugMode )
+	if( pu8Condition )
 	{
-		if( bPowExceedsMax )
-		{
-			char* szPower = char_units( DP_UNIT_POWER );
-			char* szLength = char_units( DP_UNIT_LENGTH );
-			fprintf( stdout, "condition on unit %s: %f %s at %f %s exceeds maximum rating (%f %s at %f %s).\n",
-					gpTurbs[ uTurb ].szName,
-					pTurbine, szPower,
-					hCurrent, szLength,
-					pMax, szPower,
-					hRated, szLength );
-		}
-		if( bEffSmallerThanTol )
-		{
-			char* szPower = char_units( DP_UNIT_POWER );
-			char* szLength = char_units( DP_UNIT_LENGTH );
-			fprintf( stdout, "condition on unit %s: efficiency of %f at %f %s too low for rating of %f %s at %f %s.\n",
-					gpTurbs[ uTurb ].szName,
-					fEff,
-					pCurrent, szPower,
-					pTurbine, szPower,
-					hRated, szLength );
-		}
-		if( bDischExceedsMax )
-		{
-			char* szFlow = char_units( DP_UNIT_FLOW );
-			char* szLength = char_units( DP_UNIT_LENGTH );
-			fprintf( stdout, "condition on unit %s: %f %s at %f %s exceeds maximum rating (%f %s at %f %s).\n",
-					gpTurbs[ uTurb ].szName,
-					qCurrent, szFlow,
-					hCurrent, szLength,
-					qMax, szFlow,
-					hRated, szLength );
-		}
+		*pu8Condition = (UINT8)( ( bDischExceedsMax ? DP_CONDITION_DISCH_EXCEEDS_MAX : 0 ) |
+			( bEffSmallerThanTol ? DP_CONDITION_EFF_BELOW_TOL : 0 ) | ( bPowExceedsMax ? DP_CONDITION_POW_EXCEEDS_MAX : 0 ) );
 	}
 #ifdef ENABLE_INLINE_NUMERICAL_CLEANUP
 	return ( isnanf( qCurrent ) || isinff( qCurrent ) ? 0 : qCurrent );
@@ -1604,43 +2384,44 @@ DP_INLINE FLOAT turbine_discharge( UINT32 uTurb, FLOAT hCurrent, FLOAT pCurrent
 
 /*****************/
 
-void turbine_test()
+void turbine_test( DPContext* pDP )
 {
 	UINT32 uTurb = 0;
 
-	ui_parse_units( "cfs" );
-	turbine_register( "TestUnit1", "Kaplan", 220 /*ft*/, 8673 /*cfs*/, 167000 /*kw*/ ); // high head project
+	ui_parse_units( pDP, "cfs" );
+	turbine_register( pDP, "TestUnit1", "Kaplan", 220 /*ft*/, 8673 /*cfs*/, 167000 /*kw*/ ); // high head project
 
 	/* ensure increasing head increases power at the same discharge */
 	{
-		FLOAT p1 = turbine_power( uTurb, (1.0 * gpTurbs[ uTurb ].fRatedHead), (0.75 * gpTurbs[ uTurb ].fMaxFlow) );
-		FLOAT p2 = turbine_power( uTurb, (1.1 * gpTurbs[ uTurb ].fRatedHead), (0.75 * gpTurbs[ uTurb ].fMaxFlow) );
+		FLOAT p1 = turbine_power( pDP, uTurb, (1.0 * pDP->pTurbs[ uTurb ].fRatedHead), (0.75 * pDP->pTurbs[ uTurb ].fMaxFlow), 0 );
+		FLOAT p2 = turbine_power( pDP, uTurb, (1.1 * pDP->pTurbs[ uTurb ].fRatedHead), (0.75 * pDP->pTurbs[ uTurb ].fMaxFlow), 0 );
 		if( p2 < p1 || isnanf(p2) || isnanf(p1) )
 		{
 			sprintf( gcPrintBuff, "%s:%d (" VERSIONED_NAME  ") Turbine_test fails\n", __FILE__, __LINE__ );
 			PRINT_STDERR( gcPrintBuff );
-			dp_cleanup_fatal();
+			dp_cleanup_fatal( pDP );
 		}
 	}
 
 	/* ensure increasing head decreases discharge at the same power */
 	{
-		FLOAT q1 = turbine_discharge( uTurb, (1.0 * gpTurbs[ uTurb ].fRatedHead), (0.75 * gpTurbs[ uTurb ].fMaxPower) );
-		FLOAT q2 = turbine_discharge( uTurb, (1.1 * gpTurbs[ uTurb ].fRatedHead), (0.75 * gpTurbs[ uTurb ].fMaxPower) );
+		FLOAT q1 = turbine_discharge( pDP, uTurb, (1.0 * pDP->pTurbs[ uTurb ].fRatedHead), (0.75 * pDP->pTurbs[ uTurb ].fMaxPower), 0 );
+		FLOAT q2 = turbine_discharge( pDP, uTurb, (1.1 * pDP->pTurbs[ uTurb ].fRatedHead), (0.75 * pDP->pTurbs[ uTurb ].fMaxPower), 0 );
 		if( q2 > q1 || isnanf(q2) || isnanf(q1) )
 		{
 			sprintf( gcPrintBuff, "%s:%d (" VERSIONED_NAME  ") Turbine_test fails\n", __FILE__, __LINE__ );
 			PRINT_STDERR( gcPrintBuff );
-			dp_cleanup_fatal();
+			dp_cleanup_fatal( pDP );
 		}
 	}
 
 	/* TODO: construct test for far side of efficiency curve... */
 
-	ui_parse_units( 0 );
-	guTurbs = 0;
+	ui_parse_units( pDP, 0 );
+	pDP->uTurbs = 0;
+	pDP->uHKRows = 0;
 
-	if( guDebugMode )
+	if( pDP->uDebugMode )
 	{
 		sprintf( gcPrintBuff, "%s:%d (" VERSIONED_NAME  ") Turbine_test complete\n", __FILE__, __LINE__ );
 		PRINT_STDERR( gcPrintBuff );
@@ -1649,55 +2430,154 @@ void turbine_test()
 
 /*********************************************/
 
-DP_INLINE void arr_turbine_hk_and_q( UINT32 uTurb, FLOAT h, FLOAT* pHK, FLOAT* pFlo, FLOAT* pPowStates, UINT32 n )
+#define TURBINE_BATCH (16) /* steps per kernel pass, wide enough for the simd units */
+
+#if defined(ENABLE_NEW_CALCS) && defined(ENABLE_NEW_DYNLOSS)
+
+/* batched turbine_power. the curve lookups are gathered per step, the arithmetic
+ * between them is straight-line over the batch.
+ */
+DP_INLINE void arr_turbine_p_batch( DPContext* pDP, UINT32 uTurb, FLOAT h, FLOAT* pPow, UINT8* pu8Cond, FLOAT* pFlo, UINT32 n )
+{
+	TurbineDef* pTurb = &pDP->pTurbs[ uTurb ];
+	CurveDef* pCurve = &pDP->pCurves[ pTurb->uCurveNum ];
+	CurveDef* pGenCurve = ( pTurb->uGenCurveNum != MAX_UINT32 ) ? &pDP->pCurves[ pTurb->uGenCurveNum ] : 0;
+	FLOAT qMax = pTurb->fMaxFlow;
+	FLOAT pMax = pTurb->fMaxPower;
+	FLOAT hRated = pTurb->fRatedHead;
+	FLOAT hLossCoef = pTurb->fHeadloss;
+	FLOAT fConvFactor = pDP->fConvFactor;
+	double dPlantEff = 1.0 - pDP->fPlantLossCoef;
+	FLOAT fTol = 1E-6;
+	FLOAT afFact[ TURBINE_BATCH ], afEff[ TURBINE_BATCH ], afGenEff[ TURBINE_BATCH ];
+	UINT32 i, j, m;
+
+	for( i = 0; i < n; i += TURBINE_BATCH )
+	{
+		FLOAT* pq = &pFlo[ i ];
+		m = MIN( TURBINE_BATCH, n - i );
+		for( j = 0; j < m; j++ ) { afFact[ j ] = pq[ j ] / qMax; }
+		for( j = 0; j < m; j++ ) { afEff[ j ] = curve_grid_eff( &pCurve->sFloGrid, pCurve->pfFloFact, pCurve->pfEffFact, pCurve->uPoints, afFact[ j ] ); }
+		if( pGenCurve ) {
+			for( j = 0; j < m; j++ ) { afGenEff[ j ] = curve_grid_eff( &pGenCurve->sFloGrid, pGenCurve->pfFloFact, pGenCurve->pfEffFact, pGenCurve->uPoints, afFact[ j ] ); }
+		} else {
+			for( j = 0; j < m; j++ ) { afGenEff[ j ] = pTurb->fGenEfficiency; }
+		}
+		for( j = 0; j < m; j++ )
+		{
+			FLOAT q = pq[ j ];
+			FLOAT hNet = h - hLossCoef * ( afFact[ j ] * afFact[ j ] );
+			FLOAT fGeneratorAndYardLoss = dPlantEff * afGenEff[ j ];
+			FLOAT p = MAX( 0, float_EffAdjFactor( hNet, hRated, 2.0 ) * afEff[ j ] * ( q * h * fConvFactor ) * fGeneratorAndYardLoss );
+			UINT8 u8Cond = (UINT8)( ( q > qMax ) * DP_CONDITION_DISCH_EXCEEDS_MAX | ( afEff[ j ] < 1E-3f ) * DP_CONDITION_EFF_BELOW_TOL | ( p > pMax ) * DP_CONDITION_POW_EXCEEDS_MAX );
+			p = ( isnanf( p ) || isinff( p ) ) ? 0 : p;
+			pPow[ i + j ] = ( q < fTol ) ? 0 : p;
+			pu8Cond[ i + j ] = ( q < fTol ) ? 0 : u8Cond;
+		}
+	}
+}
+
+/* batched turbine_discharge, as arr_turbine_p_batch */
+DP_INLINE void arr_turbine_q_batch( DPContext* pDP, UINT32 uTurb, FLOAT h, FLOAT* pFlo, UINT8* pu8Cond, FLOAT* pPow, UINT32 n )
+{
+	TurbineDef* pTurb = &pDP->pTurbs[ uTurb ];
+	CurveDef* pCurve = &pDP->pCurves[ pTurb->uCurveNum ];
+	CurveDef* pGenCurve = ( pTurb->uGenCurveNum != MAX_UINT32 ) ? &pDP->pCurves[ pTurb->uGenCurveNum ] : 0;
+	FLOAT pMax = pTurb->fMaxPower;
+	FLOAT qMax = pTurb->fMaxFlow;
+	FLOAT hRated = pTurb->fRatedHead;
+	FLOAT hLossCoef = pTurb->fHeadloss;
+	FLOAT fHeadConv = h * pDP->fConvFactor;
+	double dPlantEff = 1.0 - pDP->fPlantLossCoef;
+	FLOAT fTol = 1E-6;
+	FLOAT afFact[ TURBINE_BATCH ], afEff[ TURBINE_BATCH ], afGenEff[ TURBINE_BATCH ], afTurbine[ TURBINE_BATCH ];
+	UINT32 i, j, m;
+
+	for( i = 0; i < n; i += TURBINE_BATCH )
+	{
+		FLOAT* pp = &pPow[ i ];
+		m = MIN( TURBINE_BATCH, n - i );
+		for( j = 0; j < m; j++ ) { afFact[ j ] = pp[ j ] / pMax; }
+		if( pGenCurve ) {
+			for( j = 0; j < m; j++ ) { afGenEff[ j ] = curve_grid_eff( &pGenCurve->sFloGrid, pGenCurve->pfFloFact, pGenCurve->pfEffFact, pGenCurve->uPoints, afFact[ j ] ); } /* note: approx */
+		} else {
+			for( j = 0; j < m; j++ ) { afGenEff[ j ] = pTurb->fGenEfficiency; }
+		}
+		for( j = 0; j < m; j++ )
+		{
+			FLOAT fGeneratorAndYardLoss = dPlantEff * afGenEff[ j ];
+			afTurbine[ j ] = pp[ j ] / fGeneratorAndYardLoss;
+		}
+		for( j = 0; j < m; j++ ) { afEff[ j ] = curve_grid_eff( &pCurve->sPowGrid, pCurve->pfPowFact, pCurve->pfEffFact, pCurve->uPoints, afTurbine[ j ] / pMax ); }
+		for( j = 0; j < m; j++ )
+		{
+			FLOAT hNet = h - hLossCoef * ( afFact[ j ] * afFact[ j ] );
+			FLOAT q = MAX( 0, afTurbine[ j ] / ( float_EffAdjFactor( hNet, hRated, 2.0 ) * afEff[ j ] * fHeadConv ) );
+			UINT8 u8Cond = (UINT8)( ( q > qMax ) * DP_CONDITION_DISCH_EXCEEDS_MAX | ( afEff[ j ] < 1E-3f ) * DP_CONDITION_EFF_BELOW_TOL | ( afTurbine[ j ] > pMax ) * DP_CONDITION_POW_EXCEEDS_MAX );
+			q = ( isnanf( q ) || isinff( q ) ) ? 0 : q;
+			pFlo[ i + j ] = ( pp[ j ] < fTol ) ? 0 : q;
+			pu8Cond[ i + j ] = ( pp[ j ] < fTol ) ? 0 : u8Cond;
+		}
+	}
+}
+
+#endif /* defined(ENABLE_NEW_CALCS) && defined(ENABLE_NEW_DYNLOSS) */
+
+/* pu8Cond receives the DP_CONDITION_ bits of each step */
+DP_INLINE void arr_turbine_p( DPContext* pDP, UINT32 uTurb, FLOAT h, FLOAT* pPow, UINT8* pu8Cond, FLOAT* pFloStates, UINT32 n )
 {
+#if defined(ENABLE_NEW_CALCS) && defined(ENABLE_NEW_DYNLOSS)
+	arr_turbine_p_batch( pDP, uTurb, h, pPow, pu8Cond, pFloStates, n );
+#else
 	FLOAT fTol = 1E-6;
 	UINT32 i = 0;
-	FLOAT q, p;
+	FLOAT q;
 	for( i=0; i<n; i++ )
 	{
-		p = pPowStates[ i ];
-		q = (p < fTol) ? 0 : turbine_discharge( uTurb, h, p ); // check degenerate case
-		pHK[ i ] = ( q < fTol ) ? 0 : p / q; // handle DivByZero
-		pFlo[ i ] = q;
+		q = pFloStates[ i ];
+		pu8Cond[ i ] = 0;
+		pPow[ i ] = (q < fTol) ? 0 : turbine_power( pDP, uTurb, h, q, &pu8Cond[ i ] ); // check degenerate case
 	}
+#endif
 }
 
-DP_INLINE void arr_turbine_hk_and_p( UINT32 uTurb, FLOAT h, FLOAT* pHK, FLOAT* pPow, FLOAT* pFloStates, UINT32 n )
+/* pu8Cond receives the DP_CONDITION_ bits of each step */
+DP_INLINE void arr_turbine_q( DPContext* pDP, UINT32 uTurb, FLOAT h, FLOAT* pFlo, UINT8* pu8Cond, FLOAT* pPowStates, UINT32 n )
 {
+#if defined(ENABLE_NEW_CALCS) && defined(ENABLE_NEW_DYNLOSS)
+	arr_turbine_q_batch( pDP, uTurb, h, pFlo, pu8Cond, pPowStates, n );
+#else
 	FLOAT fTol = 1E-6;
 	UINT32 i = 0;
-	FLOAT q, p;
+	FLOAT p;
 	for( i=0; i<n; i++ )
 	{
-		q = pFloStates[ i ];
-		p = (q < fTol) ? 0 : turbine_power( uTurb, h, q ); // check degenerate case
-		pHK[ i ] = ( q < fTol ) ? 0 : p / q; // handle DivByZero
-		pPow[ i ] = p;
+		p = pPowStates[ i ];
+		pu8Cond[ i ] = 0;
+		pFlo[ i ] = (p < fTol) ? 0 : turbine_discharge( pDP, uTurb, h, p, &pu8Cond[ i ] ); // check degenerate case
 	}
+#endif
 }
 
-DP_INLINE void arr_turbine_p( UINT32 uTurb, FLOAT h, FLOAT* pPow, FLOAT* pFloStates, UINT32 n )
+DP_INLINE void arr_turbine_hk_and_q( DPContext* pDP, UINT32 uTurb, FLOAT h, FLOAT* pHK, FLOAT* pFlo, UINT8* pu8Cond, FLOAT* pPowStates, UINT32 n )
 {
 	FLOAT fTol = 1E-6;
 	UINT32 i = 0;
-	FLOAT q;
+	arr_turbine_q( pDP, uTurb, h, pFlo, pu8Cond, pPowStates, n );
 	for( i=0; i<n; i++ )
 	{
-		q = pFloStates[ i ];
-		pPow[ i ] = (q < fTol) ? 0 : turbine_power( uTurb, h, q ); // check degenerate case
+		pHK[ i ] = ( pFlo[ i ] < fTol ) ? 0 : pPowStates[ i ] / pFlo[ i ]; // handle DivByZero
 	}
 }
 
-DP_INLINE void arr_turbine_q( UINT32 uTurb, FLOAT h, FLOAT* pFlo, FLOAT* pPowStates, UINT32 n )
+DP_INLINE void arr_turbine_hk_and_p( DPContext* pDP, UINT32 uTurb, FLOAT h, FLOAT* pHK, FLOAT* pPow, UINT8* pu8Cond, FLOAT* pFloStates, UINT32 n )
 {
 	FLOAT fTol = 1E-6;
 	UINT32 i = 0;
-	FLOAT p;
+	arr_turbine_p( pDP, uTurb, h, pPow, pu8Cond, pFloStates, n );
 	for( i=0; i<n; i++ )
 	{
-		p = pPowStates[ i ];
-		pFlo[ i ] = (p < fTol) ? 0 : turbine_discharge( uTurb, h, p ); // check degenerate case
+		pHK[ i ] = ( pFloStates[ i ] < fTol ) ? 0 : pPow[ i ] / pFloStates[ i ]; // handle DivByZero
 	}
 }
 
@@ -1706,95 +2586,47 @@ DP_INLINE void arr_turbine_q( UINT32 uTurb, FLOAT h, FLOAT* pFlo, FLOAT* pPowSta
 INT32 giInteractiveMode = 0;
 UINT32 guTransposeSolution = 0;
 CHAR gcOutputDelimiter = ' ';
-EXTERNC UINT32 guWeightCode = DP_WEIGHT_DEFAULT;
-
-EXTERNC UINT32 guSolveMode = 0; /* which problem are we solving? */
-EXTERNC FLOAT gfHeadCurr = 1.0; /**/
-
-EXTERNC UINT32 guUserStepCount; /* number of objective function discretizations */
-EXTERNC UINT32 guProblemStepCount; /* adjusted number of objective function discretizations */
-
-FLOAT gfSolutionDelta; /* determined from guProblemStepCount and the sizes of the units */
-FLOAT gfOtherSolutionDelta;
-
-EXTERNC UINT32 guStages; /* simply, number of units */
-EXTERNC UINT32 guStates; /* number of solution discretizations */
-
-FLOAT gfStateMin, gfStateMax;
-
-/* a cache of the objective function values for each stage and statestep */
-FLOAT* gpfFlowAllocations = 0; /* [ states ] */
-FLOAT* gpfPowerAllocations = 0; /* [ stages, steps ] */
-FLOAT* gpfHKTableValues = 0; /* [ stages, steps ] */
-
-/* a matrix that accumulates the allocation decisions. reevaluated for each scenario until the global decision matrix is filled */
-FLOAT* gpfScenarioDecisionValues = 0; /* [ states, states ] but actually triangular */ /* THE BIG KAHUNA */
-UINT16* gpu16ScenarioDecisionStates = 0;
-UINT8* gpu8ScenarioDecisionCounts = 0;
-
-/* these are the accumulated value of particular state decisions made in the current stage */
-UINT16* gpu16StateOfMax = 0; /* [ states ] but also known as [ scenario ] */
-FLOAT* gpfValueOfMax = 0; /* [ states ] but also known as [ scenario ] */
-UINT8* gpu8CountOfMax = 0; /* [ states ] but also known as [ scenario ] */
-
-EXTERNC FLOAT* gpfSolutionAllocations = 0; /* [ states ] */
-EXTERNC FLOAT* gpfOtherSolutionAllocations = 0; /* [ states ] */
-EXTERNC FLOAT* gpfHKSolutionAverages = 0; /* [ states ] */
-
-/* the final decision matrices holding the allocations */
-FLOAT* gpfGlobalDecisionValues = 0; /* [ stages, states ] */
-UINT8* gpu8GlobalDecisionCounts = 0; /* [ stages, states ] */
-UINT16* gpu16GlobalDecisionStateMap = 0; /* [ stages, states ] */
-FLOAT* gpfGlobalDecisionAllocations = 0; /* [ stages, states ] */
-
-UINT16* gpu16Solution = 0; /* [ stages, states ] */
-EXTERNC FLOAT* gpfSolution = 0; /* [ stages, states ] */
-EXTERNC FLOAT* gpfOtherSolution = 0; /* [ stages, states ] */
-EXTERNC FLOAT* gpfHKSolution = 0; /* [ stages, states ] */
-
-UINT16* gpu16LocalNearOptimumStates = 0; /* [ stages ] */
-UINT16* gpu16LocalMaximumStates = 0; /* [ stages ] */
-UINT16* gpu16LocalOptimumStates = 0; /* [ stages ] */
-UINT8* gpu8StageChecklist = 0; /* [ stages ] */
-UINT8* gpu8StageChecklistCopy = 0; /* [ stages ] */
-
-UINT16* gpu16LocalDecisions = 0; /* [ states ] */
-FLOAT* gpfStageMetric = 0; /* [ states ] */
-UINT16* gpu16StageMap = 0; /* [ stages ] */
-
-/************/
-
-/* [0] == total of faceplate capacities, head-adjusted and adjusted for overcapacity */
-/* [1] == total of faceplate capacities and adjusted for overcapacity */
-/* [2] == total of faceplate capacities */
-FLOAT gfTotalPower[ 3 ], gfTotalFlow[ 3 ]; /* max plant power output */
-
-/* [0] == faceplate capacity, head-adjusted and adjusted for overcapacity */
-/* [1] == faceplate capacities, adjusted for overcapacity */
-/* [2] == faceplate capacities */
-FLOAT gfMaxPower[ 3 ], gfMaxFlow[ 3 ]; /* max plant discharge */
-FLOAT gfMinMaxPower[ 3 ], gfMinMaxFlow[ 3 ]; /* largest output of the smallest unit */
 
 /**********************************************/
 
-EXTERNC void dp_assign_weights()
+/* identical units, weights included since the HK rows are weighted, share one row of the HK tables */
+void dp_assign_rows( DPContext* pDP )
+{
+	UINT32 uTurb, uPrev;
+	pDP->uHKRows = 0;
+	for( uTurb = 0; uTurb < pDP->uTurbs; uTurb++ )
+	{
+		TurbineDef* pTurb = &pDP->pTurbs[ uTurb ];
+		for( uPrev = 0; uPrev < uTurb; uPrev++ )
+		{
+			TurbineDef* pPrev = &pDP->pTurbs[ uPrev ];
+			if( pPrev->uCurveNum == pTurb->uCurveNum && pPrev->uGenCurveNum == pTurb->uGenCurveNum &&
+				pPrev->fRatedHead == pTurb->fRatedHead && pPrev->fMaxFlow == pTurb->fMaxFlow && pPrev->fMaxPower == pTurb->fMaxPower &&
+				pPrev->fWeight == pTurb->fWeight && pPrev->fHeadloss == pTurb->fHeadloss &&
+				pPrev->fGenCapacity == pTurb->fGenCapacity && pPrev->fGenEfficiency == pTurb->fGenEfficiency ) { break; }
+		}
+		pTurb->uHKRow = ( uPrev < uTurb ) ? pDP->pTurbs[ uPrev ].uHKRow : pDP->uHKRows++;
+	}
+}
+
+EXTERNC void dp_assign_weights( DPContext* pDP )
 {
 	FLOAT fTol = 1E-6;
 	UINT32 uTurb, u;
 
 	/* determine largest unit and total sum */
-	gfMaxPower[0] = gfMaxFlow[0] = gfMaxPower[1] = gfMaxFlow[1] = 0;
-	gfMinMaxPower[0] = gfMinMaxFlow[0] = gfMinMaxPower[1] = gfMinMaxFlow[1] = 9e9; // big float
-	gfTotalPower[0] = gfTotalFlow[0] = gfTotalPower[1] = gfTotalFlow[1] = 0;
+	pDP->fMaxPower[0] = pDP->fMaxFlow[0] = pDP->fMaxPower[1] = pDP->fMaxFlow[1] = 0;
+	pDP->fMinMaxPower[0] = pDP->fMinMaxFlow[0] = pDP->fMinMaxPower[1] = pDP->fMinMaxFlow[1] = 9e9; // big float
+	pDP->fTotalPower[0] = pDP->fTotalFlow[0] = pDP->fTotalPower[1] = pDP->fTotalFlow[1] = 0;
 
-	for( uTurb=0; uTurb<guTurbs; uTurb++ )
+	for( uTurb=0; uTurb<pDP->uTurbs; uTurb++ )
 	{
 		FLOAT p[3], q[3];
 
-		p[0] = turbine_maxpower_at_currenthead( uTurb, gfHeadCurr );
-		p[1] = p[2] = gpTurbs[ uTurb ].fMaxPower;
-		q[0] = turbine_maxdischarge_at_currenthead( uTurb, gfHeadCurr );
-		q[1] = q[2] = gpTurbs[ uTurb ].fMaxFlow;
+		p[0] = turbine_maxpower_at_currenthead( pDP, uTurb, pDP->fHeadCurr );
+		p[1] = p[2] = pDP->pTurbs[ uTurb ].fMaxPower;
+		q[0] = turbine_maxdischarge_at_currenthead( pDP, uTurb, pDP->fHeadCurr );
+		q[1] = q[2] = pDP->pTurbs[ uTurb ].fMaxFlow;
 
 		for( u = 0; u < 3; u++ )
 		{
@@ -1802,28 +2634,28 @@ EXTERNC void dp_assign_weights()
 			FLOAT fQCapFact = 1.0;
 
 #ifdef ENABLE_CAPACITY_SCALING
-			fPCapFact = u == 2 ? 1 : gpTurbs[ uTurb ].fGenCapacity;
-			fQCapFact = u == 2 ? 1 : gpTurbs[ uTurb ].fGenCapacity;
+			fPCapFact = u == 2 ? 1 : pDP->pTurbs[ uTurb ].fGenCapacity;
+			fQCapFact = u == 2 ? 1 : pDP->pTurbs[ uTurb ].fGenCapacity;
 #endif // ENABLE_CAPACITY_SCALING
 
 			/* bounds check */
-			p[u] = ( gpTurbs[ uTurb ].fMaxPower < fTol ) ? 0 : p[u];
-			q[u] = ( gpTurbs[ uTurb ].fMaxFlow < fTol ) ? 0 : q[u];
+			p[u] = ( pDP->pTurbs[ uTurb ].fMaxPower < fTol ) ? 0 : p[u];
+			q[u] = ( pDP->pTurbs[ uTurb ].fMaxFlow < fTol ) ? 0 : q[u];
 
 			/* determine max and min over all units by taking into
 			 * account any allowable over-capacity factor.
 			 */
-			gfMaxPower[u] = MAX( p[u] * fPCapFact, gfMaxPower[u] );
-			if( fPCapFact > fTol ) { gfMinMaxPower[u] = MIN( p[u] * fPCapFact, gfMinMaxPower[u] ); }
-			gfMaxFlow[u] = MAX( q[u] * fQCapFact, gfMaxFlow[u] );
-			if( fQCapFact > fTol ) { gfMinMaxFlow[u] = MIN( q[u] * fQCapFact, gfMinMaxFlow[u] ); }
+			pDP->fMaxPower[u] = MAX( p[u] * fPCapFact, pDP->fMaxPower[u] );
+			if( fPCapFact > fTol ) { pDP->fMinMaxPower[u] = MIN( p[u] * fPCapFact, pDP->fMinMaxPower[u] ); }
+			pDP->fMaxFlow[u] = MAX( q[u] * fQCapFact, pDP->fMaxFlow[u] );
+			if( fQCapFact > fTol ) { pDP->fMinMaxFlow[u] = MIN( q[u] * fQCapFact, pDP->fMinMaxFlow[u] ); }
 
 #ifdef ENABLE_NEW_CALCS
-			gfTotalPower[u] += p[u] * fPCapFact;
-			gfTotalFlow[u] += q[u] * fQCapFact;
+			pDP->fTotalPower[u] += p[u] * fPCapFact;
+			pDP->fTotalFlow[u] += q[u] * fQCapFact;
 #else /* ENABLE_NEW_CALCS */
-			gfTotalPower[u] += p[u];
-			gfTotalFlow[u] += q[u];
+			pDP->fTotalPower[u] += p[u];
+			pDP->fTotalFlow[u] += q[u];
 #endif /* ENABLE_NEW_CALCS */
 		}
 	}
@@ -1831,139 +2663,228 @@ EXTERNC void dp_assign_weights()
 	/* scale total, max & mimax values to preserve only specified number of sigfigs */
 	for( u = 0; u < 2; u++ )
 	{
-		gfMaxPower[u] = float_round( gfMaxPower[u], DP_CONFIG_SIGFIGS );
-		gfMaxFlow[u] = float_round( gfMaxFlow[u], DP_CONFIG_SIGFIGS );
-		gfMinMaxPower[u] = float_round( gfMinMaxPower[u], DP_CONFIG_SIGFIGS );
-		gfMinMaxFlow[u] = float_round( gfMinMaxFlow[u], DP_CONFIG_SIGFIGS );
-		gfTotalPower[u] = float_round( gfTotalPower[u], DP_CONFIG_SIGFIGS );
-		gfTotalFlow[u] = float_round( gfTotalFlow[u], DP_CONFIG_SIGFIGS );
+		pDP->fMaxPower[u] = float_round( pDP->fMaxPower[u], DP_CONFIG_SIGFIGS );
+		pDP->fMaxFlow[u] = float_round( pDP->fMaxFlow[u], DP_CONFIG_SIGFIGS );
+		pDP->fMinMaxPower[u] = float_round( pDP->fMinMaxPower[u], DP_CONFIG_SIGFIGS );
+		pDP->fMinMaxFlow[u] = float_round( pDP->fMinMaxFlow[u], DP_CONFIG_SIGFIGS );
+		pDP->fTotalPower[u] = float_round( pDP->fTotalPower[u], DP_CONFIG_SIGFIGS );
+		pDP->fTotalFlow[u] = float_round( pDP->fTotalFlow[u], DP_CONFIG_SIGFIGS );
 	}
 
 	/* assign weights: use faceplate capacities */
-	for( uTurb=0; uTurb<guTurbs; uTurb++ )
+	for( uTurb=0; uTurb<pDP->uTurbs; uTurb++ )
 	{
-		FLOAT fW = gpTurbs[ uTurb ].fWeight;
-		switch( guWeightCode & DP_WEIGHT_CODEMASK )
+		FLOAT fW = pDP->pTurbs[ uTurb ].fWeight;
+		switch( pDP->uWeightCode & DP_WEIGHT_CODEMASK )
 		{
 			case DP_WEIGHT_DEFAULT: /* do nothing */ break;
 			case DP_WEIGHT_EQUAL: fW = 1.0; break;
-			case DP_WEIGHT_MAXPOWER: fW = gpTurbs[ uTurb ].fMaxPower; break;
-			case DP_WEIGHT_MAXFLOW: fW = gpTurbs[ uTurb ].fMaxFlow; break;
-			case DP_WEIGHT_MINPOWER: fW = gfTotalPower[1] - gpTurbs[ uTurb ].fMaxPower; break;
-			case DP_WEIGHT_MINFLOW: fW = gfTotalFlow[1] - gpTurbs[ uTurb ].fMaxFlow; break;
+			case DP_WEIGHT_MAXPOWER: fW = pDP->pTurbs[ uTurb ].fMaxPower; break;
+			case DP_WEIGHT_MAXFLOW: fW = pDP->pTurbs[ uTurb ].fMaxFlow; break;
+			case DP_WEIGHT_MINPOWER: fW = pDP->fTotalPower[1] - pDP->pTurbs[ uTurb ].fMaxPower; break;
+			case DP_WEIGHT_MINFLOW: fW = pDP->fTotalFlow[1] - pDP->pTurbs[ uTurb ].fMaxFlow; break;
 			default: ;
 		}
-		if( guWeightCode & DP_WEIGHT_RELATIVE )
+		if( pDP->uWeightCode & DP_WEIGHT_RELATIVE )
 		{
-			switch( guWeightCode )
+			switch( pDP->uWeightCode )
 			{
 				case DP_WEIGHT_DEFAULT: break;
 				case DP_WEIGHT_EQUAL: break;
 				case DP_WEIGHT_MAXPOWER: /* fallthrough */
-				case DP_WEIGHT_MINPOWER: fW /= gfTotalPower[1]; break;
+				case DP_WEIGHT_MINPOWER: fW /= pDP->fTotalPower[1]; break;
 				case DP_WEIGHT_MAXFLOW: /* fallthrough */
-				case DP_WEIGHT_MINFLOW: fW /= gfTotalFlow[1]; break;
+				case DP_WEIGHT_MINFLOW: fW /= pDP->fTotalFlow[1]; break;
 				default: ;
 			}
 		}
 
-		fW = ( gpTurbs[ uTurb ].fMaxPower < fTol || gpTurbs[ uTurb ].fMaxFlow < fTol ) ? 0 : fW;
-		gpTurbs[ uTurb ].fWeight = fW;
+		fW = ( pDP->pTurbs[ uTurb ].fMaxPower < fTol || pDP->pTurbs[ uTurb ].fMaxFlow < fTol ) ? 0 : fW;
+		pDP->pTurbs[ uTurb ].fWeight = fW;
 	}
+
+	/* units without a weight are left out of the solve, see dp */
+	pDP->uActiveStages = 0;
+	for( uTurb = 0; uTurb < pDP->uTurbs; uTurb++ ) { pDP->uActiveStages += ( pDP->pTurbs[ uTurb ].fWeight < fTol ) ? 0 : 1; }
+
+	dp_assign_rows( pDP );
 }
 
-void dp_print_weights()
+void dp_print_weights( DPContext* pDP )
 {
 	UINT32 uTurb;
-	for( uTurb = 0; uTurb < guTurbs; uTurb++ )
+	for( uTurb = 0; uTurb < pDP->uTurbs; uTurb++ )
 	{
-		fprintf( stdout, "weight %20s ", gpTurbs[ uTurb ].szName );
-		fprintf( stdout, float_format( gpTurbs[ uTurb ].fWeight ), gpTurbs[ uTurb ].fWeight );
+		fprintf( stdout, "weight %20s ", pDP->pTurbs[ uTurb ].szName );
+		fprintf( stdout, float_format( pDP->pTurbs[ uTurb ].fWeight ), pDP->pTurbs[ uTurb ].fWeight );
 		fprintf( stdout, "\n" );
 	}
 }
 
-void dp_print_weighting()
+void dp_print_weighting( DPContext* pDP )
 {
 	fprintf( stdout, "weighting " );
-	if(		 (guWeightCode & DP_WEIGHT_RELATIVE) )							fprintf( stdout, "relative " );
+	if(		 (pDP->uWeightCode & DP_WEIGHT_RELATIVE) )							fprintf( stdout, "relative " );
 	/**/
-	if( 	 (guWeightCode & DP_WEIGHT_CODEMASK) == DP_WEIGHT_DEFAULT )		fprintf( stdout, "default" );
-	else if( (guWeightCode & DP_WEIGHT_CODEMASK) == DP_WEIGHT_EQUAL )		fprintf( stdout, "equal" );
-	else if( (guWeightCode & DP_WEIGHT_CODEMASK) == DP_WEIGHT_MAXPOWER )	fprintf( stdout, "maxpower" );
-	else if( (guWeightCode & DP_WEIGHT_CODEMASK) == DP_WEIGHT_MAXFLOW )		fprintf( stdout, "maxflow" );
-	else if( (guWeightCode & DP_WEIGHT_CODEMASK) == DP_WEIGHT_MINPOWER )	fprintf( stdout, "minpower" );
-	else if( (guWeightCode & DP_WEIGHT_CODEMASK) == DP_WEIGHT_MINFLOW )		fprintf( stdout, "minflow" );
+	if( 	 (pDP->uWeightCode & DP_WEIGHT_CODEMASK) == DP_WEIGHT_DEFAULT )		fprintf( stdout, "default" );
+	else if( (pDP->uWeightCode & DP_WEIGHT_CODEMASK) == DP_WEIGHT_EQUAL )		fprintf( stdout, "equal" );
+	else if( (pDP->uWeightCode & DP_WEIGHT_CODEMASK) == DP_WEIGHT_MAXPOWER )	fprintf( stdout, "maxpower" );
+	else if( (pDP->uWeightCode & DP_WEIGHT_CODEMASK) == DP_WEIGHT_MAXFLOW )		fprintf( stdout, "maxflow" );
+	else if( (pDP->uWeightCode & DP_WEIGHT_CODEMASK) == DP_WEIGHT_MINPOWER )	fprintf( stdout, "minpower" );
+	else if( (pDP->uWeightCode & DP_WEIGHT_CODEMASK) == DP_WEIGHT_MINFLOW )		fprintf( stdout, "minflow" );
 	fprintf( stdout, "\n" );
 }
 
-void dp_print_config()
+/* uVerbose lists each flagged step, otherwise a count per unit */
+void dp_report_conditions( DPContext* pDP, UINT32 uVerbose )
+{
+	UINT32 uStage, uStep;
+	char* szFlow = char_units( pDP, DP_UNIT_FLOW );
+	char* szPower = char_units( pDP, DP_UNIT_POWER );
+	char* szLength = char_units( pDP, DP_UNIT_LENGTH );
+	if( pDP->pu8Conditions == 0 ) { return; } /* not solved */
+	for( uStage = 0; uStage < pDP->uStages; uStage++ )
+	{
+		TurbineDef* pTurb = &pDP->pTurbs[ uStage ];
+		UINT8* pu8Cond = &pDP->pu8Conditions[ DP_HK_ROW( pDP, uStage ) ];
+		FLOAT* pfFlo = &pDP->pfFlowAllocations[ DP_HK_ROW( pDP, uStage ) ];
+		FLOAT* pfPow = &pDP->pfPowerAllocations[ DP_HK_ROW( pDP, uStage ) ];
+		UINT32 uDisch = 0, uEff = 0, uPow = 0;
+		for( uStep = 0; uStep < pDP->uProblemStepCount; uStep++ )
+		{
+			UINT8 u8Cond = pu8Cond[ uStep ];
+			uDisch += ( u8Cond & DP_CONDITION_DISCH_EXCEEDS_MAX ) != 0;
+			uEff += ( u8Cond & DP_CONDITION_EFF_BELOW_TOL ) != 0;
+			uPow += ( u8Cond & DP_CONDITION_POW_EXCEEDS_MAX ) != 0;
+			if( !uVerbose ) { continue; }
+			if( u8Cond & DP_CONDITION_DISCH_EXCEEDS_MAX )
+			{
+				fprintf( stdout, "condition on unit %s: %f %s at %f %s exceeds maximum rating (%f %s at %f %s).\n",
+					pTurb->szName, pfFlo[ uStep ], szFlow, pDP->fHeadCurr, szLength, pTurb->fMaxFlow, szFlow, pTurb->fRatedHead, szLength );
+			}
+			if( u8Cond & DP_CONDITION_EFF_BELOW_TOL )
+			{
+				fprintf( stdout, "condition on unit %s: efficiency too low at %f %s and %f %s for rating of %f %s at %f %s.\n",
+					pTurb->szName, pfFlo[ uStep ], szFlow, pfPow[ uStep ], szPower, pTurb->fMaxPower, szPower, pTurb->fRatedHead, szLength );
+			}
+			if( u8Cond & DP_CONDITION_POW_EXCEEDS_MAX )
+			{
+				fprintf( stdout, "condition on unit %s: %f %s at %f %s exceeds maximum rating (%f %s at %f %s).\n",
+					pTurb->szName, pfPow[ uStep ], szPower, pDP->fHeadCurr, szLength, pTurb->fMaxPower, szPower, pTurb->fRatedHead, szLength );
+			}
+		}
+		if( !uVerbose )
+		{
+			fprintf( stdout, "conditions %20s discharge %lu efficiency %lu power %lu\n", pTurb->szName, uDisch, uEff, uPow );
+		}
+	}
+}
+
+void dp_print_config( DPContext* pDP )
 {
 	fprintf( stdout, "losscoef " );
-	fprintf( stdout, float_format( gfPlantLossCoef ), gfPlantLossCoef );
+	fprintf( stdout, float_format( pDP->fPlantLossCoef ), pDP->fPlantLossCoef );
 	fprintf( stdout, "coordinationfactora " );
-	fprintf( stdout, float_format( gfCoordinationFactorA ), gfCoordinationFactorA );
+	fprintf( stdout, float_format( pDP->fCoordinationFactorA ), pDP->fCoordinationFactorA );
 	fprintf( stdout, "coordinationfactorb " );
-	fprintf( stdout, float_format( gfCoordinationFactorB ), gfCoordinationFactorB );
+	fprintf( stdout, float_format( pDP->fCoordinationFactorB ), pDP->fCoordinationFactorB );
 
 	fprintf( stdout, " head " );
-	fprintf( stdout, float_format( gfHeadCurr ), gfHeadCurr );
-	fprintf( stdout, " %s ", char_units( DP_UNIT_LENGTH ) );
+	fprintf( stdout, float_format( pDP->fHeadCurr ), pDP->fHeadCurr );
+	fprintf( stdout, " %s ", char_units( pDP, DP_UNIT_LENGTH ) );
 	fprintf( stdout, " min " );
-	fprintf( stdout, float_format( gfStateMin ), gfStateMin );
-	fprintf( stdout, " %s ", char_units( DP_UNIT_FLOW ) );
+	fprintf( stdout, float_format( pDP->fStateMin ), pDP->fStateMin );
+	fprintf( stdout, " %s ", char_units( pDP, DP_UNIT_FLOW ) );
 	fprintf( stdout, " max " );
-	fprintf( stdout, float_format( gfStateMax ), gfStateMax );
-	fprintf( stdout, " %s ", char_units( DP_UNIT_FLOW ) );
+	fprintf( stdout, float_format( pDP->fStateMax ), pDP->fStateMax );
+	fprintf( stdout, " %s ", char_units( pDP, DP_UNIT_FLOW ) );
 	fprintf( stdout, " unitsteps " );
-	fprintf( stdout, "%lu\n", guUserStepCount );
+	fprintf( stdout, "%lu", pDP->uUserStepCount );
+	if( pDP->uBudgetMB ) { fprintf( stdout, " budget memory %lu", pDP->uBudgetMB ); }
+	if( pDP->uBudgetMs ) { fprintf( stdout, " budget time %lu", pDP->uBudgetMs ); }
+	fprintf( stdout, "\n" );
 }
 
 /* determine problem size */
-EXTERNC void dp_resize()
+/* wall clock, for the solve time predictions */
+double dp_clock_ms()
 {
-	ex_clear();
+#ifdef _WIN32
+	LARGE_INTEGER f, c;
+	QueryPerformanceFrequency( &f );
+	QueryPerformanceCounter( &c );
+	return (double)c.QuadPart * 1000.0 / (double)f.QuadPart;
+#else
+	struct timespec t;
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return t.tv_sec * 1000.0 + t.tv_nsec / 1e6;
+#endif
+}
+
+/* decision cells in the backpass, at most. the feasible region only makes it smaller. */
+FLOAT dp_plan_cells( DPContext* pDP )
+{
+	return (FLOAT)( MAX( pDP->uActiveStages, 1 ) - 1 ) * pDP->uStates * ( pDP->uStates + 1 ) / 2;
+}
+
+/* predicted workspace and solve time for the current sizing */
+void dp_plan( DPContext* pDP, UINT32* puBytes, FLOAT* pfMs )
+{
+	*puBytes = dp_arena_layout( pDP, 0, 0 ) + DP_ARENA_ALIGN;
+	*pfMs = dp_plan_cells( pDP ) * pDP->fCellNs / 1E6 / MAX( pDP->uThreads, 1 );
+}
+
+UINT32 dp_plan_fits( DPContext* pDP )
+{
+	UINT32 uBytes;
+	FLOAT fMs;
+	dp_plan( pDP, &uBytes, &fMs );
+	/* compared in MB, budget * 1024 * 1024 wraps a 32 bit UINT32 from 4096 MB */
+	if( pDP->uBudgetMB && uBytes / ( 1024 * 1024 ) + ( uBytes % ( 1024 * 1024 ) != 0 ) > pDP->uBudgetMB ) { return 0; }
+	if( pDP->uBudgetMs && fMs > pDP->uBudgetMs ) { return 0; }
+	return 1;
+}
+
+/* a solve bounded by min and max only needs the states up to the one covering max, no
+ * state's rows depend on the ones above it. the states below the one covering min are
+ * still solved, a band load leaves less than min to the later stages, but not reported. */
+void dp_resize_band( DPContext* pDP )
+{
+	FLOAT fTol = 1E-3;
 
-	if( !guSolveMode )
+	pDP->uStateLo = 0;
+	if( pDP->fStateMax > 0 )
 	{
-		sprintf( gcPrintBuff, "%s:%d (" VERSIONED_NAME  ") Unspecified solvemode.\n", __FILE__, __LINE__ );
- 		PRINT_STDERR( gcPrintBuff );
-		dp_cleanup_fatal();
-		return;
+		pDP->uStates = MIN( pDP->uStates, (UINT32)ceil( pDP->fStateMax / pDP->fSolutionDelta - fTol ) + 1 );
 	}
-
+	if( pDP->fStateMin > 0 )
 	{
-		CHAR* szSolveMode = (guSolveMode == DP_OPTIMIZE_FOR_POWER) ? "power" : "flow";
-
-		sprintf( gcPrintBuff, "Solving for %s.\n", szSolveMode );
-		PRINT_STDOUT( gcPrintBuff );
+		pDP->uStateLo = MIN( (UINT32)( pDP->fStateMin / pDP->fSolutionDelta + fTol ), pDP->uStates - 1 );
 	}
+}
 
-	VERIFY( guUserStepCount >= 5 );
-	guProblemStepCount = guUserStepCount;
-	guStages = guTurbs;
-
-#ifndef ENABLE_SPECIFIED_MINMAX_STATE
-	gfStateMax = gfStateMin = 0;
-#endif // ENABLE_SPECIFIED_MINMAX_STATE
+/* choose the problem step count near uUserStepCount that rounds well, and size the states from it */
+void dp_resize_steps( DPContext* pDP, UINT32 uUserStepCount )
+{
+	pDP->uProblemStepCount = uUserStepCount;
 
 	{
-		FLOAT fMaxDecision = (guSolveMode == DP_OPTIMIZE_FOR_POWER) ? gfMaxPower[0] : gfMaxFlow[0];
-		FLOAT fMinMaxDecision = (guSolveMode == DP_OPTIMIZE_FOR_POWER) ? gfMinMaxPower[0] : gfMinMaxFlow[0];
-		FLOAT fTotDecision = (guSolveMode == DP_OPTIMIZE_FOR_POWER) ? gfTotalPower[0] : gfTotalFlow[0];
+		FLOAT fMaxDecision = (pDP->uSolveMode == DP_OPTIMIZE_FOR_POWER) ? pDP->fMaxPower[0] : pDP->fMaxFlow[0];
+		FLOAT fMinMaxDecision = (pDP->uSolveMode == DP_OPTIMIZE_FOR_POWER) ? pDP->fMinMaxPower[0] : pDP->fMinMaxFlow[0];
+		FLOAT fTotDecision = (pDP->uSolveMode == DP_OPTIMIZE_FOR_POWER) ? pDP->fTotalPower[0] : pDP->fTotalFlow[0];
 
-		FLOAT fMaxAltDecision = (guSolveMode == DP_OPTIMIZE_FOR_POWER) ? gfMaxFlow[0] : gfMaxPower[0];
-		FLOAT fMinMaxAltDecision = (guSolveMode == DP_OPTIMIZE_FOR_POWER) ? gfMinMaxFlow[0] : gfMinMaxPower[0];
-		FLOAT fTotAltDecision = (guSolveMode == DP_OPTIMIZE_FOR_POWER) ? gfTotalFlow[0] : gfTotalPower[0];
+		FLOAT fMaxAltDecision = (pDP->uSolveMode == DP_OPTIMIZE_FOR_POWER) ? pDP->fMaxFlow[0] : pDP->fMaxPower[0];
+		FLOAT fMinMaxAltDecision = (pDP->uSolveMode == DP_OPTIMIZE_FOR_POWER) ? pDP->fMinMaxFlow[0] : pDP->fMinMaxPower[0];
+		FLOAT fTotAltDecision = (pDP->uSolveMode == DP_OPTIMIZE_FOR_POWER) ? pDP->fTotalFlow[0] : pDP->fTotalPower[0];
 
-		UINT32 uNonZeroStageStepCount = guProblemStepCount - 1; // -1 to discount stage zero
+		UINT32 uNonZeroStageStepCount = pDP->uProblemStepCount - 1; // -1 to discount stage zero
 		FLOAT fCommonStepSize = fMinMaxDecision / uNonZeroStageStepCount;
 
 		UINT32 uIter = 0;
 		FLOAT fBestSquare = 4e4; // a bigish number
 		UINT32 uBestNonZeroStageStepCount = 0;
 
-		if( guDebugMode )
+		if( pDP->uDebugMode )
 		{
 			sprintf( gcPrintBuff, "fMaxDecision: %f   fMinMaxDecision: %f   fTotDecision: %f\n", fMaxDecision, fMinMaxDecision, fTotDecision );
 			PRINT_STDOUT( gcPrintBuff );
@@ -1994,167 +2915,1299 @@ EXTERNC void dp_resize()
 				uIter++;
 			}
 		}
-		guProblemStepCount = ( uBestNonZeroStageStepCount == 0 ? guProblemStepCount : ( uBestNonZeroStageStepCount + 1 ) ); // +1 to include stage zero
-		if( guProblemStepCount != guUserStepCount )
+		pDP->uProblemStepCount = ( uBestNonZeroStageStepCount == 0 ? pDP->uProblemStepCount : ( uBestNonZeroStageStepCount + 1 ) ); // +1 to include stage zero
+		fCommonStepSize = fMaxDecision / ( uBestNonZeroStageStepCount == 0 ? pDP->uProblemStepCount - 1 : uBestNonZeroStageStepCount ); // +1 to include stage zero;
+
+		pDP->fSolutionDelta = fCommonStepSize;
+		pDP->fOtherSolutionDelta = fCommonStepSize * (fMaxAltDecision / fMaxDecision);
+		{
+			FLOAT fIntT;
+			modff( fTotDecision / fCommonStepSize, &fIntT );
+			pDP->uStates = fIntT + 1; // +1 to include stage zero
+#ifndef ENABLE_SPECIFIED_MINMAX_STATE
+			pDP->fStateMax = fIntT * fCommonStepSize;
+#endif // ENABLE_SPECIFIED_MINMAX_STATE
+		}
+	}
+
+#ifdef ENABLE_SPECIFIED_MINMAX_STATE
+	dp_resize_band( pDP );
+#else
+	pDP->uStateLo = 0;
+#endif // ENABLE_SPECIFIED_MINMAX_STATE
+}
+
+EXTERNC void dp_resize( DPContext* pDP )
+{
+	UINT32 uSteps, uTargetSteps;
+
+	ex_clear();
+
+	if( !pDP->uSolveMode )
+	{
+		sprintf( gcPrintBuff, "%s:%d (" VERSIONED_NAME  ") Unspecified solvemode.\n", __FILE__, __LINE__ );
+ 		PRINT_STDERR( gcPrintBuff );
+		dp_cleanup_fatal( pDP );
+		return;
+	}
+
+	{
+		CHAR* szSolveMode = (pDP->uSolveMode == DP_OPTIMIZE_FOR_POWER) ? "power" : "flow";
+
+		sprintf( gcPrintBuff, DP_REFINE_COARSE( pDP ) ? "Solving for %s, coarse pass.\n" : "Solving for %s.\n", szSolveMode );
+		PRINT_STDOUT( gcPrintBuff );
+	}
+
+	VERIFY( pDP->uUserStepCount >= 5 );
+	pDP->uStages = pDP->uTurbs;
+
+#ifndef ENABLE_SPECIFIED_MINMAX_STATE
+	pDP->fStateMax = pDP->fStateMin = 0;
+#else
+	if( pDP->fStateMin < 0 || pDP->fStateMax < 0 || ( pDP->fStateMax > 0 && pDP->fStateMin > pDP->fStateMax ) )
+	{
+		sprintf( gcPrintBuff, "%s:%d (" VERSIONED_NAME  ") Min and max don't make a band.\n", __FILE__, __LINE__ );
+		PRINT_STDERR( gcPrintBuff );
+		dp_cleanup_fatal( pDP );
+		pDP->fStateMin = pDP->fStateMax = 0; /* interactive, solve them all */
+	}
+#endif // ENABLE_SPECIFIED_MINMAX_STATE
+
+	uTargetSteps = DP_REFINE_COARSE( pDP ) ? MAX( pDP->uUserStepCount / pDP->uRefineFactor, 5 ) : pDP->uUserStepCount;
+	uSteps = uTargetSteps;
+	dp_resize_steps( pDP, uSteps );
+
+	/* back the discretization off until the prediction fits the budget */
+	if( pDP->uBudgetMB || pDP->uBudgetMs )
+	{
+		UINT32 uBytes;
+		FLOAT fMs;
+		while( uSteps > 5 && !dp_plan_fits( pDP ) ) { dp_resize_steps( pDP, --uSteps ); }
+		dp_plan( pDP, &uBytes, &fMs );
+		if( !dp_plan_fits( pDP ) )
+		{
+			sprintf( gcPrintBuff, "Budget can't be met, %lu KB and %.0f ms predicted.\n", uBytes / 1024, fMs );
+			PRINT_STDOUT( gcPrintBuff );
+		}
+		else if( uSteps != uTargetSteps || pDP->uDebugMode )
 		{
-			sprintf( gcPrintBuff, "UnitSteps adjusted by %d to improve rounding.\n", guProblemStepCount - guUserStepCount );
+			sprintf( gcPrintBuff, "Budget limits UnitSteps to %lu, %lu KB and %.0f ms predicted.\n", uSteps, uBytes / 1024, fMs );
 			PRINT_STDOUT( gcPrintBuff );
 		}
-		fCommonStepSize = fMaxDecision / ( uBestNonZeroStageStepCount == 0 ? guProblemStepCount - 1 : uBestNonZeroStageStepCount ); // +1 to include stage zero;
+	}
+
+	if( pDP->uProblemStepCount != uSteps )
+	{
+		sprintf( gcPrintBuff, "UnitSteps adjusted by %d to improve rounding.\n", pDP->uProblemStepCount - uSteps );
+		PRINT_STDOUT( gcPrintBuff );
+	}
+}
+
+/* returns the size of the solver workspace. with uCarve it also lays the
+ * arrays out from pBase, or clears the pointers into it when pBase is 0. */
+UINT32 dp_arena_layout( DPContext* pDP, UINT8* pBase, UINT32 uCarve )
+{
+	UINT32 uSize = 0;
+
+#define DP_ARENA_CARVE( _p, _t, _n ) do{ if( uCarve ) { _p = pBase ? (_t*)( pBase + uSize ) : 0; } uSize += DP_ARENA_ROUND( sizeof(_t) * (_n) ); }while(0)
+
+#ifdef DEBUG_BACKWARDPASS
+	/* the big kahuna, only kept so it can be dumped. the backpass reduces it row by row. */
+	DP_ARENA_CARVE( pDP->pfScenarioDecisionValues, FLOAT, pDP->uStates * pDP->uStates ); /* [ states, states ] but actually triangular */
+	DP_ARENA_CARVE( pDP->pu16ScenarioDecisionStates, UINT16, pDP->uStates * pDP->uStates ); /* [ states, states ] but actually triangular */
+	DP_ARENA_CARVE( pDP->pu8ScenarioDecisionCounts, UINT8, pDP->uStates * pDP->uStates ); /* [ states, states ] but actually triangular */
+#endif
+
+	DP_ARENA_CARVE( pDP->pfHKTableValues, FLOAT, pDP->uHKRows * pDP->uProblemStepCount ); /* [ rows, steps ] */
+	DP_ARENA_CARVE( pDP->pfPowerAllocations, FLOAT, pDP->uHKRows * pDP->uProblemStepCount ); /* [ rows, steps ] */
+	DP_ARENA_CARVE( pDP->pfFlowAllocations, FLOAT, pDP->uHKRows * pDP->uProblemStepCount ); /* [ rows, steps ] */
+	DP_ARENA_CARVE( pDP->pu8Conditions, UINT8, pDP->uHKRows * pDP->uProblemStepCount ); /* [ rows, steps ] */
+	DP_ARENA_CARVE( pDP->pu16HKRowStages, UINT16, pDP->uHKRows ); /* [ rows ] */
+
+	/* other allocations... */
+	DP_ARENA_CARVE( pDP->pfGlobalDecisionValues, FLOAT, pDP->uStages * pDP->uStates ); /* [ stages, states ] */
+	DP_ARENA_CARVE( pDP->pu8GlobalDecisionCounts, UINT8, pDP->uStages * pDP->uStates ); /* [ stages, states ] */
+	DP_ARENA_CARVE( pDP->pu16GlobalDecisionStateMap, UINT16, pDP->uStages * pDP->uStates ); /* [ stages, states ] */
+	DP_ARENA_CARVE( pDP->pu16GlobalDecisionHandedMap, UINT16, pDP->uStages * pDP->uStates ); /* [ stages, states ] */
+	DP_ARENA_CARVE( pDP->pfGlobalDecisionAllocations, FLOAT, pDP->uStages * pDP->uStates ); /* [ stages, states ] */
+	DP_ARENA_CARVE( pDP->pfForwardDecisionAverages, FLOAT, pDP->uStates * pDP->uStages ); /* [ states, stages ] */
+	DP_ARENA_CARVE( pDP->pu16ForwardDecisionStateMap, UINT16, pDP->uStates * pDP->uStages ); /* [ states, stages ] */
+	DP_ARENA_CARVE( pDP->pu16Solution, UINT16, pDP->uStages * pDP->uStates ); /* [ stages, states ] */
+	DP_ARENA_CARVE( pDP->pfSolution, FLOAT, pDP->uStages * pDP->uStates ); /* [ stages, states ] */
+	DP_ARENA_CARVE( pDP->pfOtherSolution, FLOAT, pDP->uStages * pDP->uStates ); /* [ stages, states ] */
+	DP_ARENA_CARVE( pDP->pfHKSolution, FLOAT, pDP->uStages * pDP->uStates ); /* [ stages, states ] */
+
+	/* smaller allocations */
+	DP_ARENA_CARVE( pDP->pfSolutionAllocations, FLOAT, pDP->uStates ); /* [ states ] */
+	DP_ARENA_CARVE( pDP->pu16StateOfMax, UINT16, pDP->uStates ); /* [ states ] */
+	DP_ARENA_CARVE( pDP->pu16HandedOfMax, UINT16, pDP->uStates ); /* [ states ] */
+	DP_ARENA_CARVE( pDP->pfValueOfMax, FLOAT, pDP->uStates ); /* [ states ] */
+	DP_ARENA_CARVE( pDP->pu8CountOfMax, UINT8, pDP->uStates ); /* [ states ] */
+	DP_ARENA_CARVE( pDP->pfOtherSolutionAllocations, FLOAT, pDP->uStates ); /* [ states ] */
+	DP_ARENA_CARVE( pDP->pfHKSolutionAverages, FLOAT, pDP->uStates ); /* [ states ] */
+
+	DP_ARENA_CARVE( pDP->pu16LocalNearOptimumStates, UINT16, pDP->uStages ); /* [ stages ] */
+	DP_ARENA_CARVE( pDP->pu16LocalMaximumStates, UINT16, pDP->uStages ); /* [ stages ] */
+	DP_ARENA_CARVE( pDP->pu16LocalOptimumStates, UINT16, pDP->uStages ); /* [ stages ] */
+	DP_ARENA_CARVE( pDP->pu8StageChecklist, UINT8, pDP->uStages ); /* [ stages ] */
+	DP_ARENA_CARVE( pDP->pu8StageChecklistCopy, UINT8, DP_MAX_THREADS * DP_CHECKLIST_STRIDE( pDP->uStages ) ); /* [ threads, stages ] */
+	DP_ARENA_CARVE( pDP->pu16WalkPassedStages, UINT16, DP_MAX_THREADS * DP_CHECKLIST_STRIDE( pDP->uStages ) ); /* [ threads, stages ] */
+
+	DP_ARENA_CARVE( pDP->pu16LocalDecisions, UINT16, pDP->uStates ); /* [ states ] */
+	DP_ARENA_CARVE( pDP->pfLocalValues, FLOAT, pDP->uStates ); /* [ states ] */
+	DP_ARENA_CARVE( pDP->pfLocalCounts, FLOAT, pDP->uStates ); /* [ states ] */
+	DP_ARENA_CARVE( pDP->pfReversedValues, FLOAT, pDP->uStates ); /* [ states ] */
+	DP_ARENA_CARVE( pDP->pfReversedCounts, FLOAT, pDP->uStates ); /* [ states ] */
+	DP_ARENA_CARVE( pDP->pStageRanks, StageRank, pDP->uStages ); /* [ stages ] */
+	DP_ARENA_CARVE( pDP->pu16StageMap, UINT16, pDP->uStages ); /* [ stages ] */
+
+	DP_ARENA_CARVE( pDP->pNodes, DPMergeNode, DP_MERGE_NODES( pDP ) ); /* [ nodes ] */
+	DP_ARENA_CARVE( pDP->pfNodeValues, FLOAT, DP_MERGE_NODES( pDP ) * pDP->uStates ); /* [ nodes, states ] */
+	DP_ARENA_CARVE( pDP->pu8NodeCounts, UINT8, DP_MERGE_NODES( pDP ) * pDP->uStates ); /* [ nodes, states ] */
+	DP_ARENA_CARVE( pDP->pu16NodeSplits, UINT16, DP_MERGE_NODES( pDP ) * pDP->uStates ); /* [ nodes, states ] */
+	DP_ARENA_CARVE( pDP->pu16PlanStages, UINT16, pDP->uEngine == DP_ENGINE_BACKPASS ? 0 : pDP->uStages ); /* [ stages ] */
+	DP_ARENA_CARVE( pDP->pfOutageHK, FLOAT, pDP->uOutageScan ? pDP->uStages * pDP->uStates : 0 ); /* [ stages, states ] */
+	DP_ARENA_CARVE( pDP->pfOutageSolution, FLOAT, pDP->uOutageScan ? pDP->uStages * pDP->uStages * pDP->uStates : 0 ); /* [ stages, stages, states ] */
+	DP_ARENA_CARVE( pDP->pu16ResumeStageMap, UINT16, pDP->uStages ); /* [ stages ] */
+	DP_ARENA_CARVE( pDP->pu16ResumeRows, UINT16, pDP->uStages ); /* [ stages ] */
+	DP_ARENA_CARVE( pDP->pu16BandLo, UINT16, DP_BANDED( pDP ) ? pDP->uStates : 0 ); /* [ states ] */
+	DP_ARENA_CARVE( pDP->pu16BandHi, UINT16, DP_BANDED( pDP ) ? pDP->uStates : 0 ); /* [ states ] */
+	DP_ARENA_CARVE( pDP->pfBoundLocal, FLOAT, pDP->uStates ); /* [ states ] */
+	DP_ARENA_CARVE( pDP->pfBoundGlobal, FLOAT, pDP->uStates ); /* [ states ] */
+	DP_ARENA_CARVE( pDP->pu16BoundSkips, UINT16, pDP->uStates ); /* [ states ] */
+
+#undef DP_ARENA_CARVE
+
+	return uSize;
+}
+
+/* perform allocations */
+EXTERNC void dp_malloc( DPContext* pDP )
+{
+	UINT32 uSize;
+
+	pDP->uMALLOC = 0;
+
+	VERIFY( pDP->uStages * pDP->uStates > 0 );
+	if( ex_didFail() )
+	{
+		sprintf( gcPrintBuff, "either zero Stages or States.\n" );
+		PRINT_STDOUT( gcPrintBuff );
+		return;
+	}
+
+	uSize = dp_arena_layout( pDP, 0, 0 );
+	dp_arena_reserve( pDP, uSize, __FILE__, __LINE__ );
+	dp_arena_layout( pDP, pDP->pArena, 1 );
+#ifdef DEBUG_POISON
+	memset( pDP->pArena, DP_POISON_BYTE, uSize );
+	pDP->pfHKRows = 0;
+	pDP->pfResumeRows = 0;
+#endif
+	pDP->uMALLOC += pDP->uArenaSize;
+
+	if( pDP->uHKEntries < pDP->uHKRows )
+	{
+		void* pVoid = realloc( pDP->pHKEntries, pDP->uHKRows * sizeof(HKTableEntry) );
+		if( pVoid == 0 )
+		{
+			sprintf( gcPrintBuff, "%s:%d (" VERSIONED_NAME  ") realloc failed\n", __FILE__, __LINE__ );
+			PRINT_STDERR( gcPrintBuff );
+			dp_cleanup_fatal( pDP );
+			return;
+		}
+		pDP->pHKEntries = (HKTableEntry*)pVoid;
+		pDP->uHKEntries = pDP->uHKRows;
+		pDP->pfHKRows = 0;
+	}
+
+	if( pDP->uDebugMode )
+	{
+		printf( "%lu total bytes allocated\n", pDP->uMALLOC );
+	}
+}
+
+EXTERNC void dp_malloc_control( DPContext* pDP, UINT32 uControl )
+{
+#ifdef ENABLE_MALLOC_CACHE
+	if( uControl == 0 ) {
+		/* disable */
+		pDP->uMemCacheOn = 0;
+	} else if( uControl == 1 ) {
+		/* enable */
+		pDP->uMemCacheOn = 1;
+	} else if( uControl == 2 ) {
+		/* flush, the arena is kept by dp_cleanup while caching */
+		dp_cleanup( pDP );
+		dp_arena_layout( pDP, 0, 1 );
+		dp_arena_free( pDP );
+	}
+#else
+	dp_cleanup( pDP );
+#endif
+}
+
+EXTERNC void dp_cleanup( DPContext* pDP )
+{
+#ifdef ENABLE_MALLOC_CACHE
+	if( pDP->uMemCacheOn ) { return; } /* keep the arena for the next solve */
+#endif
+	dp_arena_layout( pDP, 0, 1 );
+	dp_arena_free( pDP );
+}
+
+void dp_cleanup_fatal( DPContext* pDP )
+{
+	if( !giInteractiveMode ) {
+		if( pDP ) { dp_malloc_control( pDP, 2 ); }
+		parse_freeallblocks();
+		exit(-1);
+	}
+}
+
+int CDECLCALL dp_fnStageMetricComparison(const void* pA, const void* pB)
+{
+#if 1 // removes typecast
+	FLOAT a = ((StageRank*)pA)->fMetric;
+	FLOAT b = ((StageRank*)pB)->fMetric;
+#else
+	UINT32 a = ((StageRank*)pA)->fMetric;
+	UINT32 b = ((StageRank*)pB)->fMetric;
+#endif
+
+	return a < b ? -1 : ( a > b ? 1 : 0 );
+}
+
+typedef void fnMaxPlusKernel( FLOAT*, UINT32*, FLOAT*, FLOAT*, FLOAT*, FLOAT*, FLOAT, FLOAT, FLOAT, UINT32, UINT32 );
+
+typedef struct tagDPBackpassJob
+{
+	UINT32 uStage;
+	UINT32 uHigherPriorityStage;
+	UINT16 u16PrioritizedStage;
+	UINT16 u16LocalMaximumState;
+	UINT16 u16LocalCoordinationState;
+	UINT32 uOnCamStateCount;
+	UINT32 uBound; /* dp_backpass_bound built this stage's bounds */
+	fnMaxPlusKernel* pfnKernel; /* for dp_backpass_scenarios_simd */
+} DPBackpassJob;
+
+/* value, local decision and count of one cell of the [ scenario, state ] decision matrix, and the
+ * state its value was taken from in the higher stage. a local decision dropped as a likely local
+ * min keeps that state, so the allocation it would have used is handed to no one. */
+DP_INLINE FLOAT dp_backpass_decision( DPContext* pDP, DPBackpassJob* pJob, UINT32 uScenario, UINT32 uState, UINT16* pu16LocalDecision, UINT8* pu8Count, UINT16* pu16Handed )
+{
+	FLOAT fTol = 1E-9;
+	UINT16 u16LocalDecision = pDP->pu16LocalDecisions[ uState ];
+
+	FLOAT fLocalDecision = pDP->pfHKTableValues[ DP_HK_ROW( pDP, pJob->u16PrioritizedStage ) + u16LocalDecision ];
+	if( fLocalDecision < fTol ) { fLocalDecision = 0; u16LocalDecision = 0; }
+
+	{
+		UINT16 u16GlobalDecision = uScenario - u16LocalDecision;
+		FLOAT fGlobalDecision = pDP->pfGlobalDecisionValues[ pJob->uHigherPriorityStage * pDP->uStates + u16GlobalDecision ];
+		UINT8 u8GlobalDecisionCount = pDP->pu8GlobalDecisionCounts[ pJob->uHigherPriorityStage * pDP->uStates + u16GlobalDecision ];
+
+		// remove option as a solution if it is likely to be a local min
+		if( u8GlobalDecisionCount < pDP->uActiveStages - 1 - pJob->uStage && uScenario > pJob->u16LocalMaximumState )
+		{ fLocalDecision = 0; u16LocalDecision = 0; }
+
+		*pu16LocalDecision = u16LocalDecision;
+		*pu16Handed = u16GlobalDecision;
+		*pu8Count = u8GlobalDecisionCount + ( u16LocalDecision == 0 ? 0 : 1 );
+		return fLocalDecision + fGlobalDecision;
+	}
+}
+
+/* upper bounds on the cells of one stage's decision matrix. a cell's average is the mediant of
+ * its local HK and the average of the higher stages it lands on, so it is at most the larger of
+ * the two. a cell whose local HK is dropped repeats decision 0, which the row tried first.
+ * moving along a row to larger local decisions lands on lower global states, so with the best
+ * local HK from each decision up and the best global average from each state down neither
+ * bound rises. above the unit maximum the decisions repeat the on-cam ones, which never win a
+ * tie, so a bounded row stops at the maximum. */
+void dp_backpass_bound( DPContext* pDP, DPBackpassJob* pJob )
+{
+	FLOAT fTol = 1E-9;
+	FLOAT* pfLocalHK = &(pDP->pfHKTableValues[ DP_HK_ROW( pDP, pJob->u16PrioritizedStage ) ]);
+	FLOAT* pGlobalValues = &(pDP->pfGlobalDecisionValues[ pJob->uHigherPriorityStage * pDP->uStates ]);
+	UINT8* pGlobalCounts = &(pDP->pu8GlobalDecisionCounts[ pJob->uHigherPriorityStage * pDP->uStates ]);
+	FLOAT fBest = 0;
+	UINT32 uState;
+
+	/* a coordination factor above 1 puts the on-cam decisions past the maximum */
+	pJob->uBound = ( pJob->u16LocalCoordinationState <= pJob->u16LocalMaximumState );
+	if( !pJob->uBound ) { return; }
+
+	for( uState = MIN( pJob->u16LocalMaximumState, pDP->uStates - 1 ) + 1; uState-- > 0; )
+	{
+		if( pfLocalHK[ uState ] >= fTol ) { fBest = MAX( fBest, pfLocalHK[ uState ] ); }
+		pDP->pfBoundLocal[ uState ] = fBest;
+	}
+	fBest = 0;
+	for( uState = 0; uState < pDP->uStates; uState++ )
+	{
+		if( pGlobalCounts[ uState ] > 0 ) { fBest = MAX( fBest, pGlobalValues[ uState ] / pGlobalCounts[ uState ] ); }
+		else if( pGlobalValues[ uState ] > 0 ) { fBest = 1E30f; } /* a value without a count adds to the local one */
+		pDP->pfBoundGlobal[ uState ] = fBest;
+	}
+}
+
+/* nonzero when no cell of the row from uState on can beat fMaxValue. the margin covers the
+ * rounding of the averages, so the row's winner never changes. */
+DP_INLINE UINT32 dp_backpass_bounded( DPContext* pDP, UINT32 uScenario, UINT32 uState, FLOAT fMaxValue )
+{
+	FLOAT fBound = MAX( pDP->pfBoundLocal[ uState ], pDP->pfBoundGlobal[ uScenario - uState ] );
+	return fMaxValue > fBound + 1E-4f * ( 1 + (FLOAT)fabs( fBound ) );
+}
+
+/* backpass rows [uBegin, uEnd) of the scenario matrix for one stage. rows are independent.
+ * each row is reduced as it is computed, with the same rules as arr_float_max_nostride_count_pos,
+ * so the matrix itself only exists when it is to be dumped. */
+void dp_backpass_scenarios( DPContext* pDP, void* pVoidJob, UINT32 uThread, UINT32 uBegin, UINT32 uEnd )
+{
+	DPBackpassJob* pJob = (DPBackpassJob*)pVoidJob;
+	UINT32 uScenario, uState;
+
+	for( uScenario = uBegin; uScenario < uEnd; uScenario++ ) /* par */
+	{
+		FLOAT fMaxValue = 0;
+		FLOAT fValueOfMax = 0; /* replaced at state zero, which always runs */
+		UINT16 u16StateOfMax = 0;
+		UINT16 u16HandedOfMax = 0;
+		UINT8 u8CountOfMax = 0;
+		UINT32 uLast = uScenario;
+
+#if defined(ENABLE_BACKPASS_BOUND) && !defined(DEBUG_BACKWARDPASS)
+		if( pJob->uBound ) { uLast = MIN( uScenario, pJob->u16LocalMaximumState ); }
+#endif
+
+		/* record effects of local decisions */
+		for( uState = 0; uState <= uLast; uState++ )
+		{
+			UINT16 u16LocalDecision, u16Handed;
+			UINT8 u8Count;
+			FLOAT fValue;
+
+#if defined(ENABLE_BACKPASS_BOUND) && !defined(DEBUG_BACKWARDPASS)
+			if( pJob->uBound && uState > 0 && dp_backpass_bounded( pDP, uScenario, uState, fMaxValue ) ) { break; }
+#endif
+			fValue = dp_backpass_decision( pDP, pJob, uScenario, uState, &u16LocalDecision, &u8Count, &u16Handed );
+
+#ifdef DEBUG_BACKWARDPASS
+			pDP->pfScenarioDecisionValues[ uScenario * pDP->uStates + uState ] = fValue;
+			pDP->pu16ScenarioDecisionStates[ uScenario * pDP->uStates + uState ] = u16LocalDecision;
+			pDP->pu8ScenarioDecisionCounts[ uScenario * pDP->uStates + uState ] = u8Count;
+#endif
+
+			if( uState == 0 ) // note: state zero is the default
+			{
+				fValueOfMax = fValue; u16StateOfMax = u16LocalDecision; u16HandedOfMax = u16Handed; u8CountOfMax = u8Count;
+			}
+			if( u8Count > 0 )
+			{
+				FLOAT v = fValue / u8Count;
+				if( v > fMaxValue ) { fMaxValue = v; fValueOfMax = fValue; u16StateOfMax = u16LocalDecision; u16HandedOfMax = u16Handed; u8CountOfMax = u8Count; }
+			}
+		}
+
+		pDP->pfValueOfMax[ uScenario ] = fValueOfMax;
+		pDP->pu16StateOfMax[ uScenario ] = u16StateOfMax;
+		pDP->pu16HandedOfMax[ uScenario ] = u16HandedOfMax;
+		pDP->pu8CountOfMax[ uScenario ] = u8CountOfMax;
+		pDP->pu16BoundSkips[ uScenario ] = (UINT16)( uScenario + 1 - uState );
+	}
+}
+
+/* the local decisions a banded backpass tries at each scenario of one stage, besides
+ * decision 0. a refined solve tries those within DP_REFINE_BAND coarse steps of the
+ * decisions the coarse solve made at the coarse scenarios either side. with uPrune,
+ * scenarios above the unit maximum only try its near-optimum to maximum range.
+ * returns the cells this leaves. */
+FLOAT dp_backpass_band( DPContext* pDP, UINT16 u16Stage, UINT16 u16LocalMaximumState, UINT32 uCount )
+{
+	FLOAT fCells = 0;
+	UINT32 uScenario;
+
+	for( uScenario = 0; uScenario < uCount; uScenario++ )
+	{
+		UINT32 uMax = MIN( uScenario, u16LocalMaximumState ); /* the rest repeat the on-cam decisions */
+		UINT32 uLo = 1, uHi = uMax;
+
+		if( pDP->uRefineStates )
+		{
+			UINT16* pu16Coarse = &(pDP->pu16RefineMap[ u16Stage * pDP->uRefineStates ]);
+			FLOAT fRatio = pDP->fRefineDelta / pDP->fSolutionDelta; /* fine steps per coarse step */
+			UINT32 uBelow = MIN( (UINT32)( uScenario / fRatio ), pDP->uRefineStates - 1 );
+			UINT32 uAbove = MIN( uBelow + 1, pDP->uRefineStates - 1 );
+			FLOAT fLo = ( MIN( pu16Coarse[ uBelow ], pu16Coarse[ uAbove ] ) - DP_REFINE_BAND ) * fRatio;
+			FLOAT fHi = ( MAX( pu16Coarse[ uBelow ], pu16Coarse[ uAbove ] ) + DP_REFINE_BAND ) * fRatio;
+			uLo = ( fLo < 1 ) ? 1 : MIN( (UINT32)fLo, uMax + 1 );
+			uHi = ( fHi < uMax ) ? (UINT32)ceil( fHi ) : uMax;
+		}
+		if( pDP->uPrune && uScenario > u16LocalMaximumState )
+		{
+			uLo = MAX( uLo, pDP->pu16LocalNearOptimumStates[ u16Stage ] );
+		}
+
+		pDP->pu16BandLo[ uScenario ] = (UINT16)uLo;
+		pDP->pu16BandHi[ uScenario ] = (UINT16)uHi;
+		fCells += 1 + ( uHi >= uLo ? uHi - uLo + 1 : 0 );
+	}
+	return fCells;
+}
+
+/* dp_backpass_scenarios over decision 0 and the pu16BandLo to pu16BandHi ones only */
+void dp_backpass_scenarios_band( DPContext* pDP, void* pVoidJob, UINT32 uThread, UINT32 uBegin, UINT32 uEnd )
+{
+	DPBackpassJob* pJob = (DPBackpassJob*)pVoidJob;
+	UINT32 uScenario, uState;
+
+	for( uScenario = uBegin; uScenario < uEnd; uScenario++ ) /* par */
+	{
+		FLOAT fMaxValue = 0;
+		FLOAT fValueOfMax;
+		UINT16 u16StateOfMax, u16HandedOfMax;
+		UINT8 u8CountOfMax;
+		UINT32 uHi = pDP->pu16BandHi[ uScenario ];
+
+		for( uState = 0; uState <= uHi; uState = ( uState == 0 ) ? pDP->pu16BandLo[ uScenario ] : uState + 1 )
+		{
+			UINT16 u16LocalDecision, u16Handed;
+			UINT8 u8Count;
+			FLOAT fValue = dp_backpass_decision( pDP, pJob, uScenario, uState, &u16LocalDecision, &u8Count, &u16Handed );
+
+			if( uState == 0 ) // note: state zero is the default
+			{
+				fValueOfMax = fValue; u16StateOfMax = u16LocalDecision; u16HandedOfMax = u16Handed; u8CountOfMax = u8Count;
+			}
+			if( u8Count > 0 )
+			{
+				FLOAT v = fValue / u8Count;
+				if( v > fMaxValue ) { fMaxValue = v; fValueOfMax = fValue; u16StateOfMax = u16LocalDecision; u16HandedOfMax = u16Handed; u8CountOfMax = u8Count; }
+			}
+		}
+
+		pDP->pfValueOfMax[ uScenario ] = fValueOfMax;
+		pDP->pu16StateOfMax[ uScenario ] = u16StateOfMax;
+		pDP->pu16HandedOfMax[ uScenario ] = u16HandedOfMax;
+		pDP->pu8CountOfMax[ uScenario ] = u8CountOfMax;
+
+		/* nothing in the band could run, the band doesn't hold here */
+		if( u8CountOfMax == 0 && uScenario > 0 ) { dp_backpass_scenarios( pDP, pVoidJob, uThread, uScenario, uScenario + 1 ); }
+	}
+}
+
+/* keeps the coarse decisions for the refined pass */
+void dp_refine_store( DPContext* pDP )
+{
+	UINT32 uEntries = pDP->uStages * pDP->uStates + pDP->uStages;
+
+	if( pDP->uRefineEntries < uEntries )
+	{
+		void* pVoid = realloc( pDP->pu16RefineMap, uEntries * sizeof(UINT16) );
+		if( pVoid == 0 )
+		{
+			sprintf( gcPrintBuff, "%s:%d (" VERSIONED_NAME  ") realloc failed\n", __FILE__, __LINE__ );
+			PRINT_STDERR( gcPrintBuff );
+			dp_cleanup_fatal( pDP );
+			return;
+		}
+		pDP->pu16RefineMap = (UINT16*)pVoid;
+		pDP->uRefineEntries = uEntries;
+	}
+	memcpy( pDP->pu16RefineMap, pDP->pu16GlobalDecisionStateMap, sizeof(UINT16) * pDP->uStages * pDP->uStates ); /* can pass 65535 entries */
+	arr_uint16_copy( &(pDP->pu16RefineMap[ pDP->uStages * pDP->uStates ]), pDP->pu16StageMap, pDP->uStages );
+	pDP->uRefineStates = pDP->uStates;
+	pDP->fRefineDelta = pDP->fSolutionDelta;
+}
+
+/* lays out this stage's operands for dp_backpass_scenarios_simd */
+void dp_backpass_prepare( DPContext* pDP, DPBackpassJob* pJob )
+{
+	FLOAT fTol = 1E-9;
+	FLOAT* pGlobalValues = &(pDP->pfGlobalDecisionValues[ pJob->uHigherPriorityStage * pDP->uStates ]);
+	UINT8* pGlobalCounts = &(pDP->pu8GlobalDecisionCounts[ pJob->uHigherPriorityStage * pDP->uStates ]);
+	UINT32 uState;
+
+	for( uState = 0; uState < pDP->uStates; uState++ )
+	{
+		UINT16 u16LocalDecision = pDP->pu16LocalDecisions[ uState ];
+		FLOAT fLocalDecision = pDP->pfHKTableValues[ DP_HK_ROW( pDP, pJob->u16PrioritizedStage ) + u16LocalDecision ];
+		if( fLocalDecision < fTol ) { fLocalDecision = 0; u16LocalDecision = 0; }
+
+		pDP->pfLocalValues[ uState ] = fLocalDecision;
+		pDP->pfLocalCounts[ uState ] = ( u16LocalDecision == 0 ) ? 0.0f : 1.0f;
+		pDP->pfReversedValues[ uState ] = pGlobalValues[ pDP->uStates - 1 - uState ];
+		pDP->pfReversedCounts[ uState ] = pGlobalCounts[ pDP->uStates - 1 - uState ];
+	}
+}
+
+/* same as dp_backpass_scenarios, but walks each row in runs of consecutive local decisions
+ * so that the max-plus step can go through the vector kernels */
+void dp_backpass_scenarios_simd( DPContext* pDP, void* pVoidJob, UINT32 uThread, UINT32 uBegin, UINT32 uEnd )
+{
+	DPBackpassJob* pJob = (DPBackpassJob*)pVoidJob;
+	FLOAT* pGlobalValues = &(pDP->pfGlobalDecisionValues[ pJob->uHigherPriorityStage * pDP->uStates ]);
+	UINT8* pGlobalCounts = &(pDP->pu8GlobalDecisionCounts[ pJob->uHigherPriorityStage * pDP->uStates ]);
+	UINT32 uScenario;
+
+	for( uScenario = uBegin; uScenario < uEnd; uScenario++ ) /* par */
+	{
+		FLOAT fBest = 0;
+		UINT32 uBest = 0; // note: state zero is the default
+		FLOAT fThreshold = ( uScenario > pJob->u16LocalMaximumState ) ? (FLOAT)( pDP->uActiveStages - 1 - pJob->uStage ) : 0;
+		UINT32 uState = 0;
+		UINT32 uLast = uScenario;
+
+#ifdef ENABLE_BACKPASS_BOUND
+		if( pJob->uBound ) { uLast = MIN( uScenario, pJob->u16LocalMaximumState ); }
+#endif
+
+		while( uState <= uLast )
+		{
+			UINT32 uLocalDecision, uRunEnd, uReversed;
+			if( uState <= pJob->u16LocalMaximumState ) {
+				uLocalDecision = uState;
+				uRunEnd = MIN( uScenario, pJob->u16LocalMaximumState ) + 1;
+			} else {
+				UINT32 uPhase = uState % pJob->uOnCamStateCount;
+				uLocalDecision = pJob->u16LocalCoordinationState + uPhase;
+				uRunEnd = MIN( uScenario + 1, uState + pJob->uOnCamStateCount - uPhase );
+			}
+#ifdef ENABLE_BACKPASS_BOUND
+			if( pJob->uBound )
+			{
+				if( uState > 0 && dp_backpass_bounded( pDP, uScenario, uState, fBest ) ) { break; }
+				uRunEnd = MIN( uRunEnd, uState + DP_BOUND_CHUNK );
+			}
+#endif
+			uReversed = pDP->uStates - 1 - ( uScenario - uLocalDecision );
+
+			(*pJob->pfnKernel)( &fBest, &uBest,
+				&(pDP->pfLocalValues[ uState ]), &(pDP->pfLocalCounts[ uState ]),
+				&(pDP->pfReversedValues[ uReversed ]), &(pDP->pfReversedCounts[ uReversed ]),
+				pGlobalValues[ uScenario ], (FLOAT)pGlobalCounts[ uScenario ], fThreshold,
+				uState, uRunEnd - uState );
+			uState = uRunEnd;
+		}
+
+		{
+			UINT16 u16StateOfMax, u16HandedOfMax;
+			UINT8 u8CountOfMax;
+			pDP->pfValueOfMax[ uScenario ] = dp_backpass_decision( pDP, pJob, uScenario, uBest, &u16StateOfMax, &u8CountOfMax, &u16HandedOfMax );
+			pDP->pu16StateOfMax[ uScenario ] = u16StateOfMax;
+			pDP->pu16HandedOfMax[ uScenario ] = u16HandedOfMax;
+			pDP->pu8CountOfMax[ uScenario ] = u8CountOfMax;
+			pDP->pu16BoundSkips[ uScenario ] = (UINT16)( uScenario + 1 - uState );
+		}
+	}
+}
+
+/* scatter one stage of the decision matrices into the state-major copies,
+ * dropping the unmapped carry-forward entries like the tidy-up does.
+ * an average of 0 is never selected, same as a count of 0. */
+void dp_backpass_transpose( DPContext* pDP, UINT16 u16Stage )
+{
+	FLOAT* pfValues = &(pDP->pfGlobalDecisionValues[ u16Stage * pDP->uStates ]);
+	UINT8* pu8Counts = &(pDP->pu8GlobalDecisionCounts[ u16Stage * pDP->uStates ]);
+	UINT16* pu16StateMap = &(pDP->pu16GlobalDecisionStateMap[ u16Stage * pDP->uStates ]);
+	UINT32 uState, u;
+
+	for( uState = 0, u = u16Stage; uState < pDP->uStates; uState++, u += pDP->uStages )
+	{
+		UINT16 u16Mapped = pu16StateMap[ uState ];
+		pDP->pu16ForwardDecisionStateMap[ u ] = u16Mapped;
+		pDP->pfForwardDecisionAverages[ u ] = ( u16Mapped == 0 || pu8Counts[ uState ] == 0 ? 0 : pfValues[ uState ] / pu8Counts[ uState ] );
+	}
+}
+
+typedef struct tagDPForwardpassJob
+{
+	volatile UINT32 uFailed;
+} DPForwardpassJob;
+
+/* allocates uAllocationRemaining of state uState greedily: the stage with the best average at
+ * what is left goes next, among those not yet marked off in pu8Checklist. 0 on failure. */
+UINT32 dp_forwardpass_greedy( DPContext* pDP, UINT8* pu8Checklist, UINT32 uState, UINT32 uAllocationRemaining )
+{
+	while( uAllocationRemaining != 0 )
+	{
+		UINT16 u16PrioritizedStage = MAX_UINT16;
+		arr_float_max_unmarked_prioritized(
+				&u16PrioritizedStage,
+				&(pDP->pfForwardDecisionAverages[ uAllocationRemaining * pDP->uStages ]), /* [ states, stages ] */
+				pu8Checklist, /* [ stages ] */
+				pDP->pu16StageMap, /* [ stages ] */
+				pDP->uActiveStages );
+		if( u16PrioritizedStage == MAX_UINT16 )
+		{
+
+#ifdef DEBUG_FORWARDPASS
+			sprintf( gcPrintBuff, "%lu left unallocated\n", uAllocationRemaining );
+			PRINT_STDOUT( gcPrintBuff );
+#endif
+
+			break; // while
+		}
+		else
+		{
+			UINT16 uAllocatedStateForThisStage = MAX_UINT16;
+			if( pu8Checklist[ u16PrioritizedStage ] == MAX_UINT8 ) { return 0; } // in use
+
+			pu8Checklist[ u16PrioritizedStage ] = MAX_UINT8; // don't use this again
+			uAllocatedStateForThisStage = pDP->pu16ForwardDecisionStateMap[ uAllocationRemaining * pDP->uStages + u16PrioritizedStage ];
+
+			if( uAllocatedStateForThisStage >= pDP->uProblemStepCount )
+			{
+#ifdef ENABLE_ADAPTIVEFAILURE
+				uAllocatedStateForThisStage = pDP->uProblemStepCount - 1;
+#else
+				return 0;
+#endif
+			}
+
+#ifdef DEBUG_FORWARDPASS
+			{
+				FLOAT fAverage = pDP->pfForwardDecisionAverages[ uAllocationRemaining * pDP->uStages + u16PrioritizedStage ];
+				sprintf( gcPrintBuff, "stage %lu: allocated %lu (%f)\n",
+					u16PrioritizedStage,
+					uAllocatedStateForThisStage,
+					fAverage
+				);
+				PRINT_STDOUT( gcPrintBuff );
+			}
+#endif
+
+			pDP->pu16Solution[ u16PrioritizedStage * pDP->uStates + uState ] = uAllocatedStateForThisStage;
+			uAllocationRemaining -= uAllocatedStateForThisStage;
+
+		}
+	}
+
+#ifdef DEBUG_FORWARDPASS
+	sprintf( gcPrintBuff, "leaving %lu\n", uAllocationRemaining );
+	PRINT_STDOUT( gcPrintBuff );
+#endif
+
+	return 1;
+}
+
+/* forwardpass states [uBegin, uEnd). states are independent, each thread marks off stages in its own checklist. */
+void dp_forwardpass_states( DPContext* pDP, void* pVoidJob, UINT32 uThread, UINT32 uBegin, UINT32 uEnd )
+{
+	DPForwardpassJob* pJob = (DPForwardpassJob*)pVoidJob;
+	UINT8* pu8StageChecklistCopy = &(pDP->pu8StageChecklistCopy[ uThread * DP_CHECKLIST_STRIDE( pDP->uStages ) ]);
+	UINT32 uState;
+
+	for( uState = uBegin; uState < uEnd; uState++ ) /* par */
+	{
+		// reinit the checklist
+		memcpy( pu8StageChecklistCopy, pDP->pu8StageChecklist, pDP->uStages * sizeof(UINT8) );
+
+#ifdef DEBUG_FORWARDPASS
+		sprintf( gcPrintBuff, "********* state %lu\n", uState);
+		PRINT_STDOUT( gcPrintBuff );
+#endif
+
+		if( !dp_forwardpass_greedy( pDP, pu8StageChecklistCopy, uState, uState ) ) { pJob->uFailed = 1; return; }
+	}
+}
+
+/* forwardpass states [uBegin, uEnd) by walking the backpass decisions, with the same result as
+ * dp_forwardpass_states. each stage's handed map is its backpointer: the allocation the backpass
+ * handed to the next stage in priority order when it kept that stage's decision. a row's average
+ * is at least that of the rows after it, it could always leave its unit off, so of the stages
+ * with a decision the greedy rescan takes the first in priority order, and that is the stage the
+ * walk is at. a stage left off, or whose local min was dropped, is passed over but stays free:
+ * once a passed stage has a decision at what is left, the greedy rescan would go back to it, so
+ * the state is finished greedily from there. otherwise it is linear in stages. */
+void dp_forwardpass_walk( DPContext* pDP, void* pVoidJob, UINT32 uThread, UINT32 uBegin, UINT32 uEnd )
+{
+	DPForwardpassJob* pJob = (DPForwardpassJob*)pVoidJob;
+	UINT8* pu8StageChecklistCopy = &(pDP->pu8StageChecklistCopy[ uThread * DP_CHECKLIST_STRIDE( pDP->uStages ) ]);
+	UINT16* pu16Passed = &(pDP->pu16WalkPassedStages[ uThread * DP_CHECKLIST_STRIDE( pDP->uStages ) ]);
+	UINT32 uState, uStage, uPassed, u;
+
+	for( uState = uBegin; uState < uEnd; uState++ ) /* par */
+	{
+		UINT32 uAllocationRemaining = uState;
+
+		memcpy( pu8StageChecklistCopy, pDP->pu8StageChecklist, pDP->uStages * sizeof(UINT8) );
+		uPassed = 0;
+
+		for( uStage = 0; uStage < pDP->uActiveStages && uAllocationRemaining != 0; uStage++ )
+		{
+			UINT16 u16PrioritizedStage = pDP->pu16StageMap[ uStage ];
+			FLOAT* pfAverages = &(pDP->pfForwardDecisionAverages[ uAllocationRemaining * pDP->uStages ]); /* [ states, stages ] */
+			UINT32 uCell = u16PrioritizedStage * pDP->uStates + uAllocationRemaining;
+			UINT16 uAllocatedStateForThisStage;
+
+			if( pu8StageChecklistCopy[ u16PrioritizedStage ] == MAX_UINT8 ) { continue; } // not dispatched
+
+			for( u = 0; u < uPassed && !( pfAverages[ pu16Passed[ u ] ] > 0 ); u++ ) {}
+			if( u < uPassed ) { break; } // the greedy rescan goes back to a passed stage
+
+			if( !( pfAverages[ u16PrioritizedStage ] > 0 ) ) { pu16Passed[ uPassed++ ] = u16PrioritizedStage; continue; }
+
+			uAllocatedStateForThisStage = pDP->pu16GlobalDecisionStateMap[ uCell ];
+			if( (UINT32)uAllocatedStateForThisStage + pDP->pu16GlobalDecisionHandedMap[ uCell ] != uAllocationRemaining ) { pJob->uFailed = 1; return; }
+
+			if( uAllocatedStateForThisStage >= pDP->uProblemStepCount )
+			{
+#ifdef ENABLE_ADAPTIVEFAILURE
+				uAllocatedStateForThisStage = pDP->uProblemStepCount - 1;
+#else
+				pJob->uFailed = 1; return;
+#endif
+			}
+
+#ifdef DEBUG_FORWARDPASS
+			sprintf( gcPrintBuff, "state %lu stage %lu: allocated %lu\n", uState, u16PrioritizedStage, uAllocatedStateForThisStage );
+			PRINT_STDOUT( gcPrintBuff );
+#endif
+
+			pu8StageChecklistCopy[ u16PrioritizedStage ] = MAX_UINT8;
+			pDP->pu16Solution[ u16PrioritizedStage * pDP->uStates + uState ] = uAllocatedStateForThisStage;
+			uAllocationRemaining = pDP->pu16GlobalDecisionHandedMap[ uCell ];
+		}
+
+		if( !dp_forwardpass_greedy( pDP, pu8StageChecklistCopy, uState, uAllocationRemaining ) ) { pJob->uFailed = 1; return; }
+	}
+}
+
+/* the merge engines build a plant table bottom up from the HK rows. a node's
+ * table holds, for each allocation, the best summed HK and the number of units
+ * running in it, so that the best average can be chosen the same way the
+ * backpass chooses it. a node that appears twice below another is a unit type
+ * convolved with itself: the units it stands for are told apart when unwinding,
+ * by the order the leaves are visited in. */
+
+typedef struct tagDPMergeJob
+{
+	UINT32 uFirstNode; /* the wave's nodes, none depends on another */
+} DPMergeJob;
+
+/* one cell of a node's table. a leaf's table is its HK row, with the switched-off states
+ * counted as not running. otherwise the best average of the children's splits wins, the
+ * smallest left allocation on ties. */
+DP_INLINE void dp_merge_cell( DPContext* pDP, UINT32 uNode, UINT32 uState )
+{
+	FLOAT fTol = 1E-9;
+	DPMergeNode* pNode = &(pDP->pNodes[ uNode ]);
+	UINT32 uCell = uNode * pDP->uStates + uState;
+
+	if( uState > pNode->u16MaxState )
+	{
+		// beyond the feasible region there is no solution
+		pDP->pfNodeValues[ uCell ] = 0;
+		pDP->pu8NodeCounts[ uCell ] = 0;
+		pDP->pu16NodeSplits[ uCell ] = 0;
+	}
+	else if( pNode->u16Row != MAX_UINT16 )
+	{
+		FLOAT fHK = pDP->pfHKTableValues[ pNode->u16Row * pDP->uProblemStepCount + uState ];
+		pDP->pfNodeValues[ uCell ] = ( fHK < fTol ? 0 : fHK );
+		pDP->pu8NodeCounts[ uCell ] = ( fHK < fTol ? 0 : 1 );
+		pDP->pu16NodeSplits[ uCell ] = (UINT16)uState;
+	}
+	else
+	{
+		UINT32 uLeftMax = pDP->pNodes[ pNode->u16Left ].u16MaxState;
+		UINT32 uRightMax = pDP->pNodes[ pNode->u16Right ].u16MaxState;
+		FLOAT* pfLeftValues = &(pDP->pfNodeValues[ pNode->u16Left * pDP->uStates ]);
+		UINT8* pu8LeftCounts = &(pDP->pu8NodeCounts[ pNode->u16Left * pDP->uStates ]);
+		FLOAT* pfRightValues = &(pDP->pfNodeValues[ pNode->u16Right * pDP->uStates ]);
+		UINT8* pu8RightCounts = &(pDP->pu8NodeCounts[ pNode->u16Right * pDP->uStates ]);
+		UINT32 uLo = ( uState > uRightMax ) ? uState - uRightMax : 0;
+		UINT32 uHi = MIN( uState, uLeftMax );
+		UINT32 uBest = uLo, uLeft;
+		FLOAT fBest = -1;
+
+#define DP_MERGE_SPLIT( _uLeft ) do{ \
+			UINT32 uCount = pu8LeftCounts[ _uLeft ] + pu8RightCounts[ uState - (_uLeft) ]; \
+			FLOAT v = ( uCount == 0 ) ? 0 : ( pfLeftValues[ _uLeft ] + pfRightValues[ uState - (_uLeft) ] ) / uCount; \
+			if( v > fBest ) { fBest = v; uBest = (_uLeft); } \
+		}while(0)
+
+		if( pNode->u16Concave )
+		{
+			/* either child off, then both running. those share a count, so their best
+			 * average is their best sum, which is concave in the split: its first maximum
+			 * is where the sum stops increasing, and that bisects. */
+			UINT32 uBothLo = MAX( uLo, 1 ), uBothHi = MIN( uHi, uState - 1 );
+			if( uLo == 0 ) { DP_MERGE_SPLIT( 0 ); }
+			if( uState > 0 && uBothLo <= uBothHi )
+			{
+				while( uBothLo < uBothHi )
+				{
+					UINT32 uMid = ( uBothLo + uBothHi ) / 2;
+					if( pfLeftValues[ uMid + 1 ] + pfRightValues[ uState - uMid - 1 ] > pfLeftValues[ uMid ] + pfRightValues[ uState - uMid ] ) { uBothLo = uMid + 1; }
+					else { uBothHi = uMid; }
+				}
+				DP_MERGE_SPLIT( uBothLo );
+			}
+			if( uState > 0 && uHi == uState ) { DP_MERGE_SPLIT( uState ); }
+		}
+		else
+		{
+			for( uLeft = uLo; uLeft <= uHi; uLeft++ ) { DP_MERGE_SPLIT( uLeft ); }
+		}
+#undef DP_MERGE_SPLIT
+
+		pDP->pfNodeValues[ uCell ] = pfLeftValues[ uBest ] + pfRightValues[ uState - uBest ];
+		pDP->pu8NodeCounts[ uCell ] = pu8LeftCounts[ uBest ] + pu8RightCounts[ uState - uBest ];
+		pDP->pu16NodeSplits[ uCell ] = (UINT16)uBest;
+	}
+}
+
+/* cells [uBegin, uEnd) of a wave, counted node by node. cells are independent. */
+void dp_merge_cells( DPContext* pDP, void* pVoidJob, UINT32 uThread, UINT32 uBegin, UINT32 uEnd )
+{
+	DPMergeJob* pJob = (DPMergeJob*)pVoidJob;
+	UINT32 u;
+
+	for( u = uBegin; u < uEnd; u++ ) /* par */
+	{
+		dp_merge_cell( pDP, pJob->uFirstNode + u / pDP->uStates, u % pDP->uStates );
+	}
+}
+
+/* a leaf whose HK row is off at state 0, running at every state up to its maximum and
+ * concave over them. two of these merge by bisection, see dp_merge_cell.
+ * this is an experiment in the merge engines only. the backpass has no such path: its rows
+ * are best average tables, and the threshold rule changes their counts with the scenario,
+ * so the argmax over a row is not monotone even when the unit's table is concave. */
+UINT32 dp_merge_leaf_concave( DPContext* pDP, UINT32 uNode )
+{
+	FLOAT fTol = 1E-9;
+	DPMergeNode* pNode = &(pDP->pNodes[ uNode ]);
+	FLOAT* pfHK;
+	UINT32 uState;
+
+	if( pNode->u16Row == MAX_UINT16 ) { return 0; }
+	pfHK = &(pDP->pfHKTableValues[ pNode->u16Row * pDP->uProblemStepCount ]);
+	if( pfHK[ 0 ] >= fTol ) { return 0; }
+	for( uState = 1; uState <= pNode->u16MaxState; uState++ )
+	{
+		if( pfHK[ uState ] < fTol ) { return 0; }
+		if( uState > 1 && uState < pNode->u16MaxState && pfHK[ uState + 1 ] - pfHK[ uState ] > pfHK[ uState ] - pfHK[ uState - 1 ] ) { return 0; }
+	}
+	return 1;
+}
+
+/* add a node to the plan, returns its index */
+UINT32 dp_merge_node( DPContext* pDP, UINT32 uLeft, UINT32 uRight )
+{
+	DPMergeNode* pNode = &(pDP->pNodes[ pDP->uNodes ]);
+	pNode->u16Left = (UINT16)uLeft;
+	pNode->u16Right = (UINT16)uRight;
+	pNode->u16Row = MAX_UINT16;
+	pNode->u16Units = pDP->pNodes[ uLeft ].u16Units + pDP->pNodes[ uRight ].u16Units;
+	pNode->u16MaxState = (UINT16)MIN( (UINT32)pDP->pNodes[ uLeft ].u16MaxState + pDP->pNodes[ uRight ].u16MaxState, pDP->uStates - 1 );
+#ifdef ENABLE_CONCAVE_MERGE
+	pNode->u16Concave = (UINT16)( dp_merge_leaf_concave( pDP, uLeft ) && dp_merge_leaf_concave( pDP, uRight ) );
+#else
+	pNode->u16Concave = 0;
+#endif
+	return pDP->uNodes++;
+}
+
+UINT32 dp_merge_leaf_node( DPContext* pDP, UINT32 uStage )
+{
+	DPMergeNode* pNode = &(pDP->pNodes[ pDP->uNodes ]);
+	pNode->u16Left = pNode->u16Right = MAX_UINT16;
+	pNode->u16Row = (UINT16)pDP->pTurbs[ uStage ].uHKRow;
+	pNode->u16Units = 1;
+	pNode->u16MaxState = pDP->pu16LocalMaximumStates[ uStage ];
+	pNode->u16Concave = 0;
+	return pDP->uNodes++;
+}
+
+/* one table per unit type, by convolving the type's table with itself: a type with k
+ * units takes log2(k) doublings and a merge for each other bit of k. the types are
+ * then merged one after the other, in the order their best unit is prioritized. */
+void dp_merge_plan_grouped( DPContext* pDP )
+{
+	UINT32 uStage, uRoot = MAX_UINT32;
+
+	pDP->uNodes = 0;
+	for( uStage = 0; uStage < pDP->uActiveStages; uStage++ )
+	{
+		UINT32 uFirst = pDP->pu16StageMap[ uStage ];
+		UINT32 uRow = pDP->pTurbs[ uFirst ].uHKRow;
+		UINT32 u, uUnits = 0, uPower, uGroup = MAX_UINT32;
+
+		for( u = 0; u < uStage; u++ ) { if( pDP->pTurbs[ pDP->pu16StageMap[ u ] ].uHKRow == uRow ) { break; } }
+		if( u < uStage ) { continue; } // type already planned
+
+		for( u = uStage; u < pDP->uActiveStages; u++ )
+		{
+			if( pDP->pTurbs[ pDP->pu16StageMap[ u ] ].uHKRow == uRow ) { uUnits++; }
+		}
+
+		uPower = dp_merge_leaf_node( pDP, uFirst );
+		for( u = 1; u <= uUnits; u <<= 1 )
+		{
+			if( uUnits & u ) { uGroup = ( uGroup == MAX_UINT32 ) ? uPower : dp_merge_node( pDP, uPower, uGroup ); }
+			if( ( u << 1 ) <= uUnits ) { uPower = dp_merge_node( pDP, uPower, uPower ); }
+		}
+
+		uRoot = ( uRoot == MAX_UINT32 ) ? uGroup : dp_merge_node( pDP, uRoot, uGroup );
+	}
+}
+
+/* the stages in priority order, merged pairwise level by level. each level is one wave. */
+void dp_merge_plan_tree( DPContext* pDP )
+{
+	UINT32 uStage, uLevel, uLevelEnd;
+
+	pDP->uNodes = 0;
+	for( uStage = 0; uStage < pDP->uActiveStages; uStage++ ) { dp_merge_leaf_node( pDP, pDP->pu16StageMap[ uStage ] ); }
+
+	/* an odd node out is left just before the next level, and so is carried up into it */
+	for( uLevel = 0; pDP->uNodes - uLevel > 1; uLevel = uLevelEnd )
+	{
+		UINT32 uNode;
+		uLevelEnd = pDP->uNodes;
+		for( uNode = uLevel; uNode + 1 < uLevelEnd; uNode += 2 ) { dp_merge_node( pDP, uNode, uNode + 1 ); }
+		if( uNode < uLevelEnd ) { uLevelEnd--; }
+	}
+}
+
+/* a leaf stands for the next unit of its row each time it is visited, in priority order */
+void dp_merge_plan_stages( DPContext* pDP, UINT32 uNode, UINT32* puUnit )
+{
+	DPMergeNode* pNode = &(pDP->pNodes[ uNode ]);
+	if( pNode->u16Row != MAX_UINT16 )
+	{
+		UINT32 uStage, u;
+		for( uStage = 0; uStage < pDP->uActiveStages; uStage++ )
+		{
+			UINT16 u16Stage = pDP->pu16StageMap[ uStage ];
+			if( pDP->pTurbs[ u16Stage ].uHKRow != pNode->u16Row ) { continue; }
+			for( u = 0; u < *puUnit && pDP->pu16PlanStages[ u ] != u16Stage; u++ ) { ; }
+			if( u == *puUnit ) { break; } // not visited yet
+		}
+		pDP->pu16PlanStages[ (*puUnit)++ ] = pDP->pu16StageMap[ uStage ];
+	}
+	else
+	{
+		dp_merge_plan_stages( pDP, pNode->u16Left, puUnit );
+		dp_merge_plan_stages( pDP, pNode->u16Right, puUnit );
+	}
+}
+
+/* hand a node's allocation down to its leaves. uUnit is the leaf visit the node starts at. */
+void dp_merge_unwind( DPContext* pDP, UINT32 uNode, UINT32 uAllocation, UINT32 uUnit, UINT32 uState )
+{
+	DPMergeNode* pNode = &(pDP->pNodes[ uNode ]);
+	if( pNode->u16Row != MAX_UINT16 )
+	{
+		pDP->pu16Solution[ pDP->pu16PlanStages[ uUnit ] * pDP->uStates + uState ] = (UINT16)uAllocation;
+	}
+	else
+	{
+		UINT32 uLeft = pDP->pu16NodeSplits[ uNode * pDP->uStates + uAllocation ];
+		dp_merge_unwind( pDP, pNode->u16Left, uLeft, uUnit, uState );
+		dp_merge_unwind( pDP, pNode->u16Right, uAllocation - uLeft, uUnit + pDP->pNodes[ pNode->u16Left ].u16Units, uState );
+	}
+}
+
+/* unwind states [uBegin, uEnd) from the root. states are independent. */
+void dp_merge_unwind_states( DPContext* pDP, void* pVoidJob, UINT32 uThread, UINT32 uBegin, UINT32 uEnd )
+{
+	UINT32 uRoot = pDP->uNodes - 1;
+	UINT32 uState;
+
+	for( uState = uBegin; uState < uEnd; uState++ ) /* par */
+	{
+		// what the units can't take is left unallocated
+		dp_merge_unwind( pDP, uRoot, MIN( uState, pDP->pNodes[ uRoot ].u16MaxState ), 0, uState );
+	}
+}
+
+/* compute the plan's tables in waves of nodes whose children are all done, so the
+ * length of the longest path through the plan is what stays sequential. returns the waves. */
+UINT32 dp_merge_run( DPContext* pDP )
+{
+	UINT32 uNode, uEnd, uWaves = 0;
+
+	pDP->uConcaveMerges = 0;
+	for( uNode = 0; uNode < pDP->uNodes; uNode++ ) { pDP->uConcaveMerges += pDP->pNodes[ uNode ].u16Concave; }
+
+	for( uNode = 0; uNode < pDP->uNodes; uNode = uEnd ) /* seq */
+	{
+		DPMergeJob job;
+		for( uEnd = uNode + 1; uEnd < pDP->uNodes; uEnd++ )
+		{
+			DPMergeNode* pNode = &(pDP->pNodes[ uEnd ]);
+			if( pNode->u16Row == MAX_UINT16 && ( pNode->u16Left >= uNode || pNode->u16Right >= uNode ) ) { break; }
+		}
+		job.uFirstNode = uNode;
+		dp_pool_run( pDP, dp_merge_cells, &job, ( uEnd - uNode ) * pDP->uStates ); /* par */
+		uWaves++;
+	}
+	return uWaves;
+}
+
+/* solve with a merge plan instead of the backpass, filling gpu16Solution the same way */
+UINT32 dp_merge_solve( DPContext* pDP )
+{
+	UINT32 uWaves, uUnit;
+
+	if( pDP->uEngine == DP_ENGINE_TREE ) {
+		dp_merge_plan_tree( pDP );
+	} else {
+		dp_merge_plan_grouped( pDP );
+	}
+	VERIFY( pDP->uNodes > 0 && pDP->uNodes <= DP_MERGE_NODES( pDP ) );
+	if( ex_didFail() ) { return 0; }
+	{
+		UINT32 uUnits = 0;
+		dp_merge_plan_stages( pDP, pDP->uNodes - 1, &uUnits );
+	}
+
+	uWaves = dp_merge_run( pDP );
+
+	/* sync */
 
-		gfSolutionDelta = fCommonStepSize;
-		gfOtherSolutionDelta = fCommonStepSize * (fMaxAltDecision / fMaxDecision);
+	{
+		UINT32 uNode, uMerges = 0;
+		for( uNode = 0; uNode < pDP->uNodes; uNode++ ) { uMerges += ( pDP->pNodes[ uNode ].u16Row == MAX_UINT16 ) ? 1 : 0; }
+		if( pDP->uDebugMode )
 		{
-			FLOAT fIntT;
-			modff( fTotDecision / fCommonStepSize, &fIntT );
-			guStates = fIntT + 1; // +1 to include stage zero
-			gfStateMax = fIntT * fCommonStepSize;
+			sprintf( gcPrintBuff, "%lu merge nodes in %lu waves for %lu units\n", pDP->uNodes, uWaves, pDP->uActiveStages );
+			PRINT_STDOUT( gcPrintBuff );
 		}
+		sprintf( gcPrintBuff, "%lu of %lu merges bisected, their unit tables are concave\n", pDP->uConcaveMerges, uMerges );
+		PRINT_STDOUT( gcPrintBuff );
+	}
+
+	// below the band nothing is unwound
+	for( uUnit = 0; uUnit < pDP->uActiveStages; uUnit++ )
+	{
+		arr_uint16_set( &(pDP->pu16Solution[ pDP->pu16StageMap[ uUnit ] * pDP->uStates ]), 0, pDP->uStateLo );
 	}
+	dp_pool_run_from( pDP, dp_merge_unwind_states, 0, pDP->uStateLo, pDP->uStates ); /* par */
+	return 1;
 }
 
-/* perform allocations */
-EXTERNC void dp_malloc()
+/* plant HK tables with each unit taken out in turn, from the active units' HK rows.
+ * prefix and suffix tables over the stage order are merged once per unit, instead of
+ * solving once per unit: P(k) = P(k-1) + unit k, S(k) = unit k + S(k+1), and unit k out
+ * is P(k-1) + S(k+1). P and S are built side by side, so each wave has two merges.
+ * these are merges whatever the solve's engine, and a merge keeps the best average of its
+ * two children only, so a table can differ from a solve with the unit at weight 0. */
+/* hand an outage node's allocation down to its leaves. the scan's leaves are the active
+ * stages in priority order, so leaf k is stage pu16StageMap[ k ]. */
+void dp_outage_unwind( DPContext* pDP, FLOAT* pfSolution, FLOAT* pfAllocations, UINT32 uNode, UINT32 uAllocation, UINT32 uState )
+{
+	DPMergeNode* pNode = &(pDP->pNodes[ uNode ]);
+	if( pNode->u16Row != MAX_UINT16 )
+	{
+		UINT16 u16Stage = pDP->pu16StageMap[ uNode ];
+		pfSolution[ u16Stage * pDP->uStates + uState ] = pfAllocations[ DP_HK_ROW( pDP, u16Stage ) + uAllocation ];
+	}
+	else
+	{
+		UINT32 uLeft = pDP->pu16NodeSplits[ uNode * pDP->uStates + uAllocation ];
+		dp_outage_unwind( pDP, pfSolution, pfAllocations, pNode->u16Left, uLeft, uState );
+		dp_outage_unwind( pDP, pfSolution, pfAllocations, pNode->u16Right, uAllocation - uLeft, uState );
+	}
+}
+
+#define DP_OUTAGE_PREFIX( _n, _k ) ( (_k) == 0 ? 0 : (_n) + 2 * ( (_k) - 1 ) )
+#define DP_OUTAGE_SUFFIX( _n, _k ) ( (_k) == (_n) - 1 ? (_n) - 1 : (_n) + 2 * ( (_n) - 2 - (_k) ) + 1 )
+
+void dp_outage_scan( DPContext* pDP )
 {
-	guMALLOC = 0;
+	UINT32 n = pDP->uActiveStages;
+	UINT32 uStage, uState, k, uWaves;
+	FLOAT* pfAllocations = ( pDP->uSolveMode == DP_OPTIMIZE_FOR_POWER ) ? pDP->pfPowerAllocations : pDP->pfFlowAllocations;
 
-	VERIFY( guStages * guStates > 0 );
-	if( ex_didFail() )
+	pDP->uNodes = 0;
+	for( k = 0; k < n; k++ ) { dp_merge_leaf_node( pDP, pDP->pu16StageMap[ k ] ); }
+	for( k = 1; k < n; k++ )
 	{
-		sprintf( gcPrintBuff, "either zero Stages or States.\n" );
-		PRINT_STDOUT( gcPrintBuff );
-		return;
+		dp_merge_node( pDP, DP_OUTAGE_PREFIX( n, k - 1 ), k );
+		dp_merge_node( pDP, n - 1 - k, DP_OUTAGE_SUFFIX( n, n - k ) );
 	}
+	for( k = 1; k + 1 < n; k++ ) { dp_merge_node( pDP, DP_OUTAGE_PREFIX( n, k - 1 ), DP_OUTAGE_SUFFIX( n, k + 1 ) ); }
+	VERIFY( pDP->uNodes <= DP_MERGE_NODES( pDP ) );
+	if( ex_didFail() ) { return; }
 
-	/* the big kahuna ... */
-	DP_MALLOC_CACHE( gpfScenarioDecisionValues, FLOAT, guStates * guStates, __FILE__, __LINE__ ); /* [ states, states ] but actually triangular */
-	DP_MALLOC_CACHE( gpu16ScenarioDecisionStates, UINT16, guStates * guStates, __FILE__, __LINE__ ); /* [ states, states ] but actually triangular */
-	DP_MALLOC_CACHE( gpu8ScenarioDecisionCounts, UINT8, guStates * guStates, __FILE__, __LINE__ ); /* [ states, states ] but actually triangular */
+	uWaves = dp_merge_run( pDP );
 
-	DP_MALLOC_CACHE( gpfHKTableValues, FLOAT, guStages * guProblemStepCount, __FILE__, __LINE__ ); /* [ stages, steps ] */
-	DP_MALLOC_CACHE( gpfPowerAllocations, FLOAT, guStages * guProblemStepCount, __FILE__, __LINE__ ); /* [ stages, steps ] */
-	DP_MALLOC_CACHE( gpfFlowAllocations, FLOAT, guStages * guProblemStepCount, __FILE__, __LINE__ ); /* [ stages, steps ] */
+	/* sync */
 
-	/* other allocations... */
-	DP_MALLOC_CACHE( gpfGlobalDecisionValues, FLOAT, guStages * guStates, __FILE__, __LINE__ ); /* [ stages, states ] */
-	DP_MALLOC_CACHE( gpu8GlobalDecisionCounts, UINT8, guStages * guStates, __FILE__, __LINE__ ); /* [ stages, states ] */
-	DP_MALLOC_CACHE( gpu16GlobalDecisionStateMap, UINT16, guStages * guStates, __FILE__, __LINE__ ); /* [ stages, states ] */
-	DP_MALLOC_CACHE( gpfGlobalDecisionAllocations, FLOAT, guStages * guStates, __FILE__, __LINE__ ); /* [ stages, states ] */
-	DP_MALLOC_CACHE( gpu16Solution, UINT16, guStages * guStates, __FILE__, __LINE__ ); /* [ stages, states ] */
-	DP_MALLOC_CACHE( gpfSolution, FLOAT, guStages * guStates, __FILE__, __LINE__ ); /* [ stages, states ] */
-	DP_MALLOC_CACHE( gpfOtherSolution, FLOAT, guStages * guStates, __FILE__, __LINE__ ); /* [ stages, states ] */
-	DP_MALLOC_CACHE( gpfHKSolution, FLOAT, guStages * guStates, __FILE__, __LINE__ ); /* [ stages, states ] */
+	for( uStage = 0; uStage < pDP->uStages; uStage++ ) /* par */
+	{
+		UINT32 uNode = DP_OUTAGE_PREFIX( n, n - 1 ); // units left out of the solve change nothing
+		FLOAT* pfOutage = &(pDP->pfOutageHK[ pDP->pu16StageMap[ uStage ] * pDP->uStates ]);
+		FLOAT* pfSolution = &(pDP->pfOutageSolution[ pDP->pu16StageMap[ uStage ] * pDP->uStages * pDP->uStates ]);
 
-	/* smaller allocations */
-	DP_MALLOC_CACHE( gpfSolutionAllocations, FLOAT, guStates, __FILE__, __LINE__ ); /* [ states ] */
-	DP_MALLOC_CACHE( gpu16StateOfMax, UINT16, guStates, __FILE__, __LINE__ ); /* [ states ] */
-	DP_MALLOC_CACHE( gpfValueOfMax, FLOAT, guStates, __FILE__, __LINE__ ); /* [ states ] */
-	DP_MALLOC_CACHE( gpu8CountOfMax, UINT8, guStates, __FILE__, __LINE__ ); /* [ states ] */
-	DP_MALLOC_CACHE( gpfOtherSolutionAllocations, FLOAT, guStates, __FILE__, __LINE__ ); /* [ states ] */
-	DP_MALLOC_CACHE( gpfHKSolutionAverages, FLOAT, guStates, __FILE__, __LINE__ ); /* [ states ] */
+		if( uStage < n )
+		{
+			k = uStage;
+			if( n == 1 ) { uNode = MAX_UINT32; }
+			else if( k == 0 ) { uNode = DP_OUTAGE_SUFFIX( n, 1 ); }
+			else if( k == n - 1 ) { uNode = DP_OUTAGE_PREFIX( n, n - 2 ); }
+			else { uNode = 3 * n - 2 + ( k - 1 ); }
+		}
 
-	DP_MALLOC_CACHE( gpu16LocalNearOptimumStates, UINT16, guStages, __FILE__, __LINE__ ); /* [ stages ] */
-	DP_MALLOC_CACHE( gpu16LocalMaximumStates, UINT16, guStages, __FILE__, __LINE__ ); /* [ stages ] */
-	DP_MALLOC_CACHE( gpu16LocalOptimumStates, UINT16, guStages, __FILE__, __LINE__ ); /* [ stages ] */
-	DP_MALLOC_CACHE( gpu8StageChecklist, UINT8, guStages, __FILE__, __LINE__ ); /* [ stages ] */
-	DP_MALLOC_CACHE( gpu8StageChecklistCopy, UINT8, guStages, __FILE__, __LINE__ ); /* [ stages ] */
+		for( uState = 0; uState < pDP->uStates; uState++ )
+		{
+			UINT8 u8Count = ( uNode == MAX_UINT32 ) ? 0 : pDP->pu8NodeCounts[ uNode * pDP->uStates + uState ];
+			pfOutage[ uState ] = ( u8Count == 0 ) ? 0 : pDP->pfNodeValues[ uNode * pDP->uStates + uState ] / u8Count;
+		}
 
-	DP_MALLOC_CACHE( gpu16LocalDecisions, UINT16, guStates, __FILE__, __LINE__ ); /* [ states ] */
-	DP_MALLOC_CACHE( gpfStageMetric, FLOAT, guStates, __FILE__, __LINE__ ); /* [ states ] */
-	DP_MALLOC_CACHE( gpu16StageMap, UINT16, guStages, __FILE__, __LINE__ ); /* [ stages ] */
+		// the unit out and the inactive units stay at 0, what the rest can't take is left unallocated
+		memset( pfSolution, 0, sizeof(FLOAT) * pDP->uStages * pDP->uStates );
+		if( uNode == MAX_UINT32 ) { continue; }
+		for( uState = 0; uState < pDP->uStates; uState++ )
+		{
+			dp_outage_unwind( pDP, pfSolution, pfAllocations, uNode, MIN( uState, pDP->pNodes[ uNode ].u16MaxState ), uState );
+		}
+	}
 
-	if( guDebugMode )
+	if( pDP->uDebugMode )
 	{
-		printf( "%lu total bytes allocated\n", guMALLOC );
+		sprintf( gcPrintBuff, "%lu merge nodes in %lu waves for the outage scan\n", pDP->uNodes, uWaves );
+		PRINT_STDOUT( gcPrintBuff );
 	}
 }
 
-EXTERNC void dp_malloc_control( UINT32 uControl )
+/* marks the HK table rows from the last solve that can be reused */
+void dp_hk_cache_lookup( DPContext* pDP, FLOAT fHeadEffectOnUnit )
 {
-#ifdef ENABLE_MALLOC_CACHE
-	if( uControl == 0 ) {
-		/* disable */
-		guMemCacheOn = 0;
-	} else if( uControl == 1 ) {
-		/* enable */
-		guMemCacheOn = 1;
-	} else if( uControl == 2 ) {
-		/* flush */
-		dp_cleanup();
-	}
+	UINT32 uRow;
+	UINT32 uRowsValid = ( pDP->pfHKRows == pDP->pfHKTableValues ) && ( pDP->uHKCacheRows == pDP->uHKRows );
+	pDP->uHKHits = 0;
+	for( uRow = 0; uRow < pDP->uHKRows; uRow++ )
+	{
+		HKTableEntry* pEntry = &pDP->pHKEntries[ uRow ];
+		TurbineDef* pTurb = &pDP->pTurbs[ pDP->pu16HKRowStages[ uRow ] ];
+		HKTableKey sKey;
+		memset( &sKey, 0, sizeof(HKTableKey) );
+		sKey.uCurveHash = curve_hash( pDP, pTurb->uCurveNum );
+		sKey.uGenCurveHash = ( pTurb->uGenCurveNum != MAX_UINT32 ) ? curve_hash( pDP, pTurb->uGenCurveNum ) : 0;
+		sKey.uSolveMode = pDP->uSolveMode;
+		sKey.uProblemStepCount = pDP->uProblemStepCount;
+		sKey.fRatedHead = pTurb->fRatedHead;
+		sKey.fMaxFlow = pTurb->fMaxFlow;
+		sKey.fMaxPower = pTurb->fMaxPower;
+		sKey.fWeight = pTurb->fWeight;
+		sKey.fHeadloss = pTurb->fHeadloss;
+		sKey.fGenCapacity = pTurb->fGenCapacity;
+		sKey.fGenEfficiency = pTurb->fGenEfficiency;
+		sKey.fHeadCurr = pDP->fHeadCurr;
+		sKey.fSolutionDelta = pDP->fSolutionDelta;
+		sKey.fPlantLossCoef = pDP->fPlantLossCoef;
+		sKey.fConvFactor = pDP->fConvFactor;
+		sKey.fHeadEffectOnUnit = fHeadEffectOnUnit;
+#ifdef ENABLE_HK_CACHE
+		pEntry->uHit = uRowsValid && pEntry->uValid && ( memcmp( &pEntry->sKey, &sKey, sizeof(HKTableKey) ) == 0 );
 #else
-	dp_cleanup();
+		pEntry->uHit = 0;
 #endif
+		if( !pEntry->uHit ) { pEntry->sKey = sKey; pEntry->uValid = 0; } /* until dp_hk_cache_store */
+		pDP->uHKHits += pEntry->uHit;
+	}
+	if( !uRowsValid )
+	{
+		pDP->pfHKRows = pDP->pfHKTableValues;
+		pDP->uHKCacheRows = pDP->uHKRows;
+	}
 }
 
-EXTERNC void dp_cleanup()
+/* all rows now hold the tables for their keys */
+void dp_hk_cache_store( DPContext* pDP )
 {
-	DP_FREE_CACHE( gpfScenarioDecisionValues, FLOAT );
-	DP_FREE_CACHE( gpu16ScenarioDecisionStates, UINT16 );
-	DP_FREE_CACHE( gpu8ScenarioDecisionCounts, UINT8 );
-
-	DP_FREE_CACHE( gpfHKTableValues, FLOAT );
-	DP_FREE_CACHE( gpfPowerAllocations, FLOAT );
-	DP_FREE_CACHE( gpfGlobalDecisionValues, FLOAT );
-	DP_FREE_CACHE( gpu8GlobalDecisionCounts, UINT8 );
-	DP_FREE_CACHE( gpu16GlobalDecisionStateMap, UINT16 );
-	DP_FREE_CACHE( gpfGlobalDecisionAllocations, FLOAT );
-	DP_FREE_CACHE( gpu16Solution, UINT16 );
-	DP_FREE_CACHE( gpfSolution, FLOAT );
-	DP_FREE_CACHE( gpfOtherSolution, FLOAT );
-	DP_FREE_CACHE( gpfHKSolution, FLOAT );
-	DP_FREE_CACHE( gpfOtherSolutionAllocations, FLOAT );
-	DP_FREE_CACHE( gpfHKSolutionAverages, FLOAT );
+	UINT32 uRow;
+	for( uRow = 0; uRow < pDP->uHKRows; uRow++ ) { pDP->pHKEntries[ uRow ].uValid = 1; }
+}
 
-	DP_FREE_CACHE( gpu16StateOfMax, UINT16 );
-	DP_FREE_CACHE( gpfValueOfMax, FLOAT );
-	DP_FREE_CACHE( gpu8CountOfMax, UINT8 );
-	DP_FREE_CACHE( gpfSolutionAllocations, FLOAT );
-	DP_FREE_CACHE( gpfFlowAllocations, FLOAT );
+/* counts the positions at the top of the stage map whose backpass rows the last solve left
+ * as this one needs them. a row depends only on the units at and above its position, so each
+ * of these holds the same unit as before, on the same HK row, and that row was reused. */
+UINT32 dp_backpass_resume_count( DPContext* pDP )
+{
+	UINT32 uClean = 0;
 
-	DP_FREE_CACHE( gpu16LocalNearOptimumStates, UINT16 );
-	DP_FREE_CACHE( gpu16LocalMaximumStates, UINT16 );
-	DP_FREE_CACHE( gpu16LocalOptimumStates, UINT16 );
-	DP_FREE_CACHE( gpu8StageChecklist, UINT8 );
-	DP_FREE_CACHE( gpu8StageChecklistCopy, UINT8 );
+#ifdef ENABLE_BACKPASS_RESUME
+	UINT32 uStage;
+	if( pDP->pfResumeRows != pDP->pfGlobalDecisionValues || pDP->uRefineStates ) { return 0; }
+	if( pDP->uResumePrune != pDP->uPrune || ( pDP->uPrune && pDP->fResumeCoordinationFactorA != pDP->fCoordinationFactorA ) ) { return 0; }
+	if( pDP->uResumeStates != pDP->uStates || pDP->uResumeStages != pDP->uStages ) { return 0; }
+	if( pDP->uResumeActiveStages != pDP->uActiveStages ) { return 0; } /* the decision thresholds move */
+	if( pDP->fResumeCoordinationFactorB != pDP->fCoordinationFactorB ) { return 0; }
 
-	DP_FREE_CACHE( gpu16LocalDecisions, UINT16 );
-	DP_FREE_CACHE( gpfStageMetric, FLOAT );
-	DP_FREE_CACHE( gpu16StageMap, UINT16 );
+	for( uStage = pDP->uActiveStages; uStage-- > 0; uClean++ )
+	{
+		UINT16 u16Stage = pDP->pu16StageMap[ uStage ];
+		UINT32 uRow = pDP->pTurbs[ u16Stage ].uHKRow;
+		if( pDP->pu16ResumeStageMap[ uStage ] != u16Stage ) { break; }
+		if( pDP->pu16ResumeRows[ u16Stage ] != uRow || !pDP->pHKEntries[ uRow ].uHit ) { break; }
+	}
+#endif
+	return uClean;
 }
 
-void dp_cleanup_fatal()
+/* the tidy-up cleared the carry-forwards from the stored rows. puts them back in the
+ * clean rows, from the trivial stage down to position uFirst where the backpass resumes. */
+void dp_backpass_resume( DPContext* pDP, UINT32 uFirst )
 {
-	if( !giInteractiveMode ) {
-		dp_malloc_control( 2 );
-		parse_freeallblocks();
-		exit(-1);
+	UINT32 uStage, uState;
+	UINT16 u16Stage = pDP->pu16StageMap[ pDP->uActiveStages - 1 ];
+	FLOAT fHK = pDP->pfHKTableValues[ DP_HK_ROW( pDP, u16Stage ) ];
+
+	pDP->pfGlobalDecisionValues[ u16Stage * pDP->uStates ] = fHK;
+	pDP->pu8GlobalDecisionCounts[ u16Stage * pDP->uStates ] = ( fHK < 1E-6 ? 0 : 1 );
+
+	for( uStage = pDP->uActiveStages - 1; uStage-- > uFirst; ) /* seq */
+	{
+		UINT32 uHigher = pDP->pu16StageMap[ uStage + 1 ] * pDP->uStates;
+		UINT32 uRow = pDP->pu16StageMap[ uStage ] * pDP->uStates;
+		for( uState = 0; uState < pDP->uStates; uState++ ) /* par */
+		{
+			if( pDP->pu16GlobalDecisionStateMap[ uRow + uState ] != 0 ) { continue; }
+			pDP->pfGlobalDecisionValues[ uRow + uState ] = pDP->pfGlobalDecisionValues[ uHigher + uState ];
+			pDP->pu8GlobalDecisionCounts[ uRow + uState ] = pDP->pu8GlobalDecisionCounts[ uHigher + uState ];
+		}
 	}
 }
 
-int CDECLCALL dp_fnStageMetricComparison(const void* pA, const void* pB)
+/* records what the backpass rows were solved for */
+void dp_backpass_resume_store( DPContext* pDP )
 {
-#if 1 // removes typecast
-	FLOAT a = gpfStageMetric[ *(UINT16*)pA ];
-	FLOAT b = gpfStageMetric[ *(UINT16*)pB ];
-#else
-	UINT32 a = gpfStageMetric[ *(UINT16*)pA ];
-	UINT32 b = gpfStageMetric[ *(UINT16*)pB ];
-#endif
-
-	return a < b ? -1 : ( a > b ? 1 : 0 );
+	UINT32 uStage;
+	if( pDP->uRefineStates ) { return; } /* the rows only hold the band */
+	for( uStage = 0; uStage < pDP->uStages; uStage++ )
+	{
+		pDP->pu16ResumeStageMap[ uStage ] = pDP->pu16StageMap[ uStage ];
+		pDP->pu16ResumeRows[ uStage ] = (UINT16)pDP->pTurbs[ uStage ].uHKRow;
+	}
+	pDP->pfResumeRows = pDP->pfGlobalDecisionValues;
+	pDP->uResumeStates = pDP->uStates;
+	pDP->uResumeStages = pDP->uStages;
+	pDP->uResumeActiveStages = pDP->uActiveStages;
+	pDP->fResumeCoordinationFactorA = pDP->fCoordinationFactorA;
+	pDP->fResumeCoordinationFactorB = pDP->fCoordinationFactorB;
+	pDP->uResumePrune = pDP->uPrune;
 }
 
-EXTERNC void dp()
+EXTERNC void dp( DPContext* pDP )
 {
-	UINT32 uStage, uState, uScenario;
+	UINT32 uStage, uState, uScenario, uRow;
 	UINT16 u16PrioritizedStage;
 	FLOAT fTol = 1E-6;
+	double dStartMs = dp_clock_ms();
 
 	ex_clear();
 
 	// check for ill conditioning
-	VERIFY( gfHeadCurr > fTol );
+	VERIFY( pDP->fHeadCurr > fTol );
 	if( ex_didFail() )
 	{
 		sprintf( gcPrintBuff, "infeasible problem: zero head.\n" );
@@ -2164,8 +4217,9 @@ EXTERNC void dp()
 
 	/* sync */
 
-	arr_float_step( gpfSolutionAllocations, gfStateMin, gfSolutionDelta, guStates );
-	arr_float_step( gpfOtherSolutionAllocations, gfStateMin, gfOtherSolutionDelta, guStates );
+	/* state labels start at 0, a band only changes which states are solved and reported */
+	arr_float_step( pDP->pfSolutionAllocations, 0, pDP->fSolutionDelta, pDP->uStates );
+	arr_float_step( pDP->pfOtherSolutionAllocations, 0, pDP->fOtherSolutionDelta, pDP->uStates );
 
 	/* sync */
 
@@ -2175,54 +4229,73 @@ EXTERNC void dp()
 	// compute the flow allocations and resulting power
 
 	{
-		typedef void fnInitFunction( UINT32, FLOAT, FLOAT*, FLOAT*, UINT32 );
+		typedef void fnInitFunction( DPContext*, UINT32, FLOAT, FLOAT*, UINT8*, FLOAT*, UINT32 );
 
 #ifdef ENABLE_NEW_CALCS
 		FLOAT fHeadEffectOnUnit = 1.0;
 #else
-		FLOAT fHeadEffectOnUnit =		( guSolveMode == DP_OPTIMIZE_FOR_POWER ) ? ( gfTotalPower[0] / gfTotalPower[1] ) : ( gfTotalFlow[0] / gfTotalFlow[1] );
+		FLOAT fHeadEffectOnUnit =		( pDP->uSolveMode == DP_OPTIMIZE_FOR_POWER ) ? ( pDP->fTotalPower[0] / pDP->fTotalPower[1] ) : ( pDP->fTotalFlow[0] / pDP->fTotalFlow[1] );
 #endif
-		FLOAT* pIndepVariable =				( guSolveMode == DP_OPTIMIZE_FOR_POWER ) ? gpfPowerAllocations : gpfFlowAllocations;
-		FLOAT* pDepVariable =				( guSolveMode == DP_OPTIMIZE_FOR_POWER ) ? gpfFlowAllocations : gpfPowerAllocations;
-		fnInitFunction* pVarInitFunction =	( guSolveMode == DP_OPTIMIZE_FOR_POWER ) ? arr_turbine_q : arr_turbine_p;
-		FLOAT* pMaxTurbineParam =			( guSolveMode == DP_OPTIMIZE_FOR_POWER ) ? &(gpTurbs[ 0 ].fMaxPower) : &(gpTurbs[ 0 ].fMaxFlow);
+		FLOAT* pIndepVariable =				( pDP->uSolveMode == DP_OPTIMIZE_FOR_POWER ) ? pDP->pfPowerAllocations : pDP->pfFlowAllocations;
+		FLOAT* pDepVariable =				( pDP->uSolveMode == DP_OPTIMIZE_FOR_POWER ) ? pDP->pfFlowAllocations : pDP->pfPowerAllocations;
+		fnInitFunction* pVarInitFunction =	( pDP->uSolveMode == DP_OPTIMIZE_FOR_POWER ) ? arr_turbine_q : arr_turbine_p;
+		FLOAT* pMaxTurbineParam =			( pDP->uSolveMode == DP_OPTIMIZE_FOR_POWER ) ? &(pDP->pTurbs[ 0 ].fMaxPower) : &(pDP->pTurbs[ 0 ].fMaxFlow);
+
+		/* identical units share a row, built from the first of them */
+		for( uStage = pDP->uStages; uStage-- > 0; ) { pDP->pu16HKRowStages[ pDP->pTurbs[ uStage ].uHKRow ] = (UINT16)uStage; }
+
+		dp_hk_cache_lookup( pDP, fHeadEffectOnUnit );
+		if( pDP->uDebugMode )
+		{
+			printf( "%lu of %lu unit HK tables reused, %lu units share them\n", pDP->uHKHits, pDP->uHKRows, pDP->uStages );
+		}
 
 		/* sync */
 
-		for( uStage = 0; uStage < guStages; uStage++ ) /* par */
+		for( uRow = 0; uRow < pDP->uHKRows; uRow++ ) /* par */
 		{
-			if( gpTurbs[ uStage ].fWeight < fTol ) {
-				arr_float_set( &(pIndepVariable[ uStage * guProblemStepCount ]), 0, guProblemStepCount );
+			uStage = pDP->pu16HKRowStages[ uRow ];
+			if( pDP->pHKEntries[ uRow ].uHit ) { continue; }
+			if( pDP->pTurbs[ uStage ].fWeight < fTol ) {
+				arr_float_set( &(pIndepVariable[ uRow * pDP->uProblemStepCount ]), 0, pDP->uProblemStepCount );
 			} else {
 				FLOAT fMaxTurbineParam = *(FLOAT*)( (TurbineDef*)pMaxTurbineParam + uStage ); /* note standard pointer semantics here */
-				FLOAT fMax = fMaxTurbineParam * gpTurbs[ uStage ].fGenCapacity * fHeadEffectOnUnit;
-				UINT32 uNum = (UINT32)( ( fMax - 0 ) / gfSolutionDelta ) + 1;
+				FLOAT fMax = fMaxTurbineParam * pDP->pTurbs[ uStage ].fGenCapacity * fHeadEffectOnUnit;
+				UINT32 uNum = (UINT32)( ( fMax - 0 ) / pDP->fSolutionDelta ) + 1;
 
 				// this fails, perhaps under very low-head conditions?
-				// VERIFY( uNum <= guProblemStepCount );
+				// VERIFY( uNum <= pDP->uProblemStepCount );
 				// if( ex_didFail() ) { return; }
 				arr_float_step(
-					&(pIndepVariable[ uStage * guProblemStepCount ]),
+					&(pIndepVariable[ uRow * pDP->uProblemStepCount ]),
 					0 /* TODO: min */,
-					gfSolutionDelta,
-					MIN( guProblemStepCount, uNum )
+					pDP->fSolutionDelta,
+					MIN( pDP->uProblemStepCount, uNum )
 				);
+				if( uNum < pDP->uProblemStepCount )
+				{
+					arr_float_set( &(pIndepVariable[ uRow * pDP->uProblemStepCount + uNum ]), 0, pDP->uProblemStepCount - uNum );
+				}
 
 			}
 		}
 
 		/* sync */
 
-		for( uStage = 0; uStage < guStages; uStage++ ) /* par */
+		for( uRow = 0; uRow < pDP->uHKRows; uRow++ ) /* par */
 		{
-			if( gpTurbs[ uStage ].fWeight < fTol ) {
-				arr_float_set( &(pDepVariable[ uStage * guProblemStepCount ]), 0, guProblemStepCount );
+			uStage = pDP->pu16HKRowStages[ uRow ];
+			if( pDP->pHKEntries[ uRow ].uHit ) { continue; }
+			if( pDP->pTurbs[ uStage ].fWeight < fTol ) {
+				arr_float_set( &(pDepVariable[ uRow * pDP->uProblemStepCount ]), 0, pDP->uProblemStepCount );
+				arr_uint8_set( &(pDP->pu8Conditions[ uRow * pDP->uProblemStepCount ]), 0, pDP->uProblemStepCount );
 			} else {
 				(*pVarInitFunction)(
-					uStage, gfHeadCurr,
-					&(pDepVariable[ uStage * guProblemStepCount ]),
-					&(pIndepVariable[ uStage * guProblemStepCount ]),
-					guProblemStepCount );
+					pDP, uStage, pDP->fHeadCurr,
+					&(pDepVariable[ uRow * pDP->uProblemStepCount ]),
+					&(pDP->pu8Conditions[ uRow * pDP->uProblemStepCount ]),
+					&(pIndepVariable[ uRow * pDP->uProblemStepCount ]),
+					pDP->uProblemStepCount );
 			}
 		}
 	}
@@ -2230,35 +4303,38 @@ EXTERNC void dp()
 	/* sync */
 
 #ifdef ENABLE_OUTOFLINE_NUMERICAL_CLEANUP
-	for( uStage = 0; uStage < guStages; uStage++ ) /* par */
+	for( uRow = 0; uRow < pDP->uHKRows; uRow++ ) /* par */
 	{
-		arr_float_mark_nan_as_zero( &(gpfPowerAllocations[ uStage * guProblemStepCount ]), guProblemStepCount );
-		arr_float_mark_inf_as_zero( &(gpfPowerAllocations[ uStage * guProblemStepCount ]), guProblemStepCount );
+		arr_float_mark_nan_as_zero( &(pDP->pfPowerAllocations[ uRow * pDP->uProblemStepCount ]), pDP->uProblemStepCount );
+		arr_float_mark_inf_as_zero( &(pDP->pfPowerAllocations[ uRow * pDP->uProblemStepCount ]), pDP->uProblemStepCount );
 		//
-		arr_float_mark_nan_as_zero( &(gpfFlowAllocations[ uStage * guProblemStepCount ]), guProblemStepCount );
-		arr_float_mark_inf_as_zero( &(gpfFlowAllocations[ uStage * guProblemStepCount ]), guProblemStepCount );
+		arr_float_mark_nan_as_zero( &(pDP->pfFlowAllocations[ uRow * pDP->uProblemStepCount ]), pDP->uProblemStepCount );
+		arr_float_mark_inf_as_zero( &(pDP->pfFlowAllocations[ uRow * pDP->uProblemStepCount ]), pDP->uProblemStepCount );
 	}
 #endif
 
 	/* sync */
 
+	if( pDP->uDebugMode ) { dp_report_conditions( pDP, 1 ); }
+
 	// compute HK (the performance metric)
-	for( uStage = 0; uStage < guStages; uStage++ ) /* par */
+	for( uRow = 0; uRow < pDP->uHKRows; uRow++ ) /* par */
 	{
+		if( pDP->pHKEntries[ uRow ].uHit ) { continue; }
 		arr_float_div2(
-			&(gpfHKTableValues[ uStage * guProblemStepCount ]),
-			&(gpfPowerAllocations[ uStage * guProblemStepCount ]), /* [ stages, steps ] */
-			&(gpfFlowAllocations[ uStage * guProblemStepCount ]), /* [ stages, steps ] */
-			guProblemStepCount );
+			&(pDP->pfHKTableValues[ uRow * pDP->uProblemStepCount ]),
+			&(pDP->pfPowerAllocations[ uRow * pDP->uProblemStepCount ]), /* [ rows, steps ] */
+			&(pDP->pfFlowAllocations[ uRow * pDP->uProblemStepCount ]), /* [ rows, steps ] */
+			pDP->uProblemStepCount );
 	}
 
 	/* sync */
 
 #ifdef ENABLE_OUTOFLINE_NUMERICAL_CLEANUP
-	for( uStage = 0; uStage < guStages; uStage++ ) /* par */
+	for( uRow = 0; uRow < pDP->uHKRows; uRow++ ) /* par */
 	{
-		arr_float_mark_nan_as_zero( &(gpfHKTableValues[ uStage * guProblemStepCount ]), guProblemStepCount );
-		arr_float_mark_inf_as_zero( &(gpfHKTableValues[ uStage * guProblemStepCount ]), guProblemStepCount );
+		arr_float_mark_nan_as_zero( &(pDP->pfHKTableValues[ uRow * pDP->uProblemStepCount ]), pDP->uProblemStepCount );
+		arr_float_mark_inf_as_zero( &(pDP->pfHKTableValues[ uRow * pDP->uProblemStepCount ]), pDP->uProblemStepCount );
 	}
 #endif
 
@@ -2267,39 +4343,42 @@ EXTERNC void dp()
 #ifdef ENABLE_HK_SCALING
 
 	/* apply weighting / scaling */
-	for( uStage = 0; uStage < guStages; uStage++ ) /* par */
+	for( uRow = 0; uRow < pDP->uHKRows; uRow++ ) /* par */
 	{
+		if( pDP->pHKEntries[ uRow ].uHit ) { continue; }
 		arr_float_scale(
-			&(gpfHKTableValues[ uStage * guProblemStepCount ]),
-			gpTurbs[ uStage ].fWeight,
-			guProblemStepCount
+			&(pDP->pfHKTableValues[ uRow * pDP->uProblemStepCount ]),
+			pDP->pTurbs[ pDP->pu16HKRowStages[ uRow ] ].fWeight,
+			pDP->uProblemStepCount
 		);
 	}
 
 #endif
 
+	dp_hk_cache_store( pDP );
+
 	/* sync */
 
 #ifdef DEBUG_INITPASS
 	fprintf( stdout, "\ngpfPowerAllocations\n" );
-	for( uStage = 0; uStage < guStages; uStage++ )
+	for( uStage = 0; uStage < pDP->uStages; uStage++ )
 	{
-		sprintf( gcPrintBuff, "%s%c", gpTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
-		arr_float_print( stdout, &(gpfPowerAllocations[ uStage * guProblemStepCount ]), guProblemStepCount, gcOutputDelimiter );
+		sprintf( gcPrintBuff, "%s%c", pDP->pTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
+		arr_float_print( stdout, &(pDP->pfPowerAllocations[ DP_HK_ROW( pDP, uStage ) ]), pDP->uProblemStepCount, gcOutputDelimiter );
 	}
 
 	fprintf( stdout, "\ngpfFlowAllocations\n" );
-	for( uStage = 0; uStage < guStages; uStage++ )
+	for( uStage = 0; uStage < pDP->uStages; uStage++ )
 	{
-		sprintf( gcPrintBuff, "%s%c", gpTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
-		arr_float_print( stdout, &(gpfFlowAllocations[ uStage * guProblemStepCount ]), guProblemStepCount, gcOutputDelimiter );
+		sprintf( gcPrintBuff, "%s%c", pDP->pTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
+		arr_float_print( stdout, &(pDP->pfFlowAllocations[ DP_HK_ROW( pDP, uStage ) ]), pDP->uProblemStepCount, gcOutputDelimiter );
 	}
 
 	fprintf( stdout, "\ngpfHKTableValues\n" );
-	for( uStage = 0; uStage < guStages; uStage++ )
+	for( uStage = 0; uStage < pDP->uStages; uStage++ )
 	{
-		sprintf( gcPrintBuff, "%s%c", gpTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
-		arr_float_print( stdout, &(gpfHKTableValues[ uStage * guProblemStepCount ]), guProblemStepCount, gcOutputDelimiter );
+		sprintf( gcPrintBuff, "%s%c", pDP->pTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
+		arr_float_print( stdout, &(pDP->pfHKTableValues[ DP_HK_ROW( pDP, uStage ) ]), pDP->uProblemStepCount, gcOutputDelimiter );
 	}
 
 #endif
@@ -2307,18 +4386,18 @@ EXTERNC void dp()
 	/* sync */
 
 	// determine local optimum operating points
-	for( uStage = 0; uStage < guStages; uStage++ ) /* par */
+	for( uStage = 0; uStage < pDP->uStages; uStage++ ) /* par */
 	{
 		arr_float_max_nostride(
-			&(gpu16LocalOptimumStates[ uStage ]),
-			&(gpfHKTableValues[ uStage * guProblemStepCount ]),
-			guProblemStepCount );
+			&(pDP->pu16LocalOptimumStates[ uStage ]),
+			&(pDP->pfHKTableValues[ DP_HK_ROW( pDP, uStage ) ]),
+			pDP->uProblemStepCount );
 #if 1
 		// unit cant run
-		if( gpu16LocalOptimumStates[ uStage ] == MAX_UINT16 )
-		{ gpu16LocalOptimumStates[ uStage ] = 0; }
+		if( pDP->pu16LocalOptimumStates[ uStage ] == MAX_UINT16 )
+		{ pDP->pu16LocalOptimumStates[ uStage ] = 0; }
 #else
-		VERIFY( gpu16LocalOptimumStates[ uStage ] != MAX_UINT16 );
+		VERIFY( pDP->pu16LocalOptimumStates[ uStage ] != MAX_UINT16 );
 		if( ex_didFail() )
 		{
 			sprintf( gcPrintBuff, "unrealistic problem: flat efficiency curve.\n" );
@@ -2331,18 +4410,18 @@ EXTERNC void dp()
 	/* sync */
 
 	// determine the largest operating point
-	for( uStage = 0; uStage < guStages; uStage++ ) /* par */
+	for( uStage = 0; uStage < pDP->uStages; uStage++ ) /* par */
 	{
 		arr_float_last_nonzero_nostride(
-			&(gpu16LocalMaximumStates[ uStage ]),
-			&(gpfHKTableValues[ uStage * guProblemStepCount ]),
-			guProblemStepCount );
+			&(pDP->pu16LocalMaximumStates[ uStage ]),
+			&(pDP->pfHKTableValues[ DP_HK_ROW( pDP, uStage ) ]),
+			pDP->uProblemStepCount );
 #if 1
 		// unit cant run
-		if( gpu16LocalMaximumStates[ uStage ] == MAX_UINT16 )
-		{ gpu16LocalMaximumStates[ uStage ] = 0; }
+		if( pDP->pu16LocalMaximumStates[ uStage ] == MAX_UINT16 )
+		{ pDP->pu16LocalMaximumStates[ uStage ] = 0; }
 #else
-		VERIFY( gpu16LocalMaximumStates[ uStage ] != MAX_UINT16 );
+		VERIFY( pDP->pu16LocalMaximumStates[ uStage ] != MAX_UINT16 );
 		if( ex_didFail() )
 		{
 			sprintf( gcPrintBuff, "unrealistic problem: flat efficiency curve.\n" );
@@ -2355,14 +4434,14 @@ EXTERNC void dp()
 	/* sync */
 
 	// determine the lowest state for some percentage of optimum
-	for( uStage = 0; uStage < guStages; uStage++ ) /* par */
+	for( uStage = 0; uStage < pDP->uStages; uStage++ ) /* par */
 	{
 		arr_float_tol_nostride(
-			&(gpu16LocalNearOptimumStates[ uStage ]),
-			&(gpfHKTableValues[ uStage * guProblemStepCount ]),
-			gpu16LocalOptimumStates[ uStage ],
-			gfCoordinationFactorA,
-			guProblemStepCount );
+			&(pDP->pu16LocalNearOptimumStates[ uStage ]),
+			&(pDP->pfHKTableValues[ DP_HK_ROW( pDP, uStage ) ]),
+			pDP->pu16LocalOptimumStates[ uStage ],
+			pDP->fCoordinationFactorA,
+			pDP->uProblemStepCount );
 	}
 
 	/* sync */
@@ -2370,7 +4449,7 @@ EXTERNC void dp()
 	// check for ill conditioning...
 	{
 		UINT32 u = 0;
-		arr_uint16_sum_nostride( &u, gpu16LocalMaximumStates, guStages );
+		arr_uint16_sum_nostride( &u, pDP->pu16LocalMaximumStates, pDP->uStages );
 		VERIFY( u != 0 ); // bad
 		VERIFY( u < MAX_UINT16 ); // also bad!
 		if( ex_didFail() )
@@ -2384,26 +4463,26 @@ EXTERNC void dp()
 	/* sync */
 
 	// look for HK problems...
-	for( uStage = 0; uStage < guStages; uStage++ ) /* par */
+	for( uStage = 0; uStage < pDP->uStages; uStage++ ) /* par */
 	{
-		UINT32 uCurve = gpTurbs[ uStage ].uCurveNum;
-		UINT32 uPoints = gpCurves[ uCurve ].uPoints;
+		UINT32 uCurve = pDP->pTurbs[ uStage ].uCurveNum;
+		UINT32 uPoints = pDP->pCurves[ uCurve ].uPoints;
 		if( uPoints > 1 ) // skip small curves
 		{
-			FLOAT* pfEff = gpCurves[ uCurve ].pfEffFact;
+			FLOAT* pfEff = pDP->pCurves[ uCurve ].pfEffFact;
 			FLOAT fEff8 = pfEff[ uPoints - 2 ];
 			FLOAT fEff9 = pfEff[ uPoints - 1 ];
 			//
 			// if last point is less efficient then optimum point should come before last point
-			int bOK1 = (fEff8 > fEff9) & (gpu16LocalOptimumStates[ uStage ] < gpu16LocalMaximumStates[ uStage ]);
+			int bOK1 = (fEff8 > fEff9) & (pDP->pu16LocalOptimumStates[ uStage ] < pDP->pu16LocalMaximumStates[ uStage ]);
 			// if last point is same or best efficiency then optimum point should be last point
-			int bOK2 = (fEff8 <= fEff9) & (gpu16LocalOptimumStates[ uStage ] == gpu16LocalMaximumStates[ uStage ]);
+			int bOK2 = (fEff8 <= fEff9) & (pDP->pu16LocalOptimumStates[ uStage ] == pDP->pu16LocalMaximumStates[ uStage ]);
 			if( !( bOK1 ^ bOK2 ) )
 			{
 				sprintf( gcPrintBuff, "condition on unit %s: maximum operating point at H/K of %f and optimum operating point at H/K of %f.\n",
-					gpTurbs[ uStage ].szName,
-					gpfHKTableValues[ uStage * guProblemStepCount + gpu16LocalMaximumStates[ uStage ] ],
-					gpfHKTableValues[ uStage * guProblemStepCount + gpu16LocalOptimumStates[ uStage ] ] );
+					pDP->pTurbs[ uStage ].szName,
+					pDP->pfHKTableValues[ DP_HK_ROW( pDP, uStage ) + pDP->pu16LocalMaximumStates[ uStage ] ],
+					pDP->pfHKTableValues[ DP_HK_ROW( pDP, uStage ) + pDP->pu16LocalOptimumStates[ uStage ] ] );
 				PRINT_STDOUT( gcPrintBuff );
 			}
 		}
@@ -2412,51 +4491,112 @@ EXTERNC void dp()
 	/* sync */
 
 	// rank and sort stages in terms of lowest to highest overall performance
-	for( uStage = 0; uStage < guStages; uStage++ )
+	for( uStage = 0; uStage < pDP->uStages; uStage++ )
 	{
-		gpu16StageMap[ uStage ] = (UINT16)uStage;
+		pDP->pStageRanks[ uStage ].u16Stage = (UINT16)uStage;
 
 		// basically does an integration
 		arr_float_metric(
-			&(gpfStageMetric[ uStage ]),
-			&(gpfHKTableValues[ uStage * guProblemStepCount ]),
-			guProblemStepCount );
+			&(pDP->pStageRanks[ uStage ].fMetric),
+			&(pDP->pfHKTableValues[ DP_HK_ROW( pDP, uStage ) ]),
+			pDP->uProblemStepCount );
 
 #ifndef ENABLE_HK_SCALING // note ifndef
 
 		/* apply weighting / scaling */
-		gpfStageMetric[ uStage ] *= gpTurbs[ uStage ].fWeight;
+		pDP->pStageRanks[ uStage ].fMetric *= pDP->pTurbs[ uStage ].fWeight;
 
 #endif
 
 	}
 #ifdef ENABLE_PRIORITIZEDSTAGES
- 	qsort( gpu16StageMap, guStages, sizeof(UINT16), dp_fnStageMetricComparison );
+ 	qsort( pDP->pStageRanks, pDP->uStages, sizeof(StageRank), dp_fnStageMetricComparison );
 #endif
+	/* units that are offline or have no weight go to the back and are not solved. their
+	 * decision rows say so, and the forwardpass gives them nothing. */
+	pDP->uActiveStages = 0;
+	for( uStage = 0; uStage < pDP->uStages; uStage++ )
+	{
+		if( pDP->pTurbs[ pDP->pStageRanks[ uStage ].u16Stage ].fWeight >= fTol ) { pDP->pu16StageMap[ pDP->uActiveStages++ ] = pDP->pStageRanks[ uStage ].u16Stage; }
+	}
+	for( uStage = 0, uState = pDP->uActiveStages; uStage < pDP->uStages; uStage++ )
+	{
+		if( pDP->pTurbs[ pDP->pStageRanks[ uStage ].u16Stage ].fWeight < fTol ) { pDP->pu16StageMap[ uState++ ] = pDP->pStageRanks[ uStage ].u16Stage; }
+	}
+	/* the metrics move with the discretization, but the coarse decisions only fit the coarse order */
+	if( pDP->uRefineStates ) { arr_uint16_copy( pDP->pu16StageMap, &(pDP->pu16RefineMap[ pDP->uStages * pDP->uRefineStates ]), pDP->uStages ); }
+	for( uStage = pDP->uActiveStages; uStage < pDP->uStages; uStage++ )
+	{
+		u16PrioritizedStage = pDP->pu16StageMap[ uStage ];
+		arr_float_set( &(pDP->pfGlobalDecisionValues[ u16PrioritizedStage * pDP->uStates ]), 0, pDP->uStates );
+		arr_uint8_set( &(pDP->pu8GlobalDecisionCounts[ u16PrioritizedStage * pDP->uStates ]), 0, pDP->uStates );
+		arr_uint16_set( &(pDP->pu16GlobalDecisionStateMap[ u16PrioritizedStage * pDP->uStates ]), 0, pDP->uStates );
+		arr_uint16_set( &(pDP->pu16Solution[ u16PrioritizedStage * pDP->uStates ]), 0, pDP->uStates );
+		dp_backpass_transpose( pDP, u16PrioritizedStage );
+	}
+	if( pDP->uDebugMode )
+	{
+		printf( "%lu of %lu units available\n", pDP->uActiveStages, pDP->uStages );
+	}
 
 	/* sync */
 
+	if( pDP->uEngine != DP_ENGINE_BACKPASS )
+	{
+		// the backpass decision tables hold no decisions
+		// cleared with memset, the arr_ helpers count in UINT16 and these tables can be larger
+		memset( pDP->pfGlobalDecisionValues, 0, sizeof(FLOAT) * pDP->uStages * pDP->uStates );
+		memset( pDP->pu8GlobalDecisionCounts, 0, sizeof(UINT8) * pDP->uStages * pDP->uStates );
+		memset( pDP->pu16GlobalDecisionStateMap, 0, sizeof(UINT16) * pDP->uStages * pDP->uStates );
+		memset( pDP->pu16GlobalDecisionHandedMap, 0, sizeof(UINT16) * pDP->uStages * pDP->uStates );
+		memset( pDP->pfGlobalDecisionAllocations, 0, sizeof(FLOAT) * pDP->uStages * pDP->uStates );
+		pDP->pfResumeRows = 0;
+
+		if( !dp_merge_solve( pDP ) ) { goto cleanfailure; }
+		goto mapsolution;
+	}
+
+	/* units at the top of the stage map that did not change keep their rows from the last solve */
+	pDP->uResumedStages = dp_backpass_resume_count( pDP );
+	pDP->fBandCells = pDP->fFullCells = 0;
+	pDP->fBoundSkipped = pDP->fBoundCells = 0;
+	pDP->pfResumeRows = 0; /* until the backpass completes */
+	if( pDP->uDebugMode )
+	{
+		printf( "%lu of %lu backpass stages resumed\n", pDP->uResumedStages, pDP->uActiveStages );
+	}
+
 	//////////////////////////////////////////
 	// SOLVE TRIVIAL PROBLEM (LAST STAGE)
 
-	uStage = guStages - 1;
-	u16PrioritizedStage = gpu16StageMap[ uStage ];
+	uStage = pDP->uActiveStages - 1;
+	u16PrioritizedStage = pDP->pu16StageMap[ uStage ];
  {
-	UINT16 u16LocalMaximumState = gpu16LocalMaximumStates[ u16PrioritizedStage ];
-	UINT16 u16LocalOptimumState = gpu16LocalOptimumStates[ u16PrioritizedStage ];
-	UINT16 u16LocalCoordinationState = u16LocalMaximumState;// * gfCoordinationFactorB;//jch
+	UINT16 u16LocalMaximumState = pDP->pu16LocalMaximumStates[ u16PrioritizedStage ];
+	UINT16 u16LocalOptimumState = pDP->pu16LocalOptimumStates[ u16PrioritizedStage ];
+	UINT16 u16LocalCoordinationState = u16LocalMaximumState;// * pDP->fCoordinationFactorB;//jch
 
 	UINT16 u16FRUpperBoundState = u16LocalMaximumState;
-	UINT16 u16FRUpperBoundCount = u16FRUpperBoundState + 1;
+	UINT16 u16FRUpperBoundCount = (UINT16)MIN( (UINT32)u16FRUpperBoundState + 1, pDP->uStates ); /* a band can stop below a unit's maximum */
 
+	if( pDP->uResumedStages )
+	{
+		for( uStage = pDP->uActiveStages - 1; uStage-- > pDP->uActiveStages - pDP->uResumedStages; )
+		{
+			u16FRUpperBoundState += pDP->pu16LocalMaximumStates[ pDP->pu16StageMap[ uStage ] ];
+		}
+		dp_backpass_resume( pDP, pDP->uActiveStages - pDP->uResumedStages );
+	}
+	else
 	{
-		VERIFY( u16LocalMaximumState < guProblemStepCount );
+		VERIFY( u16LocalMaximumState < pDP->uProblemStepCount );
 		if( ex_didFail() ) { goto cleanfailure; } else
 		{
-			UINT16* pu16GlobalDecisionStateMap = &(gpu16GlobalDecisionStateMap[ u16PrioritizedStage * guStates ]);
-			FLOAT* pfGlobalDecisionValues = &(gpfGlobalDecisionValues[ u16PrioritizedStage * guStates ]);
-			FLOAT* pfProblemHK = &(gpfHKTableValues[ u16PrioritizedStage * guProblemStepCount ]);
-			UINT8* pu8GlobalDecisionCounts = &(gpu8GlobalDecisionCounts[ u16PrioritizedStage * guStates ]);
+			UINT16* pu16GlobalDecisionStateMap = &(pDP->pu16GlobalDecisionStateMap[ u16PrioritizedStage * pDP->uStates ]);
+			UINT16* pu16GlobalDecisionHandedMap = &(pDP->pu16GlobalDecisionHandedMap[ u16PrioritizedStage * pDP->uStates ]);
+			FLOAT* pfGlobalDecisionValues = &(pDP->pfGlobalDecisionValues[ u16PrioritizedStage * pDP->uStates ]);
+			FLOAT* pfProblemHK = &(pDP->pfHKTableValues[ DP_HK_ROW( pDP, u16PrioritizedStage ) ]);
+			UINT8* pu8GlobalDecisionCounts = &(pDP->pu8GlobalDecisionCounts[ u16PrioritizedStage * pDP->uStates ]);
 			FLOAT fTol = 1E-6;
 
 			for( uState = 0; uState < u16FRUpperBoundCount; uState++ )
@@ -2465,15 +4605,21 @@ EXTERNC void dp()
 				pfGlobalDecisionValues[ uState ] = pfProblemHK[ uState ];
 				pu8GlobalDecisionCounts[ uState ] = ( pfProblemHK[ uState ] < fTol ? 0 : 1 );
 			}
+			// beyond the feasible region there is no solution
+			arr_uint16_set( &(pu16GlobalDecisionStateMap[ u16FRUpperBoundCount ]), 0, pDP->uStates - u16FRUpperBoundCount );
+			arr_uint16_set( pu16GlobalDecisionHandedMap, 0, pDP->uStates ); // the last stage hands nothing on
+			arr_float_set( &(pfGlobalDecisionValues[ u16FRUpperBoundCount ]), 0, pDP->uStates - u16FRUpperBoundCount );
+			arr_uint8_set( &(pu8GlobalDecisionCounts[ u16FRUpperBoundCount ]), 0, pDP->uStates - u16FRUpperBoundCount );
 
 #ifdef DEBUG_BACKWARDPASS
 			fprintf( stdout, "\ngpfGlobalDecisionValues\n" );
-			arr_float_print( stdout, gpfSolutionAllocations, u16FRUpperBoundCount, gcOutputDelimiter );
+			arr_float_print( stdout, pDP->pfSolutionAllocations, u16FRUpperBoundCount, gcOutputDelimiter );
 			arr_float_print( stdout, pfGlobalDecisionValues, u16FRUpperBoundCount, gcOutputDelimiter );
 			arr_uint8_print( stdout, pu8GlobalDecisionCounts, u16FRUpperBoundCount, gcOutputDelimiter );
 			arr_uint16_print( stdout, pu16GlobalDecisionStateMap, u16FRUpperBoundCount, gcOutputDelimiter );
 #endif
 
+			dp_backpass_transpose( pDP, u16PrioritizedStage );
 		}
 	}
 
@@ -2482,321 +4628,279 @@ EXTERNC void dp()
 	/******************************************
 	 * BACKPASS */
 
-	for( uStage = guStages-2; uStage != MAX_UINT32; uStage-- ) /* seq */
+	for( uStage = pDP->uActiveStages - 1 - MAX( pDP->uResumedStages, 1 ); uStage != MAX_UINT32; uStage-- ) /* seq */
 	{
-		UINT32 uHigherPriorityStage = gpu16StageMap[ uStage + 1 ];
+		UINT32 uHigherPriorityStage = pDP->pu16StageMap[ uStage + 1 ];
 
-		u16PrioritizedStage = gpu16StageMap[ uStage ];
-		u16LocalMaximumState = gpu16LocalMaximumStates[ u16PrioritizedStage ];
-		u16LocalOptimumState = gpu16LocalOptimumStates[ u16PrioritizedStage ];
-		u16LocalCoordinationState = u16LocalMaximumState * gfCoordinationFactorB;
+		u16PrioritizedStage = pDP->pu16StageMap[ uStage ];
+		u16LocalMaximumState = pDP->pu16LocalMaximumStates[ u16PrioritizedStage ];
+		u16LocalOptimumState = pDP->pu16LocalOptimumStates[ u16PrioritizedStage ];
+		u16LocalCoordinationState = u16LocalMaximumState * pDP->fCoordinationFactorB;
 
 		u16FRUpperBoundState += u16LocalMaximumState;
 #if 1
-		u16FRUpperBoundCount = MIN( (UINT16)( u16FRUpperBoundState + 1 ), guStates );  // HACK shouldnt need min
+		u16FRUpperBoundCount = MIN( (UINT16)( u16FRUpperBoundState + 1 ), pDP->uStates );  // HACK shouldnt need min
 #else
 		u16FRUpperBoundCount = (UINT16)( u16FRUpperBoundState + 1 );
 
-		VERIFY( u16FRUpperBoundState < guStates );
+		VERIFY( u16FRUpperBoundState < pDP->uStates );
 		if( ex_didFail() ) { goto cleanfailure; }
 #endif
 		/* each additional stage will provide its local solutionspace */
-		for( uState = 0; uState < guStates; uState++)
+		for( uState = 0; uState < pDP->uStates; uState++)
 		{
 			if( uState <= u16LocalMaximumState ) {
 				/* for scenarios that require Q less then the unit minium, all discharge 
 				 * decisions are feasible solutions (off-cam operations are needed to
 				 * so we keep a smooth plant curve, as impractal as this may seem) */
-				gpu16LocalDecisions[ uState ] = (UINT16)uState;
+				pDP->pu16LocalDecisions[ uState ] = (UINT16)uState;
 			} else {
 				/* for scenarios that require more Q than this unit's maximum, feasible 
 				 * local discharge decisions come from only the on-cam range */
 				UINT32 uOnCamStateCount = u16LocalMaximumState - u16LocalCoordinationState + 1;
-				gpu16LocalDecisions[ uState ] = u16LocalCoordinationState + uState % uOnCamStateCount;
+				pDP->pu16LocalDecisions[ uState ] = u16LocalCoordinationState + uState % uOnCamStateCount;
 			}
 		}
 
 		/* compute the value of each possible operating decision in this stage
 		 * considering the best decisions in stages _already_ computed
-		 * (therefore, this computation goes into a matrix that is triangular) */
+		 * (therefore, this computation goes into a matrix that is triangular)
+		 * and extract this stage's best operations for each possible amount of global allocation */
 		/* limit by feasible region - this creates a diagonal in the solutionspace */
-		for( uScenario = 0; uScenario < u16FRUpperBoundCount; uScenario++ ) /* par */
 		{
-			/* record effects of local decisions */
-			for( uState = 0; uState <= uScenario; uState++ ) /* par */
+			DPBackpassJob job;
+			job.uStage = uStage;
+			job.uHigherPriorityStage = uHigherPriorityStage;
+			job.u16PrioritizedStage = u16PrioritizedStage;
+			job.u16LocalMaximumState = u16LocalMaximumState;
+			job.u16LocalCoordinationState = u16LocalCoordinationState;
+			job.uOnCamStateCount = u16LocalMaximumState - u16LocalCoordinationState + 1;
+			job.uBound = 0;
+			job.pfnKernel = 0;
+#if defined(ENABLE_SIMD) && !defined(DEBUG_BACKWARDPASS)
+			if( pDP->uSimd == DP_SIMD_AVX2 ) { job.pfnKernel = arr_float_maxplus_avx2; }
+			else if( pDP->uSimd == DP_SIMD_SSE2 ) { job.pfnKernel = arr_float_maxplus_sse2; }
+#endif
+			if( DP_BANDED( pDP ) )
 			{
-				FLOAT fTol = 1E-9;
-				UINT16 u16LocalDecision = gpu16LocalDecisions[ uState ];
-
-				FLOAT fLocalDecision = gpfHKTableValues[ u16PrioritizedStage * guProblemStepCount + u16LocalDecision ];
-				if( fLocalDecision < fTol ) { fLocalDecision = 0; u16LocalDecision = 0; }
-
+				pDP->fBandCells += dp_backpass_band( pDP, u16PrioritizedStage, u16LocalMaximumState, u16FRUpperBoundCount );
+				pDP->fFullCells += (FLOAT)u16FRUpperBoundCount * ( u16FRUpperBoundCount + 1 ) / 2;
+				dp_pool_run( pDP, dp_backpass_scenarios_band, &job, u16FRUpperBoundCount ); /* par */
+			}
+			else
+			{
+#ifdef ENABLE_BACKPASS_BOUND
+				dp_backpass_bound( pDP, &job );
+#endif
+				if( job.pfnKernel )
 				{
-					UINT16 u16GlobalDecision = uScenario - u16LocalDecision;
-					FLOAT fGlobalDecision = gpfGlobalDecisionValues[ uHigherPriorityStage * guStates + u16GlobalDecision ];
-					UINT8 u8GlobalDecisionCount = gpu8GlobalDecisionCounts[ uHigherPriorityStage * guStates + u16GlobalDecision ];
+					dp_backpass_prepare( pDP, &job );
+					dp_pool_run( pDP, dp_backpass_scenarios_simd, &job, u16FRUpperBoundCount ); /* par */
+				}
+				else
+				{
+					dp_pool_run( pDP, dp_backpass_scenarios, &job, u16FRUpperBoundCount ); /* par */
+				}
 
-					// remove option as a solution if it is likely to be a local min
-					if( u8GlobalDecisionCount < guStages - 1 - uStage && uScenario > u16LocalMaximumState )
-					{ fLocalDecision = 0; u16LocalDecision = 0; }
+				/* sync */
 
-					gpfScenarioDecisionValues[ uScenario * guStates + uState ] = fLocalDecision + fGlobalDecision;
-					gpu16ScenarioDecisionStates[ uScenario * guStates + uState ] = u16LocalDecision;
-					gpu8ScenarioDecisionCounts[ uScenario * guStates + uState ] = u8GlobalDecisionCount + ( u16LocalDecision == 0 ? 0 : 1 );
+				if( job.uBound )
+				{
+					for( uScenario = 0; uScenario < u16FRUpperBoundCount; uScenario++ ) { pDP->fBoundSkipped += pDP->pu16BoundSkips[ uScenario ]; }
+					pDP->fBoundCells += (FLOAT)u16FRUpperBoundCount * ( u16FRUpperBoundCount + 1 ) / 2;
 				}
 			}
 
+			// beyond the feasible region there is no solution
+			arr_float_set( &(pDP->pfValueOfMax[ u16FRUpperBoundCount ]), 0, pDP->uStates - u16FRUpperBoundCount );
+			arr_uint16_set( &(pDP->pu16StateOfMax[ u16FRUpperBoundCount ]), 0, pDP->uStates - u16FRUpperBoundCount );
+			arr_uint16_set( &(pDP->pu16HandedOfMax[ u16FRUpperBoundCount ]), 0, pDP->uStates - u16FRUpperBoundCount );
+			arr_uint8_set( &(pDP->pu8CountOfMax[ u16FRUpperBoundCount ]), 0, pDP->uStates - u16FRUpperBoundCount );
 		}
 
 		/* sync */
 
 #ifdef DEBUG_BACKWARDPASS
 		fprintf( stdout, "\ngpfScenarioDecisionValues\n" );
-		arr_float_print( stdout, gpfSolutionAllocations, u16FRUpperBoundCount, gcOutputDelimiter );
+		arr_float_print( stdout, pDP->pfSolutionAllocations, u16FRUpperBoundCount, gcOutputDelimiter );
 		for( uScenario = 0; uScenario < u16FRUpperBoundCount; uScenario++ ) /* par */
 		{
-			fprintf( stdout, float_format( gpfSolutionAllocations[ uScenario ] ), gpfSolutionAllocations[ uScenario ] );
+			fprintf( stdout, float_format( pDP->pfSolutionAllocations[ uScenario ] ), pDP->pfSolutionAllocations[ uScenario ] );
 			fprintf( stdout, "\n" );
 			UINT16 u16Count = (UINT16)( uScenario + 1 );
-			arr_float_print( stdout, &(gpfScenarioDecisionValues[ uScenario * guStates ]), u16Count, gcOutputDelimiter );
-			arr_uint16_print( stdout, &(gpu16ScenarioDecisionStates[ uScenario * guStates ]), u16Count, gcOutputDelimiter );
-			arr_uint8_print( stdout, &(gpu8ScenarioDecisionCounts[ uScenario * guStates ]), u16Count, gcOutputDelimiter );
+			arr_float_print( stdout, &(pDP->pfScenarioDecisionValues[ uScenario * pDP->uStates ]), u16Count, gcOutputDelimiter );
+			arr_uint16_print( stdout, &(pDP->pu16ScenarioDecisionStates[ uScenario * pDP->uStates ]), u16Count, gcOutputDelimiter );
+			arr_uint8_print( stdout, &(pDP->pu8ScenarioDecisionCounts[ uScenario * pDP->uStates ]), u16Count, gcOutputDelimiter );
 		}
 #endif
 
-		// extract this stage's best operations for each possible amount of global allocation
-		for( uScenario = 0; uScenario < u16FRUpperBoundCount; uScenario++ ) /* par */
-		{
-			UINT16 uStateOfMax = 0; // note: zero default
-			arr_float_max_nostride_count_pos(
-				&(uStateOfMax),
-				&(gpfScenarioDecisionValues[ uScenario * guStates ]),	/* [ states, states ] but actually triangular */
-				&(gpu8ScenarioDecisionCounts[ uScenario * guStates ]),	/* [ states, states ] but actually triangular */
-				uScenario + 1 );										/* NOTE + 1 to make a count */
-
-			VERIFY( uStateOfMax != MAX_UINT16 );
-			if( ex_didFail() ) { goto cleanfailure; }
-
-			/* these are all [ states, states ] but triangular */
-			gpfValueOfMax[ uScenario ] = gpfScenarioDecisionValues[ uScenario * guStates + uStateOfMax ];
-			gpu16StateOfMax[ uScenario ] = gpu16ScenarioDecisionStates[ uScenario * guStates + uStateOfMax ];
-			gpu8CountOfMax[ uScenario ] = gpu8ScenarioDecisionCounts[ uScenario * guStates + uStateOfMax ];
-		}
-
 #ifdef DEBUG_BACKWARDPASS
 		fprintf( stdout, "\ngpu16StateOfMax\n" );
-		arr_float_print( stdout, gpfSolutionAllocations, u16FRUpperBoundCount, gcOutputDelimiter );
+		arr_float_print( stdout, pDP->pfSolutionAllocations, u16FRUpperBoundCount, gcOutputDelimiter );
 		for( uScenario = 0; uScenario < u16FRUpperBoundCount; uScenario++ ) /* par */
 		{
-			fprintf( stdout, float_format( gpfSolutionAllocations[ uScenario ] ), gpfSolutionAllocations[ uScenario ] );
+			fprintf( stdout, float_format( pDP->pfSolutionAllocations[ uScenario ] ), pDP->pfSolutionAllocations[ uScenario ] );
 			fprintf( stdout, "\n" );
 			UINT16 u16Count = (UINT16)( u16FRUpperBoundState - uScenario + 1 );
-			arr_float_print( stdout, &(gpfValueOfMax[ uScenario ]), u16Count, gcOutputDelimiter );
-			arr_uint16_print( stdout, &(gpu16StateOfMax[ uScenario ]), u16Count, gcOutputDelimiter );
-			arr_uint8_print( stdout, &(gpu8CountOfMax[ uScenario ]), u16Count, gcOutputDelimiter );
+			arr_float_print( stdout, &(pDP->pfValueOfMax[ uScenario ]), u16Count, gcOutputDelimiter );
+			arr_uint16_print( stdout, &(pDP->pu16StateOfMax[ uScenario ]), u16Count, gcOutputDelimiter );
+			arr_uint8_print( stdout, &(pDP->pu8CountOfMax[ uScenario ]), u16Count, gcOutputDelimiter );
 		}
 #endif
 		/* sync */
 
 		// store the optimal operating solution for the next stage to be computed
 		arr_float_copy(
-			&(gpfGlobalDecisionValues[ u16PrioritizedStage * guStates ]),			/* [ stages, states ] */
-			gpfValueOfMax,
-			guStates ); // u16FRUpperBoundCount ?
+			&(pDP->pfGlobalDecisionValues[ u16PrioritizedStage * pDP->uStates ]),			/* [ stages, states ] */
+			pDP->pfValueOfMax,
+			pDP->uStates ); // u16FRUpperBoundCount ?
  		arr_uint16_copy(
-			&(gpu16GlobalDecisionStateMap[ u16PrioritizedStage * guStates ]),	/* [ stages, states ] */
-			gpu16StateOfMax,
-			guStates ); // u16FRUpperBoundCount ?
+			&(pDP->pu16GlobalDecisionStateMap[ u16PrioritizedStage * pDP->uStates ]),	/* [ stages, states ] */
+			pDP->pu16StateOfMax,
+			pDP->uStates ); // u16FRUpperBoundCount ?
+ 		arr_uint16_copy(
+			&(pDP->pu16GlobalDecisionHandedMap[ u16PrioritizedStage * pDP->uStates ]),	/* [ stages, states ] */
+			pDP->pu16HandedOfMax,
+			pDP->uStates );
  		arr_uint8_copy(
-			&(gpu8GlobalDecisionCounts[ u16PrioritizedStage * guStates ]),	/* [ stages, states ] */
-			gpu8CountOfMax,
-			guStates ); // u16FRUpperBoundCount ?
+			&(pDP->pu8GlobalDecisionCounts[ u16PrioritizedStage * pDP->uStates ]),	/* [ stages, states ] */
+			pDP->pu8CountOfMax,
+			pDP->uStates ); // u16FRUpperBoundCount ?
+
+		dp_backpass_transpose( pDP, u16PrioritizedStage );
 
 		/* sync */
 
 #ifdef DEBUG_BACKWARDPASS
 		fprintf( stdout, "\ngpfGlobalDecisionValues\n" );
-		arr_float_print( stdout, gpfSolutionAllocations, guStates, gcOutputDelimiter );
-		arr_float_print( stdout, &(gpfGlobalDecisionValues[ u16PrioritizedStage * guStates ]), guStates, gcOutputDelimiter );
-		arr_uint16_print( stdout, &(gpu16GlobalDecisionStateMap[ u16PrioritizedStage * guStates ]), guStates, gcOutputDelimiter );
-		arr_uint8_print( stdout, &(gpu8GlobalDecisionCounts[ u16PrioritizedStage * guStates ]), guStates, gcOutputDelimiter );
+		arr_float_print( stdout, pDP->pfSolutionAllocations, pDP->uStates, gcOutputDelimiter );
+		arr_float_print( stdout, &(pDP->pfGlobalDecisionValues[ u16PrioritizedStage * pDP->uStates ]), pDP->uStates, gcOutputDelimiter );
+		arr_uint16_print( stdout, &(pDP->pu16GlobalDecisionStateMap[ u16PrioritizedStage * pDP->uStates ]), pDP->uStates, gcOutputDelimiter );
+		arr_uint8_print( stdout, &(pDP->pu8GlobalDecisionCounts[ u16PrioritizedStage * pDP->uStates ]), pDP->uStates, gcOutputDelimiter );
 #endif
 	}
  }
+	dp_backpass_resume_store( pDP );
+	if( DP_BANDED( pDP ) && pDP->uDebugMode )
+	{
+		printf( "banded backpass tried %.0f of %.0f cells\n", pDP->fBandCells, pDP->fFullCells );
+	}
+	if( pDP->fBoundCells > 0 && pDP->uDebugMode )
+	{
+		printf( "backpass bound skipped %.0f of %.0f cells\n", pDP->fBoundSkipped, pDP->fBoundCells );
+	}
+
 	// unmap allocation states to actual allocations
-	for( uStage = 0; uStage < guStages; uStage++ ) /* par */
+	for( uStage = 0; uStage < pDP->uStages; uStage++ ) /* par */
 	{
 		arr_float_copy_indirect(
-			&(gpfGlobalDecisionAllocations[ uStage * guStates ]), /* [ stages, states ] */
-			gpfSolutionAllocations, /* [ states ] */
-			&(gpu16GlobalDecisionStateMap[ uStage * guStates ]),	 /* [ stages, states ] */
-			guStates );
+			&(pDP->pfGlobalDecisionAllocations[ uStage * pDP->uStates ]), /* [ stages, states ] */
+			pDP->pfSolutionAllocations, /* [ states ] */
+			&(pDP->pu16GlobalDecisionStateMap[ uStage * pDP->uStates ]),	 /* [ stages, states ] */
+			pDP->uStates );
 	}
 
 	/* sync */
 
 #ifdef DEBUG_BACKWARDPASS
 	fprintf( stdout, "\ngpfGlobalDecisionAllocations\n" );
-	arr_float_print( stdout, gpfSolutionAllocations, guStates, gcOutputDelimiter );
-	for( uStage = 0; uStage < guStages; uStage++ )
+	arr_float_print( stdout, pDP->pfSolutionAllocations, pDP->uStates, gcOutputDelimiter );
+	for( uStage = 0; uStage < pDP->uStages; uStage++ )
 	{
-		sprintf( gcPrintBuff, "%s%c", gpTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
-		arr_float_print( stdout, &(gpfGlobalDecisionAllocations[ uStage * guStates ]), guStates, gcOutputDelimiter );
+		sprintf( gcPrintBuff, "%s%c", pDP->pTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
+		arr_float_print( stdout, &(pDP->pfGlobalDecisionAllocations[ uStage * pDP->uStates ]), pDP->uStates, gcOutputDelimiter );
 	}
 
 	fprintf( stdout, "\ngpu16GlobalDecisionStateMap\n" );
-	arr_float_print( stdout, gpfSolutionAllocations, guStates, gcOutputDelimiter );
-	for( uStage = 0; uStage < guStages; uStage++ )
+	arr_float_print( stdout, pDP->pfSolutionAllocations, pDP->uStates, gcOutputDelimiter );
+	for( uStage = 0; uStage < pDP->uStages; uStage++ )
 	{
-		sprintf( gcPrintBuff, "%s%c", gpTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
-		arr_uint16_print( stdout, &(gpu16GlobalDecisionStateMap[ uStage * guStates ]), guStates, gcOutputDelimiter );
+		sprintf( gcPrintBuff, "%s%c", pDP->pTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
+		arr_uint16_print( stdout, &(pDP->pu16GlobalDecisionStateMap[ uStage * pDP->uStates ]), pDP->uStates, gcOutputDelimiter );
 	}
 
 	fprintf( stdout, "\ngpfHKTableValues\n" );
-	arr_float_print( stdout, gpfSolutionAllocations, guProblemStepCount, gcOutputDelimiter );
-	for( uStage = 0; uStage < guStages; uStage++ )
+	arr_float_print( stdout, pDP->pfSolutionAllocations, pDP->uProblemStepCount, gcOutputDelimiter );
+	for( uStage = 0; uStage < pDP->uStages; uStage++ )
 	{
-		sprintf( gcPrintBuff, "%s%c", gpTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
-		arr_float_print( stdout, &(gpfHKTableValues[ uStage * guProblemStepCount ]), guProblemStepCount, gcOutputDelimiter );
+		sprintf( gcPrintBuff, "%s%c", pDP->pTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
+		arr_float_print( stdout, &(pDP->pfHKTableValues[ DP_HK_ROW( pDP, uStage ) ]), pDP->uProblemStepCount, gcOutputDelimiter );
 	}
 #endif
 
 	/* tidy-up scenario's carry-forward memory - different than a complete clear!
 	   otherwise the forwardpass gets all confused. */
-	for( uStage = 0; uStage < guStages; uStage++ ) /* par */
+	for( uStage = 0; uStage < pDP->uStages; uStage++ ) /* par */
 	{
 		arr_float_clear_conditional(
-			&(gpfGlobalDecisionValues[ uStage * guStates ]),
-			&(gpu16GlobalDecisionStateMap[ uStage * guStates ]),
-			guStates
+			&(pDP->pfGlobalDecisionValues[ uStage * pDP->uStates ]),
+			&(pDP->pu16GlobalDecisionStateMap[ uStage * pDP->uStates ]),
+			pDP->uStates
 		);
 		arr_uint8_clear_conditional(
-			&(gpu8GlobalDecisionCounts[ uStage * guStates ]),
-			&(gpu16GlobalDecisionStateMap[ uStage * guStates ]),
-			guStates
+			&(pDP->pu8GlobalDecisionCounts[ uStage * pDP->uStates ]),
+			&(pDP->pu16GlobalDecisionStateMap[ uStage * pDP->uStates ]),
+			pDP->uStates
 		);
 	}
 
 	//////////////////////////////////////////
 	// FORWARDPASS
 
-#ifdef ENABLE_NONMAPPABLEELEMENTS
 	// mark solution as 'none' before we trace forwards
-	for( uStage = 0; uStage < guStages; uStage++ )
+	for( uStage = 0; uStage < pDP->uStages; uStage++ )
 	{
-		arr_uint16_set( &(gpu16Solution[ uStage * guStates ]), MAX_UINT16, guStates );
-	}
+#ifdef ENABLE_NONMAPPABLEELEMENTS
+		arr_uint16_set( &(pDP->pu16Solution[ uStage * pDP->uStates ]), MAX_UINT16, pDP->uStates );
+#else
+		arr_uint16_set( &(pDP->pu16Solution[ uStage * pDP->uStates ]), 0, pDP->uStates );
 #endif //ENABLE_NONMAPPABLEELEMENTS
+	}
 
 	// establish the stage checklist
-	for( uStage = 0; uStage < guStages; uStage++ ) /* par */
+	for( uStage = 0; uStage < pDP->uStages; uStage++ ) /* par */
 	{
-		gpu8StageChecklist[ uStage ] = ( gpTurbs[ uStage ].fWeight < fTol ) ? MAX_UINT8 : uStage;
+		pDP->pu8StageChecklist[ uStage ] = ( pDP->pTurbs[ uStage ].fWeight < fTol ) ? MAX_UINT8 : uStage;
 	}
 
 	// for each state, select the best way to make the stage allocations
-	for( uState = 0; uState < guStates; uState++ )
 	{
-		UINT32 uAllocationRemaining = MAX_UINT32;
-
-		// reinit the checklist
-		memcpy( gpu8StageChecklistCopy, gpu8StageChecklist, guStages * sizeof(UINT8) );
-
-#ifdef DEBUG_FORWARDPASS
-		sprintf( gcPrintBuff, "********* state %lu\n", uState);
-		PRINT_STDOUT( gcPrintBuff );
-#endif
-
-		uAllocationRemaining = uState;
-		while( uAllocationRemaining != 0 )
-		{
-			UINT16 u16PrioritizedStage = MAX_UINT16;
-			arr_float_max_unmarked_prioritized_count(
-					&u16PrioritizedStage,
-					&(gpfGlobalDecisionValues[ 0 * guStates + uAllocationRemaining ]), /* [ stages, states ] */
-					&(gpu8GlobalDecisionCounts[ 0 * guStates + uAllocationRemaining ]), /* [ stages, states ] */
-					gpu8StageChecklistCopy, /* [ stages ] */
-					gpu16StageMap, /* [ stages ] */
-					guStages,
-					guStates /* stride */ );
-			if( u16PrioritizedStage == MAX_UINT16 )
-			{
-
+		DPForwardpassJob job;
+		/* a coordination factor above 1 puts the on-cam decisions past the maximum, the rows lose their order */
+		fnParallelJob* pfnForwardpass = ( pDP->uForwardpass == DP_FORWARDPASS_WALK && pDP->fCoordinationFactorB <= 1 ) ? dp_forwardpass_walk : dp_forwardpass_states;
+		job.uFailed = 0;
 #ifdef DEBUG_FORWARDPASS
-				sprintf( gcPrintBuff, "%lu left unallocated\n", uAllocationRemaining );
-				PRINT_STDOUT( gcPrintBuff );
-#endif
-
-				break; // while
-			}
-			else
-			{
-				UINT16 uAllocatedStateForThisStage = MAX_UINT16;
-				VERIFY( gpu8StageChecklistCopy[ u16PrioritizedStage ] != MAX_UINT8 ); // not in use
-				if( ex_didFail() ) { goto cleanfailure; }
-
-				gpu8StageChecklistCopy[ u16PrioritizedStage ] = MAX_UINT8; // don't use this again
-				uAllocatedStateForThisStage = gpu16GlobalDecisionStateMap[ u16PrioritizedStage * guStates + uAllocationRemaining ];
-
-				VERIFY( uAllocatedStateForThisStage < guProblemStepCount );
-				if( ex_didFail() )
-				{
-#ifdef ENABLE_ADAPTIVEFAILURE
-					uAllocatedStateForThisStage = guProblemStepCount - 1;
-					ex_clear();
+		(*pfnForwardpass)( pDP, &job, 0, pDP->uStateLo, pDP->uStates ); /* keep the trace in order */
 #else
-					goto cleanfailure;
-#endif
-				}
-
-#ifdef DEBUG_FORWARDPASS
-				{
-					FLOAT fMaxValue = gpfGlobalDecisionValues[ u16PrioritizedStage * guStates + uAllocationRemaining ];
-					UINT8 u8Count = gpu8GlobalDecisionCounts[ u16PrioritizedStage * guStates + uAllocationRemaining ];
-					sprintf( gcPrintBuff, "stage %lu: allocated %lu (%f)\n",
-						u16PrioritizedStage,
-						uAllocatedStateForThisStage,
-						( u8Count == 0 ? 0.0 : fMaxValue / u8Count )
-					);
-					PRINT_STDOUT( gcPrintBuff );
-				}
-#endif
-
-				gpu16Solution[ u16PrioritizedStage * guStates + uState ] = uAllocatedStateForThisStage;
-				uAllocationRemaining -= uAllocatedStateForThisStage;
-
-			}
-
-#ifdef DEBUG_FORWARDPASS
-			sprintf( gcPrintBuff, "leaving %lu\n", uAllocationRemaining );
-			PRINT_STDOUT( gcPrintBuff );
+		dp_pool_run_from( pDP, pfnForwardpass, &job, pDP->uStateLo, pDP->uStates ); /* par */
 #endif
-
-		}
+		VERIFY( !job.uFailed );
+		if( ex_didFail() ) { goto cleanfailure; }
 	}
 
 	/* sync */
 
+mapsolution:
 	// map the solution to the flow and power values
 	{
-		FLOAT* pPower = ( guSolveMode == DP_OPTIMIZE_FOR_POWER ) ? gpfSolution : gpfOtherSolution;
-		FLOAT* pFlow = ( guSolveMode == DP_OPTIMIZE_FOR_POWER ) ? gpfOtherSolution : gpfSolution;
+		FLOAT* pPower = ( pDP->uSolveMode == DP_OPTIMIZE_FOR_POWER ) ? pDP->pfSolution : pDP->pfOtherSolution;
+		FLOAT* pFlow = ( pDP->uSolveMode == DP_OPTIMIZE_FOR_POWER ) ? pDP->pfOtherSolution : pDP->pfSolution;
 		assert( pFlow );
 		assert( pPower );
 
-		for( uStage = 0; uStage < guStages; uStage++ ) /* par */
+		for( uStage = 0; uStage < pDP->uStages; uStage++ ) /* par */
 		{
 			arr_float_copy_indirect(
-				&(pFlow[ uStage * guStates ]),							/* [ stages, states ] */
-				&(gpfFlowAllocations[ uStage * guProblemStepCount ]),	/* [ stages, steps ] */
-				&(gpu16Solution[ uStage * guStates ]),					/* [ stages, states ] */
-				guStates );
+				&(pFlow[ uStage * pDP->uStates ]),							/* [ stages, states ] */
+				&(pDP->pfFlowAllocations[ DP_HK_ROW( pDP, uStage ) ]),	/* [ rows, steps ] */
+				&(pDP->pu16Solution[ uStage * pDP->uStates ]),					/* [ stages, states ] */
+				pDP->uStates );
 
 			arr_float_copy_indirect(
-				&(pPower[ uStage * guStates ]),							/* [ stages, states ] */
-				&(gpfPowerAllocations[ uStage * guProblemStepCount ]),	/* [ stages, steps ] */
-				&(gpu16Solution[ uStage * guStates ]),					/* [ stages, states ] */
-				guStates );
+				&(pPower[ uStage * pDP->uStates ]),							/* [ stages, states ] */
+				&(pDP->pfPowerAllocations[ DP_HK_ROW( pDP, uStage ) ]),	/* [ rows, steps ] */
+				&(pDP->pu16Solution[ uStage * pDP->uStates ]),					/* [ stages, states ] */
+				pDP->uStates );
 		}
 	}
 
@@ -2804,127 +4908,228 @@ EXTERNC void dp()
 
 	// compute HK for the complete solution
 	{
-		FLOAT* pPower = ( guSolveMode == DP_OPTIMIZE_FOR_POWER ) ? gpfSolution : gpfOtherSolution;
-		FLOAT* pFlow = ( guSolveMode == DP_OPTIMIZE_FOR_POWER ) ? gpfOtherSolution : gpfSolution;
+		FLOAT* pPower = ( pDP->uSolveMode == DP_OPTIMIZE_FOR_POWER ) ? pDP->pfSolution : pDP->pfOtherSolution;
+		FLOAT* pFlow = ( pDP->uSolveMode == DP_OPTIMIZE_FOR_POWER ) ? pDP->pfOtherSolution : pDP->pfSolution;
 		assert( pPower );
 		assert( pFlow );
 
-		for( uStage = 0; uStage < guStages; uStage++ ) /* par */
+		for( uStage = 0; uStage < pDP->uStages; uStage++ ) /* par */
 		{
 			arr_float_div2(
-				&(gpfHKSolution[ uStage * guStates ]),
-				&(pPower[ uStage * guStates ]),
-				&(pFlow[ uStage * guStates ]),
-				guStates );
+				&(pDP->pfHKSolution[ uStage * pDP->uStates ]),
+				&(pPower[ uStage * pDP->uStates ]),
+				&(pFlow[ uStage * pDP->uStates ]),
+				pDP->uStates );
 		}
 	}
 
 	/* sync */
 
 	// summarise flow, power and average HK
-	arr_float_sum_stages_pos( gpfSolutionAllocations, gpfSolution, guStates, guStages ); /* [ states ] */
-	arr_float_sum_stages_pos( gpfOtherSolutionAllocations, gpfOtherSolution, guStates, guStages ); /* [ states ] */
-	arr_float_average_stages_pos( gpfHKSolutionAverages, gpfHKSolution, guStates, guStages ); /* [ states ] */
+	arr_float_sum_stages_pos( pDP->pfSolutionAllocations, pDP->pfSolution, pDP->uStates, pDP->uStages ); /* [ states ] */
+	arr_float_sum_stages_pos( pDP->pfOtherSolutionAllocations, pDP->pfOtherSolution, pDP->uStates, pDP->uStages ); /* [ states ] */
+	arr_float_average_stages_pos( pDP->pfHKSolutionAverages, pDP->pfHKSolution, pDP->uStates, pDP->uStages ); /* [ states ] */
+
+	// calibrate the time predictions of dp_plan
+	if( pDP->uActiveStages > 1 && pDP->uEngine == DP_ENGINE_BACKPASS && !pDP->uResumedStages && !DP_BANDED( pDP ) )
+	{
+		pDP->fCellNs = (FLOAT)( ( dp_clock_ms() - dStartMs ) * 1E6 * MAX( pDP->uThreads, 1 ) / dp_plan_cells( pDP ) );
+	}
+
+	if( pDP->uOutageScan ) { dp_outage_scan( pDP ); }
+
+	// the coarse pass of a refined solve hands its decisions to the fine one
+	if( DP_REFINE_COARSE( pDP ) ) { dp_refine_store( pDP ); } else { pDP->uRefineStates = 0; }
 
 	return;
 
 cleanfailure:
-	for( uStage = 0; uStage < guStages; uStage++ )
+	for( uStage = 0; uStage < pDP->uStages; uStage++ )
+	{
+		arr_uint16_set( &(pDP->pu16Solution[ uStage * pDP->uStates ]), 0, pDP->uStates ); /* [ stages, states ] */
+		arr_float_set( &(pDP->pfHKSolution[ uStage * pDP->uStates ]), 0, pDP->uStates ); /* [ stages, states ] */
+	}
+	arr_float_set( pDP->pfSolutionAllocations, 0, pDP->uStates ); /* [ states ] */
+	arr_float_set( pDP->pfOtherSolutionAllocations, 0, pDP->uStates ); /* [ states ] */
+	if( pDP->uOutageScan )
+	{
+		memset( pDP->pfOutageHK, 0, sizeof(FLOAT) * pDP->uStages * pDP->uStates ); /* [ stages, states ], can pass 65535 entries */
+		memset( pDP->pfOutageSolution, 0, sizeof(FLOAT) * pDP->uStages * pDP->uStages * pDP->uStates ); /* [ stages, stages, states ] */
+	}
+	pDP->pfResumeRows = 0;
+	pDP->uRefineStates = 0;
+}
+
+/* the plant HK with each unit out, one unit per row like the solution, then the solutions */
+void dp_print_outages( DPContext* pDP )
+{
+	CHAR* szDecisionVariable = ( pDP->uSolveMode == DP_OPTIMIZE_FOR_POWER ) ? "Power" : "Flow";
+	UINT32 uFirst = pDP->uStateLo, uCount = pDP->uStates - pDP->uStateLo;
+	UINT32 uStage, uState, uOut;
+
+	if( !pDP->uOutageScan || !pDP->pfOutageHK ) { return; }
+
+	if( guTransposeSolution == 0 ) {
+		sprintf( gcPrintBuff, "\n%s%c", szDecisionVariable, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
+		arr_float_print( stdout, &(pDP->pfSolutionAllocations[ uFirst ]), uCount, gcOutputDelimiter );
+		for( uStage = 0; uStage < pDP->uStages; uStage++ )
+		{
+			sprintf( gcPrintBuff, "%s%c", pDP->pTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
+			arr_float_print( stdout, &(pDP->pfOutageHK[ uStage * pDP->uStates + uFirst ]), uCount, gcOutputDelimiter );
+		}
+	} else {
+		fprintf( stdout, "%s%c", szDecisionVariable, gcOutputDelimiter );
+		for( uStage = 0; uStage < pDP->uStages; uStage++ ) { fprintf( stdout, "%s%c", pDP->pTurbs[ uStage ].szName, gcOutputDelimiter ); }
+		putc( '\n', stdout );
+		for( uState = uFirst; uState < pDP->uStates; uState++ )
+		{
+			float_print( stdout, pDP->pfSolutionAllocations[ uState ], gcOutputDelimiter );
+			arr_float_print_t( stdout, &(pDP->pfOutageHK[ uState ]), pDP->uStages, pDP->uStates, gcOutputDelimiter );
+			putc( '\n', stdout );
+		}
+	}
+
+	// then the solution with each unit out, a table per unit
+	for( uOut = 0; uOut < pDP->uStages; uOut++ )
+	{
+		FLOAT* pfSolution = &(pDP->pfOutageSolution[ uOut * pDP->uStages * pDP->uStates ]);
+		if( guTransposeSolution == 0 ) {
+			sprintf( gcPrintBuff, "\n%s out%c", pDP->pTurbs[ uOut ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
+			arr_float_print( stdout, &(pDP->pfSolutionAllocations[ uFirst ]), uCount, gcOutputDelimiter );
+			for( uStage = 0; uStage < pDP->uStages; uStage++ )
+			{
+				sprintf( gcPrintBuff, "%s%c", pDP->pTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
+				arr_float_print( stdout, &(pfSolution[ uStage * pDP->uStates + uFirst ]), uCount, gcOutputDelimiter );
+			}
+		} else {
+			fprintf( stdout, "\n%s out%c", pDP->pTurbs[ uOut ].szName, gcOutputDelimiter );
+			for( uStage = 0; uStage < pDP->uStages; uStage++ ) { fprintf( stdout, "%s%c", pDP->pTurbs[ uStage ].szName, gcOutputDelimiter ); }
+			putc( '\n', stdout );
+			for( uState = uFirst; uState < pDP->uStates; uState++ )
+			{
+				float_print( stdout, pDP->pfSolutionAllocations[ uState ], gcOutputDelimiter );
+				arr_float_print_t( stdout, &(pfSolution[ uState ]), pDP->uStages, pDP->uStates, gcOutputDelimiter );
+				putc( '\n', stdout );
+			}
+		}
+	}
+}
+
+/* what pruning saved in the last solve and what it cost the plant HK, against pfUnprunedHK */
+void dp_print_prune( DPContext* pDP, FLOAT* pfUnprunedHK, UINT32 uUnprunedStates )
+{
+	UINT32 uState, uChanged = 0;
+	FLOAT fDelta, fSum = 0, fMax = 0;
+
+	if( uUnprunedStates != pDP->uStates || pDP->fFullCells <= 0 )
+	{
+		PRINT_STDOUT( "Pruned and unpruned solves are not comparable.\n" );
+		return;
+	}
+
+	for( uState = 0; uState < pDP->uStates; uState++ )
 	{
-		arr_uint16_set( &(gpu16Solution[ uStage * guStates ]), 0, guStates ); /* [ stages, states ] */
-		arr_float_set( &(gpfHKSolution[ uStage * guStates ]), 0, guStates ); /* [ stages, states ] */
+		fDelta = (FLOAT)fabs( pDP->pfHKSolutionAverages[ uState ] - pfUnprunedHK[ uState ] );
+		if( fDelta > 1e-6 ) { uChanged++; }
+		fSum += fDelta;
+		fMax = MAX( fMax, fDelta );
 	}
-	arr_float_set( gpfSolutionAllocations, 0, guStates ); /* [ states ] */
-	arr_float_set( gpfOtherSolutionAllocations, 0, guStates ); /* [ states ] */
+	sprintf( gcPrintBuff, "Pruning tried %.0f of %.0f backpass cells (%.1f%%)\n",
+		pDP->fBandCells, pDP->fFullCells, 100.0 * pDP->fBandCells / pDP->fFullCells );
+	PRINT_STDOUT( gcPrintBuff );
+	sprintf( gcPrintBuff, "Plant HK changed at %lu of %lu states, by %f on average and %f at most\n",
+		uChanged, pDP->uStates, fSum / pDP->uStates, fMax );
+	PRINT_STDOUT( gcPrintBuff );
 }
 
-void dp_print_solution()
+void dp_print_solution( DPContext* pDP )
 {
-	FLOAT* pSolution = 		( guSolveMode == DP_OPTIMIZE_FOR_POWER ) ? gpfOtherSolution : gpfSolution;
-	FLOAT* pOtherSolution =	( guSolveMode == DP_OPTIMIZE_FOR_POWER ) ? gpfSolution : gpfOtherSolution;
-	CHAR* szDecisionVariable = ( guSolveMode == DP_OPTIMIZE_FOR_POWER ) ? "Power" : "Flow";
-	CHAR* szOtherDecisionVariable = ( guSolveMode == DP_OPTIMIZE_FOR_POWER ) ? "Flow" : "Power";
+	FLOAT* pSolution = 		( pDP->uSolveMode == DP_OPTIMIZE_FOR_POWER ) ? pDP->pfOtherSolution : pDP->pfSolution;
+	FLOAT* pOtherSolution =	( pDP->uSolveMode == DP_OPTIMIZE_FOR_POWER ) ? pDP->pfSolution : pDP->pfOtherSolution;
+	CHAR* szDecisionVariable = ( pDP->uSolveMode == DP_OPTIMIZE_FOR_POWER ) ? "Power" : "Flow";
+	CHAR* szOtherDecisionVariable = ( pDP->uSolveMode == DP_OPTIMIZE_FOR_POWER ) ? "Flow" : "Power";
+	UINT32 uFirst = pDP->uDebugMode ? 0 : pDP->uStateLo; /* the band, the debug tables cover every state */
 	UINT32 uStage, uState;
 
-	if( !guSolveMode )
+	if( !pDP->uSolveMode )
 	{
 		sprintf( gcPrintBuff, "%s:%d (" VERSIONED_NAME  ") Unspecified solvemode.\n", __FILE__, __LINE__ );
 		PRINT_STDERR( gcPrintBuff );
-		dp_cleanup_fatal();
+		dp_cleanup_fatal( pDP );
 		return;
 	}
 
 	if( guTransposeSolution == 0 ) {
 		sprintf( gcPrintBuff, "\n%s%c", "KW/CFS", gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
-		arr_float_print( stdout, gpfHKSolutionAverages, guStates, gcOutputDelimiter );
+		arr_float_print( stdout, &(pDP->pfHKSolutionAverages[ uFirst ]), pDP->uStates - uFirst, gcOutputDelimiter );
 		sprintf( gcPrintBuff, "%s%c", szOtherDecisionVariable, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
-		arr_float_print( stdout, gpfOtherSolutionAllocations, guStates, gcOutputDelimiter );
+		arr_float_print( stdout, &(pDP->pfOtherSolutionAllocations[ uFirst ]), pDP->uStates - uFirst, gcOutputDelimiter );
 		sprintf( gcPrintBuff, "%s%c", szDecisionVariable, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
-		arr_float_print( stdout, gpfSolutionAllocations, guStates, gcOutputDelimiter );
-		for( uStage = 0; uStage < guStages; uStage++ )
+		arr_float_print( stdout, &(pDP->pfSolutionAllocations[ uFirst ]), pDP->uStates - uFirst, gcOutputDelimiter );
+		for( uStage = 0; uStage < pDP->uStages; uStage++ )
 		{
-			sprintf( gcPrintBuff, "%s%c", gpTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
-			arr_float_print( stdout, &(gpfSolution[ uStage * guStates ]), guStates, gcOutputDelimiter );
+			sprintf( gcPrintBuff, "%s%c", pDP->pTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
+			arr_float_print( stdout, &(pDP->pfSolution[ uStage * pDP->uStates + uFirst ]), pDP->uStates - uFirst, gcOutputDelimiter );
 		}
 
-		if( guDebugMode )
+		if( pDP->uDebugMode )
 		{
 			sprintf( gcPrintBuff, "\n%s%c", szOtherDecisionVariable, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
-			arr_float_print( stdout, gpfOtherSolutionAllocations, guStates, gcOutputDelimiter );
-			for( uStage = 0; uStage < guStages; uStage++ )
+			arr_float_print( stdout, pDP->pfOtherSolutionAllocations, pDP->uStates, gcOutputDelimiter );
+			for( uStage = 0; uStage < pDP->uStages; uStage++ )
 			{
-				sprintf( gcPrintBuff, "%s%c", gpTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
-				arr_float_print( stdout, &(gpfOtherSolution[ uStage * guStates ]), guStates, gcOutputDelimiter );
+				sprintf( gcPrintBuff, "%s%c", pDP->pTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
+				arr_float_print( stdout, &(pDP->pfOtherSolution[ uStage * pDP->uStates ]), pDP->uStates, gcOutputDelimiter );
 			}
 
 			sprintf( gcPrintBuff, "\n%s%c", "KW/CFS", gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
-			arr_float_print( stdout, gpfHKSolutionAverages, guStates, gcOutputDelimiter );
-			for( uStage = 0; uStage < guStages; uStage++ )
+			arr_float_print( stdout, pDP->pfHKSolutionAverages, pDP->uStates, gcOutputDelimiter );
+			for( uStage = 0; uStage < pDP->uStages; uStage++ )
 			{
-				sprintf( gcPrintBuff, "%s%c", gpTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
-				arr_float_print( stdout, &(gpfHKSolution[ uStage * guStates ]), guStates, gcOutputDelimiter );
+				sprintf( gcPrintBuff, "%s%c", pDP->pTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
+				arr_float_print( stdout, &(pDP->pfHKSolution[ uStage * pDP->uStates ]), pDP->uStates, gcOutputDelimiter );
 			}
 
 			sprintf( gcPrintBuff, "\n%s%c", "DecisionValues", gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
-			arr_float_print( stdout, gpfSolutionAllocations, guStates, gcOutputDelimiter );
-			for( uStage = 0; uStage < guStages; uStage++ )
+			arr_float_print( stdout, pDP->pfSolutionAllocations, pDP->uStates, gcOutputDelimiter );
+			for( uStage = 0; uStage < pDP->uStages; uStage++ )
 			{
-				sprintf( gcPrintBuff, "%s%c", gpTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
-				arr_float_print( stdout, &(gpfGlobalDecisionValues[ uStage * guStates ]), guStates, gcOutputDelimiter );
+				sprintf( gcPrintBuff, "%s%c", pDP->pTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
+				arr_float_print( stdout, &(pDP->pfGlobalDecisionValues[ uStage * pDP->uStates ]), pDP->uStates, gcOutputDelimiter );
 			}
 
 			sprintf( gcPrintBuff, "\n%s%c", "DecisionCounts", gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
-			arr_float_print( stdout, gpfSolutionAllocations, guStates, gcOutputDelimiter );
-			for( uStage = 0; uStage < guStages; uStage++ )
+			arr_float_print( stdout, pDP->pfSolutionAllocations, pDP->uStates, gcOutputDelimiter );
+			for( uStage = 0; uStage < pDP->uStages; uStage++ )
 			{
-				sprintf( gcPrintBuff, "%s%c", gpTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
-				arr_uint8_print( stdout, &(gpu8GlobalDecisionCounts[ uStage * guStates ]), guStates, gcOutputDelimiter );
+				sprintf( gcPrintBuff, "%s%c", pDP->pTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
+				arr_uint8_print( stdout, &(pDP->pu8GlobalDecisionCounts[ uStage * pDP->uStates ]), pDP->uStates, gcOutputDelimiter );
 			}
 
 			sprintf( gcPrintBuff, "\n%s%c", "DecisionAllocations", gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
-			arr_float_print( stdout, gpfSolutionAllocations, guStates, gcOutputDelimiter );
-			for( uStage = 0; uStage < guStages; uStage++ )
+			arr_float_print( stdout, pDP->pfSolutionAllocations, pDP->uStates, gcOutputDelimiter );
+			for( uStage = 0; uStage < pDP->uStages; uStage++ )
 			{
-				sprintf( gcPrintBuff, "%s%c", gpTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
-				arr_float_print( stdout, &(gpfGlobalDecisionAllocations[ uStage * guStates ]), guStates, gcOutputDelimiter );
+				sprintf( gcPrintBuff, "%s%c", pDP->pTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
+				arr_float_print( stdout, &(pDP->pfGlobalDecisionAllocations[ uStage * pDP->uStates ]), pDP->uStates, gcOutputDelimiter );
 			}
 
 			sprintf( gcPrintBuff, "\n%s%c", "DecisionAllocationStates", gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
-			arr_float_print( stdout, gpfSolutionAllocations, guStates, gcOutputDelimiter );
-			for( uStage = 0; uStage < guStages; uStage++ )
+			arr_float_print( stdout, pDP->pfSolutionAllocations, pDP->uStates, gcOutputDelimiter );
+			for( uStage = 0; uStage < pDP->uStages; uStage++ )
 			{
-				sprintf( gcPrintBuff, "%s%c", gpTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
-				arr_uint16_print( stdout, &(gpu16GlobalDecisionStateMap[ uStage * guStates ]), guStates, gcOutputDelimiter );
+				sprintf( gcPrintBuff, "%s%c", pDP->pTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
+				arr_uint16_print( stdout, &(pDP->pu16GlobalDecisionStateMap[ uStage * pDP->uStates ]), pDP->uStates, gcOutputDelimiter );
 			}
 
 			sprintf( gcPrintBuff, "\nHKTableBy%s(Weighted)%c", szDecisionVariable, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
-			arr_float_print( stdout, gpfSolutionAllocations, guProblemStepCount, gcOutputDelimiter );
+			arr_float_print( stdout, pDP->pfSolutionAllocations, pDP->uProblemStepCount, gcOutputDelimiter );
 			sprintf( gcPrintBuff, "\nHKTableBy%s(Weighted)%c", szOtherDecisionVariable, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
-			arr_float_print( stdout, gpfOtherSolutionAllocations, guStates, gcOutputDelimiter );
-			for( uStage = 0; uStage < guStages; uStage++ )
+			arr_float_print( stdout, pDP->pfOtherSolutionAllocations, pDP->uStates, gcOutputDelimiter );
+			for( uStage = 0; uStage < pDP->uStages; uStage++ )
 			{
-				sprintf( gcPrintBuff, "%s%c", gpTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
-				arr_float_print( stdout, &(gpfHKTableValues[ uStage * guProblemStepCount ]), guProblemStepCount, gcOutputDelimiter );
+				sprintf( gcPrintBuff, "%s%c", pDP->pTurbs[ uStage ].szName, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
+				arr_float_print( stdout, &(pDP->pfHKTableValues[ DP_HK_ROW( pDP, uStage ) ]), pDP->uProblemStepCount, gcOutputDelimiter );
 			}
 		}
 
@@ -2932,71 +5137,71 @@ void dp_print_solution()
 		fprintf( stdout, "%s%c", "KW/CFS", gcOutputDelimiter );
 		fprintf( stdout, "%s%c", szOtherDecisionVariable, gcOutputDelimiter );
 		fprintf( stdout, "%s%c", szDecisionVariable, gcOutputDelimiter );
-		for( uStage = 0; uStage < guStages; uStage++ ) { fprintf( stdout, "%s%c", gpTurbs[ uStage ].szName, gcOutputDelimiter ); }
+		for( uStage = 0; uStage < pDP->uStages; uStage++ ) { fprintf( stdout, "%s%c", pDP->pTurbs[ uStage ].szName, gcOutputDelimiter ); }
 
-		if( guDebugMode )
+		if( pDP->uDebugMode )
 		{
 			fprintf( stdout, "%s%c", szOtherDecisionVariable, gcOutputDelimiter );
-			for( uStage = 0; uStage < guStages; uStage++ ) { fprintf( stdout, "%s%c", gpTurbs[ uStage ].szName, gcOutputDelimiter ); }
+			for( uStage = 0; uStage < pDP->uStages; uStage++ ) { fprintf( stdout, "%s%c", pDP->pTurbs[ uStage ].szName, gcOutputDelimiter ); }
 
 			fprintf( stdout, "%s%c", "KW/CFS", gcOutputDelimiter );
-			for( uStage = 0; uStage < guStages; uStage++ ) { fprintf( stdout, "%s%c", gpTurbs[ uStage ].szName, gcOutputDelimiter ); }
+			for( uStage = 0; uStage < pDP->uStages; uStage++ ) { fprintf( stdout, "%s%c", pDP->pTurbs[ uStage ].szName, gcOutputDelimiter ); }
 
 			fprintf( stdout, "%s%c", "DecisionValues", gcOutputDelimiter );
-			for( uStage = 0; uStage < guStages; uStage++ ) { fprintf( stdout, "%s%c", gpTurbs[ uStage ].szName, gcOutputDelimiter ); }
+			for( uStage = 0; uStage < pDP->uStages; uStage++ ) { fprintf( stdout, "%s%c", pDP->pTurbs[ uStage ].szName, gcOutputDelimiter ); }
 
 			fprintf( stdout, "%s%c", "DecisionCounts", gcOutputDelimiter );
-			for( uStage = 0; uStage < guStages; uStage++ ) { fprintf( stdout, "%s%c", gpTurbs[ uStage ].szName, gcOutputDelimiter ); }
+			for( uStage = 0; uStage < pDP->uStages; uStage++ ) { fprintf( stdout, "%s%c", pDP->pTurbs[ uStage ].szName, gcOutputDelimiter ); }
 
 			fprintf( stdout, "%s%c", "DecisionAllocations", gcOutputDelimiter );
-			for( uStage = 0; uStage < guStages; uStage++ ) { fprintf( stdout, "%s%c", gpTurbs[ uStage ].szName, gcOutputDelimiter ); }
+			for( uStage = 0; uStage < pDP->uStages; uStage++ ) { fprintf( stdout, "%s%c", pDP->pTurbs[ uStage ].szName, gcOutputDelimiter ); }
 
 			fprintf( stdout, "%s%c", "DecisionAllocationStates", gcOutputDelimiter );
-			for( uStage = 0; uStage < guStages; uStage++ ) { fprintf( stdout, "%s%c", gpTurbs[ uStage ].szName, gcOutputDelimiter ); }
+			for( uStage = 0; uStage < pDP->uStages; uStage++ ) { fprintf( stdout, "%s%c", pDP->pTurbs[ uStage ].szName, gcOutputDelimiter ); }
 
 			fprintf( stdout, "HKTableBy%s(Weighted)%c", szDecisionVariable, gcOutputDelimiter );
 			fprintf( stdout, "HKTableBy%s(Weighted)%c", szOtherDecisionVariable, gcOutputDelimiter );
-			for( uStage = 0; uStage < guStages; uStage++ ) { fprintf( stdout, "%s%c", gpTurbs[ uStage ].szName, gcOutputDelimiter ); }
+			for( uStage = 0; uStage < pDP->uStages; uStage++ ) { fprintf( stdout, "%s%c", pDP->pTurbs[ uStage ].szName, gcOutputDelimiter ); }
 		}
 
 		putc( '\n', stdout );
 
-		for( uState = 0; uState < guStates; uState++ )
+		for( uState = uFirst; uState < pDP->uStates; uState++ )
 		{
-			float_print( stdout, gpfHKSolutionAverages[ uState ], gcOutputDelimiter );
-			float_print( stdout, gpfOtherSolutionAllocations[ uState ], gcOutputDelimiter );
-			float_print( stdout, gpfSolutionAllocations[ uState ], gcOutputDelimiter );
-			arr_float_print_t( stdout, &(gpfSolution[ uState ]), guStages, guStates, gcOutputDelimiter );
+			float_print( stdout, pDP->pfHKSolutionAverages[ uState ], gcOutputDelimiter );
+			float_print( stdout, pDP->pfOtherSolutionAllocations[ uState ], gcOutputDelimiter );
+			float_print( stdout, pDP->pfSolutionAllocations[ uState ], gcOutputDelimiter );
+			arr_float_print_t( stdout, &(pDP->pfSolution[ uState ]), pDP->uStages, pDP->uStates, gcOutputDelimiter );
 
-			if( guDebugMode )
+			if( pDP->uDebugMode )
 			{
-				float_print( stdout, gpfOtherSolutionAllocations[ uState ], gcOutputDelimiter );
-				arr_float_print_t( stdout, &(gpfOtherSolution[ uState ]), guStages, guStates, gcOutputDelimiter );
+				float_print( stdout, pDP->pfOtherSolutionAllocations[ uState ], gcOutputDelimiter );
+				arr_float_print_t( stdout, &(pDP->pfOtherSolution[ uState ]), pDP->uStages, pDP->uStates, gcOutputDelimiter );
 
-				float_print( stdout, gpfHKSolutionAverages[ uState ], gcOutputDelimiter );
-				arr_float_print_t( stdout, &(gpfHKSolution[ uState ]), guStages, guStates, gcOutputDelimiter );
+				float_print( stdout, pDP->pfHKSolutionAverages[ uState ], gcOutputDelimiter );
+				arr_float_print_t( stdout, &(pDP->pfHKSolution[ uState ]), pDP->uStages, pDP->uStates, gcOutputDelimiter );
 
-				float_print( stdout, gpfSolutionAllocations[ uState ], gcOutputDelimiter );
-				arr_float_print_t( stdout, &(gpfGlobalDecisionValues[ uState ]), guStages, guStates, gcOutputDelimiter );
+				float_print( stdout, pDP->pfSolutionAllocations[ uState ], gcOutputDelimiter );
+				arr_float_print_t( stdout, &(pDP->pfGlobalDecisionValues[ uState ]), pDP->uStages, pDP->uStates, gcOutputDelimiter );
 
-				float_print( stdout, gpfSolutionAllocations[ uState ], gcOutputDelimiter );
-				arr_uint8_print_t( stdout, &(gpu8GlobalDecisionCounts[ uState ]), guStages, guStates, gcOutputDelimiter );
+				float_print( stdout, pDP->pfSolutionAllocations[ uState ], gcOutputDelimiter );
+				arr_uint8_print_t( stdout, &(pDP->pu8GlobalDecisionCounts[ uState ]), pDP->uStages, pDP->uStates, gcOutputDelimiter );
 
-				float_print( stdout, gpfSolutionAllocations[ uState ], gcOutputDelimiter );
-				arr_float_print_t( stdout, &(gpfGlobalDecisionAllocations[ uState ]), guStages, guStates, gcOutputDelimiter );
+				float_print( stdout, pDP->pfSolutionAllocations[ uState ], gcOutputDelimiter );
+				arr_float_print_t( stdout, &(pDP->pfGlobalDecisionAllocations[ uState ]), pDP->uStages, pDP->uStates, gcOutputDelimiter );
 
-				float_print( stdout, gpfSolutionAllocations[ uState ], gcOutputDelimiter );
-				arr_uint16_print_t( stdout, &(gpu16GlobalDecisionStateMap[ uState ]), guStages, guStates, gcOutputDelimiter );
+				float_print( stdout, pDP->pfSolutionAllocations[ uState ], gcOutputDelimiter );
+				arr_uint16_print_t( stdout, &(pDP->pu16GlobalDecisionStateMap[ uState ]), pDP->uStages, pDP->uStates, gcOutputDelimiter );
 
-				if( uState < guProblemStepCount ) {
-					float_print( stdout, gpfSolutionAllocations[ uState ], gcOutputDelimiter );
-					float_print( stdout, gpfOtherSolutionAllocations[ uState ], gcOutputDelimiter );
-					arr_float_print_t( stdout, &(gpfHKTableValues[ uState ]), guStages, guProblemStepCount, gcOutputDelimiter );
+				if( uState < pDP->uProblemStepCount ) {
+					float_print( stdout, pDP->pfSolutionAllocations[ uState ], gcOutputDelimiter );
+					float_print( stdout, pDP->pfOtherSolutionAllocations[ uState ], gcOutputDelimiter );
+					for( uStage = 0; uStage < pDP->uStages; uStage++ ) { float_print( stdout, pDP->pfHKTableValues[ DP_HK_ROW( pDP, uStage ) + uState ], gcOutputDelimiter ); }
 				} else {
 					UINT32 i = MAX_UINT32;
 					putc( gcOutputDelimiter, stdout ); /* skip column */
 					putc( gcOutputDelimiter, stdout ); /* skip column */
-					for( i = 0; i < guStages; i++ ) { putc( gcOutputDelimiter, stdout ); }
+					for( i = 0; i < pDP->uStages; i++ ) { putc( gcOutputDelimiter, stdout ); }
 				}
 			}
 
@@ -3007,20 +5212,9 @@ void dp_print_solution()
 
 /**********************************************/
 
-EXTERNC UINT32 guOPoints = 0;
-UINT32 guOPRegressions = 0; /* mod 2 */
-
-FLOAT gfOPDependent[2] = {0,0}; /* [ 2 ] */
-FLOAT* gpfOPCapacity = 0; /* [ opoints ] */
-FLOAT* gpfOPValue = 0; /* [ opoints, 2 ] */
-EXTERNC FLOAT* gpfOPCoefM = 0; /* [ opoints ] */
-EXTERNC FLOAT* gpfOPCoefB = 0; /* [ opoints ] */
-
-/**********************************************/
-
-void op_malloc()
+void op_malloc( DPContext* pDP )
 {
-	VERIFY( guOPoints > 0 );
+	VERIFY( pDP->uOPoints > 0 );
 	if( ex_didFail() )
 	{
 		sprintf( gcPrintBuff, "can't determine operating points - none defined.\n" );
@@ -3028,36 +5222,36 @@ void op_malloc()
 		return;
 	}
 
-	DP_MALLOC_CACHE( gpfOPCapacity, FLOAT, guOPoints, __FILE__, __LINE__ ); /* [ opoints ] */
-	DP_MALLOC_CACHE( gpfOPValue, FLOAT, guOPoints * 2, __FILE__, __LINE__ ); /* [ opoints, 2 ] */
-	DP_MALLOC_CACHE( gpfOPCoefM, FLOAT, guOPoints, __FILE__, __LINE__ ); /* [ opoints ] */
-	DP_MALLOC_CACHE( gpfOPCoefB, FLOAT, guOPoints, __FILE__, __LINE__ ); /* [ opoints ] */
+	DP_MALLOC_CACHE( pDP->pfOPCapacity, FLOAT, pDP->uOPoints, __FILE__, __LINE__ ); /* [ opoints ] */
+	DP_MALLOC_CACHE( pDP->pfOPValue, FLOAT, pDP->uOPoints * 2, __FILE__, __LINE__ ); /* [ opoints, 2 ] */
+	DP_MALLOC_CACHE( pDP->pfOPCoefM, FLOAT, pDP->uOPoints, __FILE__, __LINE__ ); /* [ opoints ] */
+	DP_MALLOC_CACHE( pDP->pfOPCoefB, FLOAT, pDP->uOPoints, __FILE__, __LINE__ ); /* [ opoints ] */
 }
 
-EXTERNC void op_cleanup()
+EXTERNC void op_cleanup( DPContext* pDP )
 {
-	DP_FREE_CACHE( gpfOPCapacity, FLOAT );
-	DP_FREE_CACHE( gpfOPValue, FLOAT );
-	DP_FREE_CACHE( gpfOPCoefM, FLOAT );
-	DP_FREE_CACHE( gpfOPCoefB, FLOAT );
+	DP_FREE_CACHE( pDP->pfOPCapacity, FLOAT );
+	DP_FREE_CACHE( pDP->pfOPValue, FLOAT );
+	DP_FREE_CACHE( pDP->pfOPCoefM, FLOAT );
+	DP_FREE_CACHE( pDP->pfOPCoefB, FLOAT );
 }
 
-EXTERNC void op_set_operating_capacities( UINT32 u, FLOAT* pCap )
+EXTERNC void op_set_operating_capacities( DPContext* pDP, UINT32 u, FLOAT* pCap )
 {
-	guOPRegressions = 0;
-	guOPoints = u;
+	pDP->uOPRegressions = 0;
+	pDP->uOPoints = u;
 
-	op_malloc();
-	arr_float_copy( gpfOPCapacity, pCap, u );
+	op_malloc( pDP );
+	arr_float_copy( pDP->pfOPCapacity, pCap, u );
 }
 
-EXTERNC void op_set_dependent( FLOAT fDep )
+EXTERNC void op_set_dependent( DPContext* pDP, FLOAT fDep )
 {
-	UINT32 uCurrRegression = guOPRegressions & 0x01;
-	gfOPDependent[ uCurrRegression ] = fDep;
+	UINT32 uCurrRegression = pDP->uOPRegressions & 0x01;
+	pDP->fOPDependent[ uCurrRegression ] = fDep;
 }
 
-void op_print()
+void op_print( DPContext* pDP )
 {
 	UINT32 uOPoint;
 	CHAR sCharDelim[2] = {0,0};
@@ -3065,15 +5259,15 @@ void op_print()
 
 	sprintf( gcPrintBuff, "operating points\ncapacity%cslope%cintercept\n", gcOutputDelimiter, gcOutputDelimiter );
 	PRINT_STDOUT( gcPrintBuff );
-	for( uOPoint = 0; uOPoint < guOPoints; uOPoint++ )
+	for( uOPoint = 0; uOPoint < pDP->uOPoints; uOPoint++ )
 	{
-		sprintf( gcPrintBuff, float_format( gpfOPCapacity[ uOPoint ] ), gpfOPCapacity[ uOPoint ] );
+		sprintf( gcPrintBuff, float_format( pDP->pfOPCapacity[ uOPoint ] ), pDP->pfOPCapacity[ uOPoint ] );
 		strcat( gcPrintBuff, sCharDelim );
 		PRINT_STDOUT( gcPrintBuff );
-		sprintf( gcPrintBuff, float_format( gpfOPCoefM[ uOPoint ] ), gpfOPCoefM[ uOPoint ] );
+		sprintf( gcPrintBuff, float_format( pDP->pfOPCoefM[ uOPoint ] ), pDP->pfOPCoefM[ uOPoint ] );
 		strcat( gcPrintBuff, sCharDelim );
 		PRINT_STDOUT( gcPrintBuff );
-		sprintf( gcPrintBuff, float_format( gpfOPCoefB[ uOPoint ] ), gpfOPCoefB[ uOPoint ] );
+		sprintf( gcPrintBuff, float_format( pDP->pfOPCoefB[ uOPoint ] ), pDP->pfOPCoefB[ uOPoint ] );
 		strcat( gcPrintBuff, sCharDelim );
 		PRINT_STDOUT( gcPrintBuff );
 		putc( '\n', stdout );
@@ -3082,13 +5276,13 @@ void op_print()
 
 /* call this to sample H/K for defined operating points and compute a
  * linear fit from consecutive optimization configurations. */
-EXTERNC void op_regress()
+EXTERNC void op_regress( DPContext* pDP )
 {
 	UINT32 uState, uOPoint;
-	UINT32 uCurrRegression = guOPRegressions & 0x01;
+	UINT32 uCurrRegression = pDP->uOPRegressions & 0x01;
 	FLOAT fTotDecision;
 
-	VERIFY( guOPoints > 0 );
+	VERIFY( pDP->uOPoints > 0 );
 	if( ex_didFail() )
 	{
 		sprintf( gcPrintBuff, "can't determine operating points - none defined.\n" );
@@ -3096,36 +5290,36 @@ EXTERNC void op_regress()
 		return;
 	}
 
-	fTotDecision = (guSolveMode == DP_OPTIMIZE_FOR_POWER) ? gfTotalPower[0] : gfTotalFlow[0];
+	fTotDecision = (pDP->uSolveMode == DP_OPTIMIZE_FOR_POWER) ? pDP->fTotalPower[0] : pDP->fTotalFlow[0];
 
 	/* collect HK values */
-	for( uOPoint = 0; uOPoint < guOPoints; uOPoint++ )
+	for( uOPoint = 0; uOPoint < pDP->uOPoints; uOPoint++ )
 	{
-		gpfOPValue[ uCurrRegression * guOPoints + uOPoint ] = 0;
+		pDP->pfOPValue[ uCurrRegression * pDP->uOPoints + uOPoint ] = 0;
 
-		for( uState = 1; uState < guStates; uState++ )
+		for( uState = 1; uState < pDP->uStates; uState++ )
 		{
-			if( gpfSolutionAllocations[ uState ] > gpfOPCapacity[ uOPoint ] * fTotDecision ) { break; }
+			if( pDP->pfSolutionAllocations[ uState ] > pDP->pfOPCapacity[ uOPoint ] * fTotDecision ) { break; }
 			/* due to rounding of problem domain we might end up with extra output. so we will extrapolate. */
-			if( gpfSolutionAllocations[ uState ] < gpfSolutionAllocations[ uState - 1 ] ) { uState--; break; }
+			if( pDP->pfSolutionAllocations[ uState ] < pDP->pfSolutionAllocations[ uState - 1 ] ) { uState--; break; }
 		}
 
 		/* catch run-off from table and change state so we can extrapolate */
-		if( uState == guStates ) { uState--; }
+		if( uState == pDP->uStates ) { uState--; }
 
 		{
 			/* interpolate HK for operating point of interest */
 			/* also works to extrapolate */
-			FLOAT fSOLBase = gpfSolutionAllocations[ uState - 1 ];
-			FLOAT fCAPDelta = gpfOPCapacity[ uOPoint ] * fTotDecision - fSOLBase;
-			FLOAT fSOLDelta = gpfSolutionAllocations[ uState ] - fSOLBase;
-			FLOAT fHKBase = gpfHKSolutionAverages[ uState - 1 ];
-			FLOAT fHKDelta = gpfHKSolutionAverages[ uState ] - fHKBase;
+			FLOAT fSOLBase = pDP->pfSolutionAllocations[ uState - 1 ];
+			FLOAT fCAPDelta = pDP->pfOPCapacity[ uOPoint ] * fTotDecision - fSOLBase;
+			FLOAT fSOLDelta = pDP->pfSolutionAllocations[ uState ] - fSOLBase;
+			FLOAT fHKBase = pDP->pfHKSolutionAverages[ uState - 1 ];
+			FLOAT fHKDelta = pDP->pfHKSolutionAverages[ uState ] - fHKBase;
 			/* only last 2 samples used */
 			if( fSOLDelta < 1 ) {
-				gpfOPValue[ uCurrRegression * guOPoints + uOPoint ] = fHKBase;
+				pDP->pfOPValue[ uCurrRegression * pDP->uOPoints + uOPoint ] = fHKBase;
 			} else {
-				gpfOPValue[ uCurrRegression * guOPoints + uOPoint ] = fHKBase + fHKDelta * (fCAPDelta / fSOLDelta);
+				pDP->pfOPValue[ uCurrRegression * pDP->uOPoints + uOPoint ] = fHKBase + fHKDelta * (fCAPDelta / fSOLDelta);
 			}
 		}
 
@@ -3133,22 +5327,22 @@ EXTERNC void op_regress()
 			FLOAT fTol = 1e-6;
 			FLOAT fB = 0;
 			FLOAT fM = 0;
-			if( uState >= guStates ) {
-				UINT32 uSolutionUnits = ( guSolveMode == DP_OPTIMIZE_FOR_POWER ) ? DP_UNIT_POWER : DP_UNIT_FLOW;
-				sprintf( gcPrintBuff, "regress: operating point %f %s can't be found in solution.\n", gpfOPCapacity[ uOPoint ], char_units( uSolutionUnits ) );
+			if( uState >= pDP->uStates ) {
+				UINT32 uSolutionUnits = ( pDP->uSolveMode == DP_OPTIMIZE_FOR_POWER ) ? DP_UNIT_POWER : DP_UNIT_FLOW;
+				sprintf( gcPrintBuff, "regress: operating point %f %s can't be found in solution.\n", pDP->pfOPCapacity[ uOPoint ], char_units( pDP, uSolutionUnits ) );
 				PRINT_STDOUT( gcPrintBuff );
 			} else {
-				if( guOPRegressions == 0 ) {
-					fB = gpfOPValue[ 0 * guOPoints + uOPoint ];
+				if( pDP->uOPRegressions == 0 ) {
+					fB = pDP->pfOPValue[ 0 * pDP->uOPoints + uOPoint ];
 				} else {
 					/* interpolate from earlier (A) to most recent point (B) */
 					UINT32 uA = ( uCurrRegression == 1 ) ? 0 : 1;
 					UINT32 uB = (uA == 1) ? 0 : 1;
-					FLOAT fValA = gpfOPValue[ uA * guOPoints + uOPoint ];
-					FLOAT fValB = gpfOPValue[ uB * guOPoints + uOPoint ];
+					FLOAT fValA = pDP->pfOPValue[ uA * pDP->uOPoints + uOPoint ];
+					FLOAT fValB = pDP->pfOPValue[ uB * pDP->uOPoints + uOPoint ];
 					FLOAT fValDelta = fValB - fValA; /* from A to B */
-					FLOAT fDepA = gfOPDependent[ uA ];
-					FLOAT fDepB = gfOPDependent[ uB ];
+					FLOAT fDepA = pDP->fOPDependent[ uA ];
+					FLOAT fDepB = pDP->fOPDependent[ uB ];
 					FLOAT fDepDelta = fDepB - fDepA; /* from A to B */
 					/* fit line between values for each specified capacity */
 					FLOAT fTol = 1E-6;
@@ -3156,26 +5350,19 @@ EXTERNC void op_regress()
 					fB = fValB - fM * fDepB; /* y = m x + b, solve for b */
 				}
 			}
-			gpfOPCoefB[ uOPoint ] = fB;
-			gpfOPCoefM[ uOPoint ] = fM;
+			pDP->pfOPCoefB[ uOPoint ] = fB;
+			pDP->pfOPCoefM[ uOPoint ] = fM;
 		}
 	}
 
-	guOPRegressions++;
+	pDP->uOPRegressions++;
 }
 
 /**********************************************/
 
-EXTERNC FLOAT gfDispatch = 0;
-EXTERNC FLOAT* gpfUDSolution = 0; /* [ stages ] */
-EXTERNC FLOAT* gpfUDOtherSolution = 0; /* [ stages ] */
-EXTERNC FLOAT* gpfUDHKSolution = 0; /* [ stages ] */
-
-/************/
-
-EXTERNC void ud_malloc()
+EXTERNC void ud_malloc( DPContext* pDP )
 {
-	VERIFY( guStages > 0 );
+	VERIFY( pDP->uStages > 0 );
 	if( ex_didFail() )
 	{
 		sprintf( gcPrintBuff, "unit dispatch: no stages defined.\n" );
@@ -3183,21 +5370,21 @@ EXTERNC void ud_malloc()
 		return;
 	}
 
-	DP_MALLOC_CACHE( gpfUDSolution, FLOAT, guStages, __FILE__, __LINE__ ); /* [ stages ] */
-	DP_MALLOC_CACHE( gpfUDOtherSolution, FLOAT, guStages, __FILE__, __LINE__ ); /* [ stages ] */
-	DP_MALLOC_CACHE( gpfUDHKSolution, FLOAT, guStages, __FILE__, __LINE__ ); /* [ stages ] */
+	DP_MALLOC_CACHE( pDP->pfUDSolution, FLOAT, pDP->uStages, __FILE__, __LINE__ ); /* [ stages ] */
+	DP_MALLOC_CACHE( pDP->pfUDOtherSolution, FLOAT, pDP->uStages, __FILE__, __LINE__ ); /* [ stages ] */
+	DP_MALLOC_CACHE( pDP->pfUDHKSolution, FLOAT, pDP->uStages, __FILE__, __LINE__ ); /* [ stages ] */
 }
 
-EXTERNC void ud_cleanup()
+EXTERNC void ud_cleanup( DPContext* pDP )
 {
-	DP_FREE_CACHE( gpfUDSolution, FLOAT );
-	DP_FREE_CACHE( gpfUDOtherSolution, FLOAT );
-	DP_FREE_CACHE( gpfUDHKSolution, FLOAT );
+	DP_FREE_CACHE( pDP->pfUDSolution, FLOAT );
+	DP_FREE_CACHE( pDP->pfUDOtherSolution, FLOAT );
+	DP_FREE_CACHE( pDP->pfUDHKSolution, FLOAT );
 }
 
 /* ud_dispatch make the linearity assumption that if we don't find an exact solution we can
    interpolate between ajacent solution IFF ajacent solution have the same units running. */
-EXTERNC void ud_dispatch()
+EXTERNC void ud_dispatch( DPContext* pDP )
 {
 	UINT32 uUsableStates = 0;
 	UINT32 uLowerState = 0;
@@ -3205,7 +5392,7 @@ EXTERNC void ud_dispatch()
 	FLOAT fInterpCoef = 1.0;
 	FLOAT fTol = 1E-6;
 
-	VERIFY( guStages > 0 );
+	VERIFY( pDP->uStages > 0 );
 	if( ex_didFail() )
 	{
 		sprintf( gcPrintBuff, "unit dispatch: no stages defined.\n" );
@@ -3213,23 +5400,23 @@ EXTERNC void ud_dispatch()
 		return;
 	}
 
-	assert( gpfUDSolution );
-	assert( gpfUDOtherSolution );
-	assert( gpfUDHKSolution );
+	assert( pDP->pfUDSolution );
+	assert( pDP->pfUDOtherSolution );
+	assert( pDP->pfUDHKSolution );
 
 	/* clear */
 	{
 		UINT32 u;
-		for( u = 0; u < guStages; u++ )
-		{ gpfUDSolution[u] = gpfUDOtherSolution[u] = gpfUDHKSolution[u] = 0; }
+		for( u = 0; u < pDP->uStages; u++ )
+		{ pDP->pfUDSolution[u] = pDP->pfUDOtherSolution[u] = pDP->pfUDHKSolution[u] = 0; }
 	}
 
-	if( gfDispatch < fTol )
+	if( pDP->fDispatch < fTol )
 	{
 		return;
 	}
 
-	VERIFY( gfDispatch > 0 );
+	VERIFY( pDP->fDispatch > 0 );
 	if( ex_didFail() )
 	{
 		sprintf( gcPrintBuff, "unit dispatch: unable to dispatch negative quantity.\n" );
@@ -3240,8 +5427,8 @@ EXTERNC void ud_dispatch()
 	/* accomodate problematic table construction... */
 	{
 		/* determine table size as it may be smaller than expected... */
-		uUsableStates = guStates;
-		while( uUsableStates != MAX_UINT32 && gpfSolutionAllocations[ uUsableStates ] < 1.0 ) { uUsableStates--; }
+		uUsableStates = pDP->uStates - 1;
+		while( uUsableStates != MAX_UINT32 && pDP->pfSolutionAllocations[ uUsableStates ] < 1.0 ) { uUsableStates--; }
 		VERIFY( uUsableStates != MAX_UINT32 );
 		if( ex_didFail() )
 		{
@@ -3258,8 +5445,8 @@ EXTERNC void ud_dispatch()
 			while( 1 )
 			{
 				u = ( uSearchA + uSearchB ) / 2;
-				if( gfDispatch < gpfSolutionAllocations[ u ] ) { uSearchB = u - 1; }
-				else if( gfDispatch > gpfSolutionAllocations[ u ] ) { uSearchA = u + 1; }
+				if( pDP->fDispatch < pDP->pfSolutionAllocations[ u ] ) { uSearchB = u - 1; }
+				else if( pDP->fDispatch > pDP->pfSolutionAllocations[ u ] ) { uSearchA = u + 1; }
 				else { break; } /* found it exactly */
 				if( uSearchA >= uSearchB ) { u = uSearchB; break; }
 			}
@@ -3268,16 +5455,16 @@ EXTERNC void ud_dispatch()
 
 		/* apply off-by-one correction to the search */
 		{
-			if( gfDispatch < gpfSolutionAllocations[ uLowerState ] && uLowerState > 0 ) uLowerState--;
-			else if( gfDispatch > gpfSolutionAllocations[ uLowerState + 1 ] && uLowerState+1 < guStates-1 ) uLowerState++;
+			if( pDP->fDispatch < pDP->pfSolutionAllocations[ uLowerState ] && uLowerState > 0 ) uLowerState--;
+			else if( pDP->fDispatch > pDP->pfSolutionAllocations[ uLowerState + 1 ] && uLowerState+1 < pDP->uStates-1 ) uLowerState++;
 
 			uHigherState = uLowerState + 1;
 		}
 	}
-	assert( uLowerState < guStates );
+	assert( uLowerState < pDP->uStates );
 
 	/* are we not close enough? */
-	if( fabs( gfDispatch - gpfSolutionAllocations[ uLowerState ] ) > fTol )
+	if( fabs( pDP->fDispatch - pDP->pfSolutionAllocations[ uLowerState ] ) > fTol )
 	{
 		UINT32 bLinearityAssuptionValid = 0;
 
@@ -3295,26 +5482,26 @@ EXTERNC void ud_dispatch()
 			/* if units neither start or stop across the discretization then we can make linearity assumption */
 			UINT32 uNumSameStages = 0;
 			UINT32 u;
-			for( u = 0; u < guStages; u++ )
+			for( u = 0; u < pDP->uStages; u++ )
 			{
-				UINT32 uLower = u * guStates + uLowerState; // column major
-				UINT32 uHigher = u * guStates + uHigherState; // column major
-				int bBothNonZero = ( gpfSolution[ uLower ] > fTol && gpfSolution[ uHigher ] > fTol ) ? 1 : 0;
-				int bBothZero = ( gpfSolution[ uLower ] < fTol && gpfSolution[ uHigher ] < fTol ) ? 1 : 0;
+				UINT32 uLower = u * pDP->uStates + uLowerState; // column major
+				UINT32 uHigher = u * pDP->uStates + uHigherState; // column major
+				int bBothNonZero = ( pDP->pfSolution[ uLower ] > fTol && pDP->pfSolution[ uHigher ] > fTol ) ? 1 : 0;
+				int bBothZero = ( pDP->pfSolution[ uLower ] < fTol && pDP->pfSolution[ uHigher ] < fTol ) ? 1 : 0;
 				uNumSameStages += ( bBothNonZero || bBothZero ) ? 1 : 0;
 			}
-			bLinearityAssuptionValid = ( uNumSameStages == guStages );
+			bLinearityAssuptionValid = ( uNumSameStages == pDP->uStages );
 		}
 
 		if( bLinearityAssuptionValid )
 		{
 			/* calc coef */
-			fInterpCoef = gfDispatch / gpfSolutionAllocations[ uLowerState ];
+			fInterpCoef = pDP->fDispatch / pDP->pfSolutionAllocations[ uLowerState ];
 		}
 		else
 		{
-			FLOAT fLowerDiff = gfDispatch - gpfSolutionAllocations[ uLowerState ];
-			FLOAT fHigherDiff = gpfSolutionAllocations[ uHigherState ] - gfDispatch;
+			FLOAT fLowerDiff = pDP->fDispatch - pDP->pfSolutionAllocations[ uLowerState ];
+			FLOAT fHigherDiff = pDP->pfSolutionAllocations[ uHigherState ] - pDP->fDispatch;
 
 			/* check neighbours */
 			VERIFY( fLowerDiff > 0 && fHigherDiff > 0 );
@@ -3324,38 +5511,38 @@ EXTERNC void ud_dispatch()
 			uLowerState = ( fLowerDiff < fHigherDiff ) ? uLowerState : uHigherState;
 		}
 	}
-	assert( uLowerState < guStates );
+	assert( uLowerState < pDP->uStates );
 
 	{
 		UINT32 u;
-		for( u = 0; u < guStages; u++ )
+		for( u = 0; u < pDP->uStages; u++ )
 		{
-			gpfUDSolution[ u ] = fInterpCoef * gpfSolution[ u * guStates + uLowerState ];
-			gpfUDOtherSolution[ u ] = fInterpCoef * gpfOtherSolution[ u * guStates + uLowerState ];
+			pDP->pfUDSolution[ u ] = fInterpCoef * pDP->pfSolution[ u * pDP->uStates + uLowerState ];
+			pDP->pfUDOtherSolution[ u ] = fInterpCoef * pDP->pfOtherSolution[ u * pDP->uStates + uLowerState ];
 		}
 	}
 
 	{
-		FLOAT* pPower = ( guSolveMode == DP_OPTIMIZE_FOR_POWER ) ? gpfUDSolution : gpfUDOtherSolution;
-		FLOAT* pFlow = ( guSolveMode == DP_OPTIMIZE_FOR_POWER ) ? gpfUDOtherSolution : gpfUDSolution;
+		FLOAT* pPower = ( pDP->uSolveMode == DP_OPTIMIZE_FOR_POWER ) ? pDP->pfUDSolution : pDP->pfUDOtherSolution;
+		FLOAT* pFlow = ( pDP->uSolveMode == DP_OPTIMIZE_FOR_POWER ) ? pDP->pfUDOtherSolution : pDP->pfUDSolution;
 
-		arr_float_div2( gpfUDHKSolution, pPower, pFlow, guStages );
+		arr_float_div2( pDP->pfUDHKSolution, pPower, pFlow, pDP->uStages );
 
 #ifdef ENABLE_OUTOFLINE_NUMERICAL_CLEANUP
-		arr_float_mark_nan_as_zero( gpfUDHKSolution, guStages );
-		arr_float_mark_inf_as_zero( gpfUDHKSolution, guStages );
+		arr_float_mark_nan_as_zero( pDP->pfUDHKSolution, pDP->uStages );
+		arr_float_mark_inf_as_zero( pDP->pfUDHKSolution, pDP->uStages );
 #endif
 	}
 }
 
-void ud_print()
+void ud_print( DPContext* pDP )
 {
-	CHAR* szDecisionVariable = ( guSolveMode == DP_OPTIMIZE_FOR_POWER ) ? "Power" : "Flow";
-	CHAR* szOtherDecisionVariable = ( guSolveMode == DP_OPTIMIZE_FOR_POWER ) ? "Flow" : "Power";
+	CHAR* szDecisionVariable = ( pDP->uSolveMode == DP_OPTIMIZE_FOR_POWER ) ? "Power" : "Flow";
+	CHAR* szOtherDecisionVariable = ( pDP->uSolveMode == DP_OPTIMIZE_FOR_POWER ) ? "Flow" : "Power";
 
 	ex_clear();
 
-	VERIFY( guStages > 0 );
+	VERIFY( pDP->uStages > 0 );
 	if( ex_didFail() )
 	{
 		sprintf( gcPrintBuff, "unit dispatch: no stages defined.\n" );
@@ -3363,34 +5550,34 @@ void ud_print()
 		return;
 	}
 
-	assert( gpfUDSolution );
-	assert( gpfUDOtherSolution );
-	assert( gpfUDHKSolution );
+	assert( pDP->pfUDSolution );
+	assert( pDP->pfUDOtherSolution );
+	assert( pDP->pfUDHKSolution );
 
 	if( guTransposeSolution == 0 ) {
 		sprintf( gcPrintBuff, "%8s:%c", szDecisionVariable, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
-		arr_float_print( stdout, gpfUDSolution, guStages, gcOutputDelimiter );
+		arr_float_print( stdout, pDP->pfUDSolution, pDP->uStages, gcOutputDelimiter );
 		sprintf( gcPrintBuff, "%8s:%c", szOtherDecisionVariable, gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
-		arr_float_print( stdout, gpfUDOtherSolution, guStages, gcOutputDelimiter );
+		arr_float_print( stdout, pDP->pfUDOtherSolution, pDP->uStages, gcOutputDelimiter );
 		sprintf( gcPrintBuff, "%8s:%c", "H/K", gcOutputDelimiter ); PRINT_STDOUT( gcPrintBuff );
-		arr_float_print( stdout, gpfUDHKSolution, guStages, gcOutputDelimiter );
-		if( guDebugMode )
+		arr_float_print( stdout, pDP->pfUDHKSolution, pDP->uStages, gcOutputDelimiter );
+		if( pDP->uDebugMode )
 		{
 		}
 		putc( '\n', stdout );
 	} else {
 		FLOAT fSum1, fSum2;
-		arr_float_sum( &fSum1, gpfUDSolution, guStages, 1 );
+		arr_float_sum( &fSum1, pDP->pfUDSolution, pDP->uStages, 1 );
 		float_print( stdout, fSum1, gcOutputDelimiter );
-		arr_float_print_t2( stdout, gpfUDSolution, guStages, 1, gcOutputDelimiter, 0 );
+		arr_float_print_t2( stdout, pDP->pfUDSolution, pDP->uStages, 1, gcOutputDelimiter, 0 );
 		/**/
-		arr_float_sum( &fSum2, gpfUDOtherSolution, guStages, 1 );
+		arr_float_sum( &fSum2, pDP->pfUDOtherSolution, pDP->uStages, 1 );
 		float_print( stdout, fSum2, gcOutputDelimiter );
-		arr_float_print_t2( stdout, gpfUDOtherSolution, guStages, 1, gcOutputDelimiter, 0 );
+		arr_float_print_t2( stdout, pDP->pfUDOtherSolution, pDP->uStages, 1, gcOutputDelimiter, 0 );
 		/**/
-		float_print( stdout, ( guSolveMode == DP_OPTIMIZE_FOR_POWER ) ? fSum1 / fSum2 : fSum2 / fSum1, gcOutputDelimiter );
-		arr_float_print_t2( stdout, gpfUDHKSolution, guStages, 1, gcOutputDelimiter, 0 );
-		if( guDebugMode )
+		float_print( stdout, ( pDP->uSolveMode == DP_OPTIMIZE_FOR_POWER ) ? fSum1 / fSum2 : fSum2 / fSum1, gcOutputDelimiter );
+		arr_float_print_t2( stdout, pDP->pfUDHKSolution, pDP->uStages, 1, gcOutputDelimiter, 0 );
+		if( pDP->uDebugMode )
 		{
 		}
 		putc( '\n', stdout );
@@ -3399,30 +5586,116 @@ void ud_print()
 
 /**********************************************/
 
-void ui_parse_units( CHAR* szUnit )
+#define DP_RESULT_SOLUTIONALLOCATIONS		(0) /* [ states ] */
+#define DP_RESULT_OTHERSOLUTIONALLOCATIONS	(1) /* [ states ] */
+#define DP_RESULT_HKSOLUTIONAVERAGES		(2) /* [ states ] */
+#define DP_RESULT_SOLUTION					(3) /* [ stages, states ] */
+#define DP_RESULT_OTHERSOLUTION				(4) /* [ stages, states ] */
+#define DP_RESULT_HKSOLUTION				(5) /* [ stages, states ] */
+#define DP_RESULT_UDSOLUTION				(6) /* [ stages ] */
+#define DP_RESULT_UDOTHERSOLUTION			(7) /* [ stages ] */
+#define DP_RESULT_UDHKSOLUTION				(8) /* [ stages ] */
+#define DP_RESULT_OPCOEFM					(9) /* [ opoints ] */
+#define DP_RESULT_OPCOEFB					(10) /* [ opoints ] */
+#define DP_RESULT_OUTAGEHK					(11) /* [ stages, states ] */
+#define DP_RESULT_OUTAGESOLUTION			(12) /* [ stages, stages, states ] */
+
+EXTERNC DPContext* dp_context_alloc()
+{
+	DPContext* pDP = (DPContext*)calloc( 1, sizeof(DPContext) );
+	if( !pDP )
+	{
+		sprintf( gcPrintBuff, "%s:%d (" VERSIONED_NAME  ") malloc failure.\n", __FILE__, __LINE__ );
+		PRINT_STDERR( gcPrintBuff );
+		return 0;
+	}
+
+	pDP->uUnitMode = DP_UNITS_UNDEFINED;
+	pDP->fConvFactor = DP_CONV_UNDEFINED;
+	pDP->fCoordinationFactorA = 0.95;
+	pDP->fCoordinationFactorB = 0.6;
+	pDP->uWeightCode = DP_WEIGHT_DEFAULT;
+	pDP->fHeadCurr = 1.0;
+	pDP->uSimd = dp_simd_detect();
+	pDP->uForwardpass = DP_FORWARDPASS_WALK;
+	pDP->uMemCacheOn = 1;
+	pDP->fCellNs = 1.0; /* until a solve has been timed */
+	return pDP;
+}
+
+EXTERNC void dp_context_free( DPContext* pDP )
+{
+	if( !pDP ) { return; }
+
+	dp_pool_destroy( pDP );
+	pDP->uMemCacheOn = 0; /* so the cached workspaces are really freed */
+	ud_cleanup( pDP );
+	op_cleanup( pDP );
+	dp_cleanup( pDP );
+	turbine_cleanup( pDP );
+	curve_cleanup( pDP );
+	if( pDP->pHKEntries ) { free( pDP->pHKEntries ); }
+	if( pDP->pu16RefineMap ) { free( pDP->pu16RefineMap ); }
+	free( pDP );
+}
+
+EXTERNC void dp_set_solvemode( DPContext* pDP, UINT32 uSolveMode ) { pDP->uSolveMode = uSolveMode; }
+EXTERNC void dp_set_head( DPContext* pDP, FLOAT fHead ) { pDP->fHeadCurr = fHead; }
+EXTERNC void dp_set_unitsteps( DPContext* pDP, UINT32 uSteps ) { pDP->uUserStepCount = uSteps; }
+EXTERNC void dp_set_convfactor( DPContext* pDP, FLOAT fConvFactor ) { pDP->fConvFactor = fConvFactor; }
+EXTERNC UINT32 dp_get_states( DPContext* pDP ) { return pDP->uStates; }
+EXTERNC UINT32 dp_get_first_state( DPContext* pDP ) { return pDP->uStateLo; }
+EXTERNC UINT32 dp_get_stages( DPContext* pDP ) { return pDP->uStages; }
+EXTERNC void ud_set_dispatch( DPContext* pDP, FLOAT fDispatch ) { pDP->fDispatch = fDispatch; }
+EXTERNC UINT32 op_get_points( DPContext* pDP ) { return pDP->uOPoints; }
+
+EXTERNC FLOAT* dp_get_result( DPContext* pDP, UINT32 uResult )
+{
+	switch( uResult )
+	{
+	case DP_RESULT_SOLUTIONALLOCATIONS: return pDP->pfSolutionAllocations;
+	case DP_RESULT_OTHERSOLUTIONALLOCATIONS: return pDP->pfOtherSolutionAllocations;
+	case DP_RESULT_HKSOLUTIONAVERAGES: return pDP->pfHKSolutionAverages;
+	case DP_RESULT_SOLUTION: return pDP->pfSolution;
+	case DP_RESULT_OTHERSOLUTION: return pDP->pfOtherSolution;
+	case DP_RESULT_HKSOLUTION: return pDP->pfHKSolution;
+	case DP_RESULT_UDSOLUTION: return pDP->pfUDSolution;
+	case DP_RESULT_UDOTHERSOLUTION: return pDP->pfUDOtherSolution;
+	case DP_RESULT_UDHKSOLUTION: return pDP->pfUDHKSolution;
+	case DP_RESULT_OPCOEFM: return pDP->pfOPCoefM;
+	case DP_RESULT_OPCOEFB: return pDP->pfOPCoefB;
+	case DP_RESULT_OUTAGEHK: return pDP->uOutageScan ? pDP->pfOutageHK : 0;
+	case DP_RESULT_OUTAGESOLUTION: return pDP->uOutageScan ? pDP->pfOutageSolution : 0;
+	}
+	return 0;
+}
+
+/**********************************************/
+
+void ui_parse_units( DPContext* pDP, CHAR* szUnit )
 {
 	CHAR** pszUnit = 0;
 	UINT32 uUnitMode = DP_UNITS_UNDEFINED;
 
 	// reset measurement units
-	if( !szUnit ) { guUnitMode = gfConvFactor = 0; return; }
+	if( !szUnit ) { pDP->uUnitMode = pDP->fConvFactor = 0; return; }
 
 	for( pszUnit = (CHAR**)&gsUniversalUnits; *pszUnit; pszUnit++ )
-	{ if( strcasecmp( *pszUnit, szUnit ) == 0 ) { guMWMode = (pszUnit == &(gsUniversalUnits[1])) ? 1 : 0; return; } }
+	{ if( strcasecmp( *pszUnit, szUnit ) == 0 ) { pDP->uMWMode = (pszUnit == &(gsUniversalUnits[1])) ? 1 : 0; return; } }
 
 	for( pszUnit = (CHAR**)&gsImperialUnits; *pszUnit; pszUnit++ )
-	{ if( strcasecmp( *pszUnit, szUnit ) == 0 ) { uUnitMode = DP_UNITS_IMPERIAL; gfConvFactor = DP_CONV_IMPERIAL; break; } }
+	{ if( strcasecmp( *pszUnit, szUnit ) == 0 ) { uUnitMode = DP_UNITS_IMPERIAL; pDP->fConvFactor = DP_CONV_IMPERIAL; break; } }
 
 	for( pszUnit = (CHAR**)&gsMetricUnits; *pszUnit; pszUnit++ )
-	{ if( strcasecmp( *pszUnit, szUnit ) == 0 ) { uUnitMode = DP_UNITS_METRIC; gfConvFactor = DP_CONV_METRIC; break; } }
+	{ if( strcasecmp( *pszUnit, szUnit ) == 0 ) { uUnitMode = DP_UNITS_METRIC; pDP->fConvFactor = DP_CONV_METRIC; break; } }
 
-	if( guUnitMode == DP_UNITS_UNDEFINED ) { guUnitMode = uUnitMode; return; }
+	if( pDP->uUnitMode == DP_UNITS_UNDEFINED ) { pDP->uUnitMode = uUnitMode; return; }
 
-	if( guUnitMode != uUnitMode )
+	if( pDP->uUnitMode != uUnitMode )
 	{
 		sprintf( gcPrintBuff, "%s:%d (" VERSIONED_NAME  ") Can't mix and match unit modes.\n", __FILE__, __LINE__ );
 		PRINT_STDERR( gcPrintBuff );
-		dp_cleanup_fatal();
+		dp_cleanup_fatal( pDP );
 	}
 }
 
@@ -3513,16 +5786,37 @@ CHAR* gszCommandHelp = "\
 > unit <unitname> <curvename> <design head> ft <design flow> cfs <design kw> kw capacity <float> [ weight <float> ] [ headloss <float> ] [ geneff <float> ]\n\
 # Specify current head for optimization\n\
 > head <current head> ft\n\
+# Solve only the plant loads from min to max, in the units of the solvemode. 0 leaves that end open.\n\
+> min <float> ( kw | cfs ) \n\
+> max <float> ( kw | cfs ) \n\
 # Specify discretization of efficiency curve for optimization\n\
 > unitsteps <integer>\n\
 # Optimize for either power or flow\n\
 > solve ( Power | Flow )\n\
-# Print configuration or final solution\n\
-> print ( Solution | Config | Units | Curves | Weights | Weighting ) \n\
+# Solve at 1/factor of unitsteps first, then at full unitsteps trying only the unit decisions near the coarse ones\n\
+> solve ( Power | Flow ) refine <integer factor>\n\
+# Solve again for the last solvemode and print the plant H/K table and solution with each unit out of service in turn. The outages come from merging the unit H/K tables whatever the engine, so they can differ from solving again with the unit at weight 0\n\
+> outage scan\n\
+# Skip the backpass decisions below a unit's near-optimum once the flow is above its maximum, or solve the last solvemode both ways and compare\n\
+> prune ( 0 | 1 | Compare )\n\
+# Print configuration or final solution, or count the unit conditions met building the last H/K table\n\
+> print ( Solution | Config | Units | Curves | Weights | Weighting | Conditions ) \n\
 # Transpose solution printout\n\
 > transpose ( 0 | 1 ) \n\
 # Change solution printout delimiter (use , to make *.csv import easier. Use with no arg to revert to blank.)\n\
 > delimiter <anychar> \n\
+# Number of threads used to solve (0 or 1 solves on the calling thread only)\n\
+> threads <integer> \n\
+# Backpass kernels: 0 scalar reference, 1 SSE2, 2 AVX2 (capped at what the cpu supports)\n\
+> simd ( 0 | 1 | 2 ) \n\
+# Forwardpass reconstruction: walk the backpass decisions (default), or the greedy rescan of the stages it reproduces\n\
+> forwardpass ( Greedy | Walk ) \n\
+# Solver: the prioritized-stage backpass, merge each unit type into one table and merge the types,\n\
+# or merge the stages pairwise in a balanced tree so each level of merges runs in parallel.\n\
+# The merge engines report how many merges of two concave unit tables took the bisection shortcut, an experiment the backpass does not use\n\
+> engine ( Backpass | Grouped | Tree ) \n\
+# Coarsen unitsteps until the predicted workspace (MB) or solve time (ms) fits. 0 removes the limit.\n\
+> budget ( Memory <integer> | Time <integer> ) \n\
 # specify a set of operating points to determine the H/K of \n\
 > op caps <n floats [0...1] in any order> \n\
 # set the dependent variable from which a regression for the operating points will be determined \n\
@@ -3539,7 +5833,7 @@ CHAR* gpSymbolList[ 20 ]; /* somewhat arbitrary sized array */
 UINT32 guTestCondition = 0;
 
 /* szProblem must be writable memory */
-void parse_program( CHAR* szProblem )
+void parse_program( DPContext* pDP, CHAR* szProblem )
 {
 	/* preparse problem file */
 	CHAR* p;
@@ -3590,7 +5884,7 @@ void parse_program( CHAR* szProblem )
 				arr_float_copy( pPow, fPowVector, u );
 				arr_float_copy( pEff, fEffVector, u );
 				strcpy( pCurveName, szCurveName );
-				curve_register( pCurveName, u, pCap, pPow, pEff );
+				curve_register( pDP, pCurveName, u, pCap, pPow, pEff );
 				pFloat = 0;
 			}
 		}
@@ -3608,7 +5902,7 @@ void parse_program( CHAR* szProblem )
 					if( isalpha( *tok ) ) { break; }
 					if( u < 100 ) { fCapVector[ u++ ] = (FLOAT)atof( tok ); } /* bounds check */
 				}
-				op_set_operating_capacities( u, fCapVector );
+				op_set_operating_capacities( pDP, u, fCapVector );
 			}
 			else if( strcasecmp( tok, "dep" ) == 0 )
 			{
@@ -3616,19 +5910,19 @@ void parse_program( CHAR* szProblem )
 				FLOAT fDep = 0;
 				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; }
 				fDep = (FLOAT)atof( tok );
-				op_set_dependent( fDep );
+				op_set_dependent( pDP, fDep );
 				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; }
-				ui_parse_units( tok );
+				ui_parse_units( pDP, tok );
 				tok = strtok( 0, " " ); /* grab next word */
 			}
 			else if( strcasecmp( tok, "regress" ) == 0 )
 			{
-				op_regress();
+				op_regress( pDP );
 				tok = strtok( 0, " " ); /* grab next word */
 			}
 			else if( strcasecmp( tok, "print" ) == 0 )
 			{
-				op_print();
+				op_print( pDP );
 				tok = strtok( 0, " " ); /* grab next word */
 			}
 			else { goto parseerror; }
@@ -3641,14 +5935,14 @@ void parse_program( CHAR* szProblem )
 			{
 				/* for <value> */
 				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; }
-				gfDispatch = (FLOAT)atof( tok );
-				ud_cleanup();
-				ud_malloc();
-				ud_dispatch();
+				pDP->fDispatch = (FLOAT)atof( tok );
+				ud_cleanup( pDP );
+				ud_malloc( pDP );
+				ud_dispatch( pDP );
 			}
 			else if( strcasecmp( tok, "print" ) == 0 )
 			{
-				ud_print();
+				ud_print( pDP );
 				tok = strtok( 0, " " ); /* grab next word */
 			}
 			else { goto parseerror; }
@@ -3664,17 +5958,17 @@ void parse_program( CHAR* szProblem )
 				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } szUnitName = tok;
 				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } szCurveName = tok;
 				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } ft = (FLOAT)atof( tok );
-				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } ui_parse_units( tok );
+				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } ui_parse_units( pDP, tok );
 				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } cfs = (FLOAT)atof( tok );
-				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } ui_parse_units( tok );
+				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } ui_parse_units( pDP, tok );
 				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } kw = (FLOAT)atof( tok );
-				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } ui_parse_units( tok );
+				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } ui_parse_units( pDP, tok );
 				pUnitName = 0;
 				DP_MALLOC( pUnitName, CHAR, strlen( szUnitName ) + 1, __FILE__, __LINE__ ); parse_addblock( pUnitName );
 				strcpy( pUnitName, szUnitName );
-				turbine_register( pUnitName, szCurveName, ft, cfs, kw );
+				turbine_register( pDP, pUnitName, szCurveName, ft, cfs, kw );
 				{
-					UINT32 uUnitNumber = turbine_find_err( szUnitName );
+					UINT32 uUnitNumber = turbine_find_err( pDP, szUnitName );
 					if( uUnitNumber == MAX_UINT32 ) { goto parseerror; }
 #if 1
 					while( 1 )
@@ -3695,16 +5989,16 @@ void parse_program( CHAR* szProblem )
 						fValue = (FLOAT)atof( tok );
 						tokValue = tok;
 
-						if( tokKeyword && strcasecmp( tokKeyword, "capacity" ) == 0 ) { turbine_gencap( uUnitNumber, fValue ); tokRestore = 0; }
-						else if( tokKeyword && strcasecmp( tokKeyword, "weight" ) == 0 ) { turbine_weight( uUnitNumber, fValue ); tokRestore = 0; }
-						else if( tokKeyword && strcasecmp( tokKeyword, "headloss" ) == 0 ) { turbine_headloss( uUnitNumber, fValue ); tokRestore = 0; }
-						else if( tokKeyword && strcasecmp( tokKeyword, "geneff" ) == 0 ) { turbine_geneff( uUnitNumber, fValue ); tokRestore = 0; }
+						if( tokKeyword && strcasecmp( tokKeyword, "capacity" ) == 0 ) { turbine_gencap( pDP, uUnitNumber, fValue ); tokRestore = 0; }
+						else if( tokKeyword && strcasecmp( tokKeyword, "weight" ) == 0 ) { turbine_weight( pDP, uUnitNumber, fValue ); tokRestore = 0; }
+						else if( tokKeyword && strcasecmp( tokKeyword, "headloss" ) == 0 ) { turbine_headloss( pDP, uUnitNumber, fValue ); tokRestore = 0; }
+						else if( tokKeyword && strcasecmp( tokKeyword, "geneff" ) == 0 ) { turbine_geneff( pDP, uUnitNumber, fValue ); tokRestore = 0; }
 						else if( tokKeyword && strcasecmp( tokKeyword, "gencurve" ) == 0 )
 						{
 							szGenCurveName = 0;
 							DP_MALLOC( szGenCurveName, CHAR, strlen( tokValue ) + 1, __FILE__, __LINE__ ); parse_addblock( szGenCurveName );
 							strcpy( szGenCurveName, tokValue );
-							turbine_gencurvename( uUnitNumber, szGenCurveName );
+							turbine_gencurvename( pDP, uUnitNumber, szGenCurveName );
 							tokRestore = 0;
 						}
 
@@ -3721,7 +6015,7 @@ void parse_program( CHAR* szProblem )
 							/* capacity 1.2 */
 							FLOAT capacity;
 							tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } capacity = (FLOAT)atof( tok );
-							turbine_gencap( uUnitNumber, capacity );
+							turbine_gencap( pDP, uUnitNumber, capacity );
 							tokRestore = 0;
 						}
 						/* unwind if parse error */
@@ -3736,7 +6030,7 @@ void parse_program( CHAR* szProblem )
 							/* weight 0.9 */
 							FLOAT weight;
 							tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } weight = (FLOAT)atof( tok );
-							turbine_weight( uUnitNumber, weight );
+							turbine_weight( pDP, uUnitNumber, weight );
 							tokRestore = 0;
 						}
 						/* unwind if parse error */
@@ -3751,7 +6045,7 @@ void parse_program( CHAR* szProblem )
 							/* headloss 2.5 */
 							FLOAT loss;
 							tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } loss = (FLOAT)atof( tok );
-							turbine_headloss( uUnitNumber, loss );
+							turbine_headloss( pDP, uUnitNumber, loss );
 							tokRestore = 0;
 						}
 						/* unwind if parse error */
@@ -3766,7 +6060,7 @@ void parse_program( CHAR* szProblem )
 							/* geneff 0.97 */
 							FLOAT loss;
 							tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } loss = (FLOAT)atof( tok );
-							turbine_geneff( uUnitNumber, loss );
+							turbine_geneff( pDP, uUnitNumber, loss );
 							tokRestore = 0;
 						}
 						/* unwind if parse error */
@@ -3782,79 +6076,138 @@ void parse_program( CHAR* szProblem )
 				FLOAT weight;
 				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } szUnitName = tok;
 				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } weight = (FLOAT)atof( tok );
-				turbine_weight( turbine_find( szUnitName ), weight );
+				turbine_weight( pDP, turbine_find( pDP, szUnitName ), weight );
 			}
 			else if( strcasecmp( tok, "weighting" ) == 0 )
 			{
 				/* weights [ equal ... ] */
-				guWeightCode = DP_WEIGHT_DEFAULT;
+				pDP->uWeightCode = DP_WEIGHT_DEFAULT;
 				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; }
 				if( strcasecmp( tok, "relative" ) == 0 )
 				{
-					guWeightCode |= DP_WEIGHT_RELATIVE;
+					pDP->uWeightCode |= DP_WEIGHT_RELATIVE;
 					tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; }
 				}
-				if( strcasecmp( tok, "equal" ) == 0 )			{ guWeightCode |= DP_WEIGHT_EQUAL; }
-				else if( strcasecmp( tok, "maxpower" ) == 0 )	{ guWeightCode |= DP_WEIGHT_MAXPOWER; }
-				else if( strcasecmp( tok, "maxflow" ) == 0 )	{ guWeightCode |= DP_WEIGHT_MAXFLOW; }
-				else if( strcasecmp( tok, "minpower" ) == 0 )	{ guWeightCode |= DP_WEIGHT_MINPOWER; }
-				else if( strcasecmp( tok, "minflow" ) == 0 )	{ guWeightCode |= DP_WEIGHT_MINFLOW; }
+				if( strcasecmp( tok, "equal" ) == 0 )			{ pDP->uWeightCode |= DP_WEIGHT_EQUAL; }
+				else if( strcasecmp( tok, "maxpower" ) == 0 )	{ pDP->uWeightCode |= DP_WEIGHT_MAXPOWER; }
+				else if( strcasecmp( tok, "maxflow" ) == 0 )	{ pDP->uWeightCode |= DP_WEIGHT_MAXFLOW; }
+				else if( strcasecmp( tok, "minpower" ) == 0 )	{ pDP->uWeightCode |= DP_WEIGHT_MINPOWER; }
+				else if( strcasecmp( tok, "minflow" ) == 0 )	{ pDP->uWeightCode |= DP_WEIGHT_MINFLOW; }
 				else { goto parseerror; }
 				/* group weights assigned during dp initalization */
 			}
 			else if( strcasecmp( tok, "head" ) == 0 ) {
-				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } gfHeadCurr = (FLOAT)atof( tok );
-				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } ui_parse_units( tok );
+				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } pDP->fHeadCurr = (FLOAT)atof( tok );
+				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } ui_parse_units( pDP, tok );
 			}
 			else if( strcasecmp( tok, "min" ) == 0 ) {
-				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } gfStateMin = (FLOAT)atof( tok );
-				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } ui_parse_units( tok );
+				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } pDP->fStateMin = (FLOAT)atof( tok );
+				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } ui_parse_units( pDP, tok );
 			}
 			else if( strcasecmp( tok, "max" ) == 0 ) {
-				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } gfStateMax = (FLOAT)atof( tok );
-				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } ui_parse_units( tok );
+				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } pDP->fStateMax = (FLOAT)atof( tok );
+				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } ui_parse_units( pDP, tok );
 			}
 
 			/***************************/
 			/* global coefs */
 
 			else if( strcasecmp( tok, "losscoef" ) == 0 )
-			{ tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } gfPlantLossCoef = (FLOAT)atof( tok ); }
+			{ tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } pDP->fPlantLossCoef = (FLOAT)atof( tok ); }
 			else if( strcasecmp( tok, "coordinationfactora" ) == 0 )
-			{ tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } gfCoordinationFactorA = (FLOAT)atof( tok ); }
+			{ tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } pDP->fCoordinationFactorA = (FLOAT)atof( tok ); }
 			else if( strcasecmp( tok, "coordinationfactorb" ) == 0 )
-			{ tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } gfCoordinationFactorB = (FLOAT)atof( tok ); }
+			{ tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } pDP->fCoordinationFactorB = (FLOAT)atof( tok ); }
 
 			/***************************/
 			/* solve and print */
 
 			else if( strcasecmp( tok, "solve" ) == 0 ) {
-				/* solve power | flow */
-				UINT32 uSolve = 0;
+				/* solve power | flow [ refine <factor> ] */
+				UINT32 uSolve = 0, uRefine = 0;
+				CHAR* tokRestore;
 				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; }
-				if( strcasecmp( tok, "power" ) == 0 )		{ guSolveMode = DP_OPTIMIZE_FOR_POWER; uSolve = 1; }
-				else if( strcasecmp( tok, "flow" ) == 0 )	{ guSolveMode = DP_OPTIMIZE_FOR_FLOW; uSolve = 1; }
+				if( strcasecmp( tok, "power" ) == 0 )		{ pDP->uSolveMode = DP_OPTIMIZE_FOR_POWER; uSolve = 1; }
+				else if( strcasecmp( tok, "flow" ) == 0 )	{ pDP->uSolveMode = DP_OPTIMIZE_FOR_FLOW; uSolve = 1; }
 				else { goto parseerror; }
+				/* optional refine */
+				tokRestore = tok;
+				tok = strtok( 0, " " );
+				if( tok && strcasecmp( tok, "refine" ) == 0 )
+				{
+					tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } uRefine = (UINT32)atoi( tok );
+				}
+				else if( tok ) { tok = strtok( strtokRestore( tok, tokRestore, ' ' ), " " ); }
 				if( uSolve )
 				{
-					dp_cleanup();
-					dp_assign_weights();
-					dp_resize();
-					PRINT_STDOUT( "DP starting...\n" );
-					dp_malloc();
-					dp();
+					dp_set_refine( pDP, uRefine );
+					do /* twice when the coarse pass left decisions to refine */
+					{
+						dp_cleanup( pDP );
+						dp_assign_weights( pDP );
+						dp_resize( pDP );
+						PRINT_STDOUT( "DP starting...\n" );
+						dp_malloc( pDP );
+						dp( pDP );
+					} while( pDP->uRefineStates );
+					dp_set_refine( pDP, 0 );
+				}
+			}
+			else if( strcasecmp( tok, "outage" ) == 0 ) {
+				/* outage scan, for the last solvemode */
+				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; }
+				if( strcasecmp( tok, "scan" ) != 0 || !pDP->uSolveMode ) { goto parseerror; }
+				dp_set_outage_scan( pDP, 1 );
+				dp_cleanup( pDP );
+				dp_assign_weights( pDP );
+				dp_resize( pDP );
+				PRINT_STDOUT( "DP starting...\n" );
+				dp_malloc( pDP );
+				dp( pDP );
+				dp_print_outages( pDP );
+				dp_set_outage_scan( pDP, 0 );
+			}
+			else if( strcasecmp( tok, "prune" ) == 0 ) {
+				/* prune 0 | 1 | compare, compare solves the last solvemode both ways */
+				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; }
+				if( strcasecmp( tok, "compare" ) == 0 )
+				{
+					FLOAT* pfUnprunedHK = 0;
+					UINT32 uPass, uUnprunedStates = 0, uPrune = pDP->uPrune;
+					if( !pDP->uSolveMode ) { goto parseerror; }
+					for( uPass = 0; uPass < 2; uPass++ )
+					{
+						dp_set_prune( pDP, uPass );
+						dp_cleanup( pDP );
+						dp_assign_weights( pDP );
+						dp_resize( pDP );
+						PRINT_STDOUT( "DP starting...\n" );
+						dp_malloc( pDP );
+						dp( pDP );
+						if( uPass == 0 )
+						{
+							uUnprunedStates = pDP->uStates;
+							DP_MALLOC( pfUnprunedHK, FLOAT, uUnprunedStates, __FILE__, __LINE__ );
+							memcpy( pfUnprunedHK, pDP->pfHKSolutionAverages, sizeof(FLOAT) * uUnprunedStates );
+						}
+					}
+					dp_print_prune( pDP, pfUnprunedHK, uUnprunedStates );
+					DP_FREE( pfUnprunedHK );
+					dp_set_prune( pDP, uPrune );
 				}
+				else { dp_set_prune( pDP, (UINT32)atoi( tok ) ); }
 			}
 			else if( strcasecmp( tok, "print" ) == 0 )
 			{
 				tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; }
-				if( strcasecmp( tok, "units" ) == 0 )			{ turbine_list(); }
-				else if( strcasecmp( tok, "weights" ) == 0 )	{ dp_assign_weights(); dp_print_weights(); }
-				else if( strcasecmp( tok, "allcurves" ) == 0 )	{ curve_list( 0 ); }
-				else if( strcasecmp( tok, "curves" ) == 0 )		{ curve_list( 1 ); }
-				else if( strcasecmp( tok, "config" ) == 0 )		{ dp_print_config(); }
-				else if( strcasecmp( tok, "weighting" ) == 0 )	{ dp_print_weighting(); }
-				else if( strcasecmp( tok, "solution" ) == 0 )	{ dp_print_solution(); }
+				if( strcasecmp( tok, "units" ) == 0 )			{ turbine_list( pDP ); }
+				else if( strcasecmp( tok, "weights" ) == 0 )	{ dp_assign_weights( pDP ); dp_print_weights( pDP ); }
+				else if( strcasecmp( tok, "allcurves" ) == 0 )	{ curve_list( pDP, 0 ); }
+				else if( strcasecmp( tok, "curves" ) == 0 )		{ curve_list( pDP, 1 ); }
+				else if( strcasecmp( tok, "config" ) == 0 )		{ dp_print_config( pDP ); }
+				else if( strcasecmp( tok, "weighting" ) == 0 )	{ dp_print_weighting( pDP ); }
+				else if( strcasecmp( tok, "solution" ) == 0 )	{ dp_print_solution( pDP ); }
+				else if( strcasecmp( tok, "conditions" ) == 0 )	{ dp_report_conditions( pDP, 0 ); }
 				else { goto parseerror; }
 			}
 			else if( strcasecmp( tok, "echo" ) == 0 )
@@ -3916,12 +6269,27 @@ void parse_program( CHAR* szProblem )
 			/* simple commands */
 
 			else if( strcasecmp( tok, "delimiter" ) == 0 )		{ gcOutputDelimiter = ( tok = strtok( 0, " " ) ) ? *tok : ' ';
-			} else if( strcasecmp( tok, "unitsteps" ) == 0 )	{ tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } guUserStepCount = (UINT32)atoi( tok );
+			} else if( strcasecmp( tok, "unitsteps" ) == 0 )	{ tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } pDP->uUserStepCount = (UINT32)atoi( tok );
 			} else if( strcasecmp( tok, "transpose" ) == 0 )	{ tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } guTransposeSolution = (UINT32)atoi( tok );
-			} else if( strcasecmp( tok, "debug" ) == 0 )		{ tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } guDebugMode = (UINT32)atoi( tok );
+			} else if( strcasecmp( tok, "simd" ) == 0 )			{ tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } dp_set_simd( pDP, (UINT32)atoi( tok ) );
+			} else if( strcasecmp( tok, "budget" ) == 0 )		{ tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; }
+				if( strcasecmp( tok, "memory" ) == 0 )		{ tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } dp_set_budget_memory( pDP, (UINT32)atoi( tok ) ); }
+				else if( strcasecmp( tok, "time" ) == 0 )	{ tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } dp_set_budget_time( pDP, (UINT32)atoi( tok ) ); }
+				else { goto parseerror; }
+			} else if( strcasecmp( tok, "forwardpass" ) == 0 )	{ tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; }
+				if( strcasecmp( tok, "greedy" ) == 0 )		{ dp_set_forwardpass( pDP, DP_FORWARDPASS_GREEDY ); }
+				else if( strcasecmp( tok, "walk" ) == 0 )	{ dp_set_forwardpass( pDP, DP_FORWARDPASS_WALK ); }
+				else { goto parseerror; }
+			} else if( strcasecmp( tok, "engine" ) == 0 )		{ tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; }
+				if( strcasecmp( tok, "backpass" ) == 0 )		{ dp_set_engine( pDP, DP_ENGINE_BACKPASS ); }
+				else if( strcasecmp( tok, "grouped" ) == 0 )	{ dp_set_engine( pDP, DP_ENGINE_GROUPED ); }
+				else if( strcasecmp( tok, "tree" ) == 0 )		{ dp_set_engine( pDP, DP_ENGINE_TREE ); }
+				else { goto parseerror; }
+			} else if( strcasecmp( tok, "threads" ) == 0 )		{ tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } dp_set_threads( pDP, (UINT32)atoi( tok ) );
+			} else if( strcasecmp( tok, "debug" ) == 0 )		{ tok = strtok( 0, " " ); if( tok == 0 ) { goto parseerror; } pDP->uDebugMode = (UINT32)atoi( tok );
 			} else if( strcasecmp( tok, "help" ) == 0 )			{ fprintf( stdout, VERSIONED_NAME "\n" ); fprintf( stdout, gszCommandHelp );
 			} else if( strcasecmp( tok, "end" ) == 0 )			{ giInteractiveMode = 0; break;
-			} else if( strcasecmp( tok, "mem" ) == 0 )			{ fprintf( stdout, "%lu bytes allocated\n", guMALLOC );
+			} else if( strcasecmp( tok, "mem" ) == 0 )			{ fprintf( stdout, "%lu bytes allocated\n", pDP->uMALLOC );
 			} else
 			{
 				if( tok[ strlen(tok) ] != ':' ) { ; /* skip label */ }
@@ -3939,7 +6307,7 @@ parseerror:
 		sprintf( gcPrintBuff, "%s:%d (" VERSIONED_NAME  ") Parse error: missing parameter.\n", __FILE__, __LINE__ );
 		PRINT_STDERR( gcPrintBuff );
 	}
-	dp_cleanup_fatal();
+	dp_cleanup_fatal( pDP );
   }	
 }
 
@@ -3965,7 +6333,7 @@ EXTERNC void stdout_redirect( char* szOutfile )
 		{
 			sprintf( gcPrintBuff, "%s:%d (" VERSIONED_NAME  ") Unable to open file '%s'.\n", __FILE__, __LINE__, gszRedirectionFilename );
 			PRINT_STDERR( gcPrintBuff );
-			dp_cleanup_fatal();
+			dp_cleanup_fatal( 0 );
 			exit(-1);
 		}
 
@@ -4001,7 +6369,7 @@ EXTERNC void stdout_redirect( char* szOutfile )
 	if( strlen( gszRedirectionFilename ) != 0 ) {
 		gRedirectionHANDLE = dup( fileno( stdout ) );
 		gRedirectionFILE = fopen( gszRedirectionFilename, "w" );
-		if( !gRedirectionFILE ) { fprintf( stderr, "%s:%d (" VERSIONED_NAME  ") Unable to open file '%s'.\n", __FILE__, __LINE__, gszRedirectionFilename ); dp_cleanup_fatal(); exit(-1); }
+		if( !gRedirectionFILE ) { fprintf( stderr, "%s:%d (" VERSIONED_NAME  ") Unable to open file '%s'.\n", __FILE__, __LINE__, gszRedirectionFilename ); dp_cleanup_fatal( 0 ); exit(-1); }
 		dup2( fileno( gRedirectionFILE ), fileno( stdout ) );
  	}
 }
@@ -4020,16 +6388,16 @@ EXTERNC void stdout_unredirect()
 
 /*********************************************/
 
-void code_sample()
+void code_sample( DPContext* pDP )
 {
-	turbine_register( "u2", "Crossflow",      65 /*ft*/,  1400 /*cfs*/, 1700 /*kw*/ );
-	turbine_register( "u3", "Francis",        55 /*ft*/,  730 /*cfs*/, 1500 /*kw*/ );
-	turbine_register( "u4", "Kaplan",         50 /*ft*/,  1000 /*cfs*/, 1500 /*kw*/ );
-	turbine_register( "u1", "FixedPropeller", 68 /*ft*/,  1250 /*cfs*/, 1250 /*kw*/ );
-	guSolveMode = DP_OPTIMIZE_FOR_POWER;
-	gfHeadCurr = 68;
-	gfStateMin = gfStateMax = 0;
-	guProblemStepCount = 5;
+	turbine_register( pDP, "u2", "Crossflow",      65 /*ft*/,  1400 /*cfs*/, 1700 /*kw*/ );
+	turbine_register( pDP, "u3", "Francis",        55 /*ft*/,  730 /*cfs*/, 1500 /*kw*/ );
+	turbine_register( pDP, "u4", "Kaplan",         50 /*ft*/,  1000 /*cfs*/, 1500 /*kw*/ );
+	turbine_register( pDP, "u1", "FixedPropeller", 68 /*ft*/,  1250 /*cfs*/, 1250 /*kw*/ );
+	pDP->uSolveMode = DP_OPTIMIZE_FOR_POWER;
+	pDP->fHeadCurr = 68;
+	pDP->fStateMin = pDP->fStateMax = 0;
+	pDP->uProblemStepCount = 5;
 }
 
 CHAR* gszWritableMemory = 0;
@@ -4060,12 +6428,14 @@ print solution\n\
 ";
 
 UINT32 guTestLevel = 0;
+UINT32 guThreadCount = 0;
+UINT32 guDebugMode = 0; /* -D, copied into the context */
 CHAR* gszInfile = 0;
 CHAR* gszOutfile = 0;
 
 void commandline_help()
 {
-	printf( "ohdp [ -h ] [ -I ] [ -T ] [ -O int ] [ -t int ] [ -d char ] [ -o outfilename ] [ -i infilename ]\n" );
+	printf( "ohdp [ -h ] [ -I ] [ -T ] [ -O int ] [ -t int ] [ -j int ] [ -d char ] [ -o outfilename ] [ -i infilename ]\n" );
 	printf( "-h             this help\n" );
 	printf( "-I             interactive mode\n" );
 	printf( "-T             transpose all output to vertical tables (ie. for spreadsheet programs)\n" );
@@ -4074,6 +6444,7 @@ void commandline_help()
 	printf( "-t int         test level (1, 2)\n" );
 	printf( "                 1 API test mode\n" );
 	printf( "                 2 Input file test mode\n" );
+	printf( "-j int         number of threads used to solve (default 1)\n" );
 	printf( "-d char        set output delimiter to single character 'char'\n" );
 	printf( "-o outputfile  new file to put output of run\n" );
 	printf( "-i inputfile   existing input file\n" );
@@ -4084,6 +6455,8 @@ void commandline_help()
 
 int CDECLCALL main(int argc, char** argv)
 {
+	DPContext* pDP = 0;
+
 	/* parse commandline */
 	{
 		int i = 1;
@@ -4094,6 +6467,7 @@ int CDECLCALL main(int argc, char** argv)
 			else if( *(argv[i] + 1) == 'T' ) { guTransposeSolution = 1; }
 			else if( *(argv[i] + 1) == 'S' ) { gpSymbolList[ guSymbolCount++ ] = argv[++i]; }
 			else if( *(argv[i] + 1) == 't' ) { guTestLevel = (UINT32)atoi( argv[++i] ); }
+			else if( *(argv[i] + 1) == 'j' ) { guThreadCount = (UINT32)atoi( argv[++i] ); }
 			else if( *(argv[i] + 1) == 'D' ) { guDebugMode = 1; }
 			else if( *(argv[i] + 1) == 'd' ) { gcOutputDelimiter = *(argv[++i]); }
 			else /* if( *(argv[i] + 1) == 'h' ) */ { commandline_help(); }
@@ -4112,21 +6486,25 @@ int CDECLCALL main(int argc, char** argv)
 	if( _set_SSE2_enable(1) ) { PRINT_STDOUT( "SSE2 intrinsics enabled.\n" ); }
 #endif
 
-	curve_register_builtins();
+	pDP = dp_context_alloc();
+	if( !pDP ) { exit(-1); }
+	dp_set_threads( pDP, guThreadCount );
+	pDP->uDebugMode = guDebugMode;
+	curve_register_builtins( pDP );
 
 	if( guTestLevel > 0 )
 	{
-		curve_test();
-		turbine_test();
+		curve_test( pDP );
+		turbine_test( pDP );
 		if( guTestLevel == 1 )
 		{
-			code_sample();
+			code_sample( pDP );
 		}
 		else if( guTestLevel == 2 )
 		{
 			DP_MALLOC( gszWritableMemory, CHAR, strlen( gszSample2 ) + 1, __FILE__, __LINE__ ); parse_addblock( gszWritableMemory );
 			strcpy( gszWritableMemory, gszSample2 );
-			parse_program( gszWritableMemory );
+			parse_program( pDP, gszWritableMemory );
 		}
 	}
 	else if( gszInfile )
@@ -4137,7 +6515,7 @@ int CDECLCALL main(int argc, char** argv)
 		{
 			sprintf( gcPrintBuff, "%s:%d (" VERSIONED_NAME  ") Unable to open file '%s'.\n", __FILE__, __LINE__, gszInfile );
 			PRINT_STDERR( gcPrintBuff );
-			dp_cleanup();
+			dp_cleanup( pDP );
 			exit(-1);
 		}
 		fseek( pFile, 0, SEEK_END );
@@ -4146,7 +6524,7 @@ int CDECLCALL main(int argc, char** argv)
 		DP_MALLOC( gszWritableMemory, CHAR, iSize + 1, __FILE__, __LINE__ ); parse_addblock( gszWritableMemory );
 		fread( gszWritableMemory, 1, iSize, pFile );
 		fclose( pFile );
-		parse_program( gszWritableMemory );
+		parse_program( pDP, gszWritableMemory );
 	}
 	else if( giInteractiveMode )
 	{
@@ -4156,14 +6534,12 @@ int CDECLCALL main(int argc, char** argv)
 		{
 			fprintf( stdout, "> " );
 			fgets( gszWritableMemory, INTERACTIVE_BUFFER_SIZE - 1, stdin );
-			parse_program( gszWritableMemory );
+			parse_program( pDP, gszWritableMemory );
 		}
 	}
 
 	/* ensure cleanup */
-	ud_cleanup();
-	op_cleanup();
-	dp_malloc_control( 2 );
+	dp_context_free( pDP );
 	parse_freeallblocks();
 
 	if( gszOutfile ) { stdout_unredirect(); }
@@ -24,66 +24,82 @@
 
 char* dp_gsVERSION;
 
-UINT32 guUserStepCount;
-UINT32 guProblemStepCount;
-DP_FLOAT_TYPE gfConvFactor;
-UINT32 guSolveMode;
-UINT32 guWeightCode;
-DP_FLOAT_TYPE gfHeadCurr;
-UINT32 guStates;
-UINT32 guStages;
+/* opaque solver state. one context per plant model. */
+typedef struct tagDPContext DPContext;
+
+#define DP_RESULT_SOLUTIONALLOCATIONS		(0) /* [ states ] */
+#define DP_RESULT_OTHERSOLUTIONALLOCATIONS	(1) /* [ states ] */
+#define DP_RESULT_HKSOLUTIONAVERAGES		(2) /* [ states ] */
+#define DP_RESULT_SOLUTION					(3) /* [ stages, states ] */
+#define DP_RESULT_OTHERSOLUTION				(4) /* [ stages, states ] */
+#define DP_RESULT_HKSOLUTION				(5) /* [ stages, states ] */
+#define DP_RESULT_UDSOLUTION				(6) /* [ stages ] */
+#define DP_RESULT_UDOTHERSOLUTION			(7) /* [ stages ] */
+#define DP_RESULT_UDHKSOLUTION				(8) /* [ stages ] */
+#define DP_RESULT_OPCOEFM					(9) /* [ opoints ] */
+#define DP_RESULT_OPCOEFB					(10) /* [ opoints ] */
+#define DP_RESULT_OUTAGEHK					(11) /* [ stages, states ] plant H/K with each unit out, see dp_set_outage_scan */
+#define DP_RESULT_OUTAGESOLUTION			(12) /* [ stages, stages, states ] the solution with each unit out, see dp_set_outage_scan */
+
+DPContext* dp_context_alloc( void );
+void dp_context_free( DPContext* pDP );
+
+void dp_set_solvemode( DPContext* pDP, UINT32 uSolveMode );
+void dp_set_head( DPContext* pDP, DP_FLOAT_TYPE fHead );
+void dp_set_unitsteps( DPContext* pDP, UINT32 uSteps );
+void dp_set_convfactor( DPContext* pDP, DP_FLOAT_TYPE fConvFactor );
+void dp_set_threads( DPContext* pDP, UINT32 uThreads ); /* 0 or 1 = solve on the calling thread */
+void dp_set_simd( DPContext* pDP, UINT32 uSimd ); /* 0=scalar, 1=sse2, 2=avx2, capped by the cpu */
+void dp_set_forwardpass( DPContext* pDP, UINT32 uForwardpass ); /* 0=greedy rescan, 1=walk the backpass decisions (default) */
+void dp_set_outage_scan( DPContext* pDP, UINT32 uOutageScan ); /* 1 = also build DP_RESULT_OUTAGEHK and DP_RESULT_OUTAGESOLUTION on each solve, merged whatever the engine, so not the same as a solve with the unit at weight 0 */
+void dp_set_engine( DPContext* pDP, UINT32 uEngine ); /* 0=backpass, 1=merge identical units first, 2=pairwise tree */
+void dp_set_refine( DPContext* pDP, UINT32 uFactor ); /* >1 = coarse pass at 1/uFactor of the unitsteps, then a banded fine pass */
+void dp_set_prune( DPContext* pDP, UINT32 uPrune ); /* 1 = skip backpass decisions below the near-optimum above a unit's maximum */
+void dp_set_band( DPContext* pDP, DP_FLOAT_TYPE fMin, DP_FLOAT_TYPE fMax ); /* plant loads to solve, in solvemode units, 0 = open */
+void dp_set_budget_memory( DPContext* pDP, UINT32 uMB ); /* 0 = no limit on the solver workspace */
+void dp_set_budget_time( DPContext* pDP, UINT32 uMs ); /* 0 = no limit on the predicted solve time */
+UINT32 dp_get_states( DPContext* pDP );
+UINT32 dp_get_first_state( DPContext* pDP ); /* first state of the band, the ones below are 0 */
+UINT32 dp_get_stages( DPContext* pDP );
+DP_FLOAT_TYPE* dp_get_result( DPContext* pDP, UINT32 uResult );
 
 void stdout_redirect( char* szOutfile );
 void stdout_unredirect( void );
 
-void curve_register_builtins( void );
-UINT32 curve_register_n( UINT32 np, DP_FLOAT_TYPE* pCap, DP_FLOAT_TYPE* pPow, DP_FLOAT_TYPE* pEff );
-UINT32 turbine_register_n( UINT32 uType, DP_FLOAT_TYPE h, DP_FLOAT_TYPE q, DP_FLOAT_TYPE p );
-void turbine_weight( UINT32 uTurbine, DP_FLOAT_TYPE fWeight );
-void turbine_headloss( UINT32 uTurbine, DP_FLOAT_TYPE fLossCoef );
-void turbine_geneff( UINT32 uTurbine, DP_FLOAT_TYPE fGeneff );
-void turbine_gencap( UINT32 uTurbine, DP_FLOAT_TYPE fGenCapacity );
-void turbine_gencurve( UINT32 uTurbine, UINT32 uGenCurveNum );
+void curve_register_builtins( DPContext* pDP );
+UINT32 curve_register_n( DPContext* pDP, UINT32 np, DP_FLOAT_TYPE* pCap, DP_FLOAT_TYPE* pPow, DP_FLOAT_TYPE* pEff );
+UINT32 turbine_register_n( DPContext* pDP, UINT32 uType, DP_FLOAT_TYPE h, DP_FLOAT_TYPE q, DP_FLOAT_TYPE p );
+void turbine_weight( DPContext* pDP, UINT32 uTurbine, DP_FLOAT_TYPE fWeight );
+void turbine_headloss( DPContext* pDP, UINT32 uTurbine, DP_FLOAT_TYPE fLossCoef );
+void turbine_geneff( DPContext* pDP, UINT32 uTurbine, DP_FLOAT_TYPE fGeneff );
+void turbine_gencap( DPContext* pDP, UINT32 uTurbine, DP_FLOAT_TYPE fGenCapacity );
+void turbine_gencurve( DPContext* pDP, UINT32 uTurbine, UINT32 uGenCurveNum );
 
-void dp_malloc_control( UINT32 uControl ); /* 0=cache off, 1=cache on, 2=cache flush */
-void dp_malloc( void );
-void dp_cleanup( void );
+void dp_malloc_control( DPContext* pDP, UINT32 uControl ); /* 0=cache off, 1=cache on, 2=cache flush */
+void dp_malloc( DPContext* pDP );
+void dp_cleanup( DPContext* pDP );
 
-void dp_assign_weights( void );
-void dp_resize( void );
-void dp( void );
+void dp_assign_weights( DPContext* pDP );
+void dp_resize( DPContext* pDP );
+void dp( DPContext* pDP );
 
-void curve_cleanup( void );
-void turbine_cleanup( void );
-
-DP_FLOAT_TYPE* gpfSolutionAllocations;
-DP_FLOAT_TYPE* gpfOtherSolutionAllocations;
-DP_FLOAT_TYPE* gpfHKSolutionAverages;
-
-DP_FLOAT_TYPE* gpfSolution;
-DP_FLOAT_TYPE* gpfOtherSolution;
-DP_FLOAT_TYPE* gpfHKSolution;
+void curve_cleanup( DPContext* pDP );
+void turbine_cleanup( DPContext* pDP );
 
 /***************/
 
-UINT32 guOPoints;
-DP_FLOAT_TYPE* gpfOPCoefM;
-DP_FLOAT_TYPE* gpfOPCoefB;
-void op_set_operating_capacities( UINT32 u, DP_FLOAT_TYPE* pCap );
-void op_set_dependent( DP_FLOAT_TYPE fDep );
-void op_regress( void );
-void op_cleanup( void );
+UINT32 op_get_points( DPContext* pDP );
+void op_set_operating_capacities( DPContext* pDP, UINT32 u, DP_FLOAT_TYPE* pCap );
+void op_set_dependent( DPContext* pDP, DP_FLOAT_TYPE fDep );
+void op_regress( DPContext* pDP );
+void op_cleanup( DPContext* pDP );
 
 /***************/
 
-DP_FLOAT_TYPE gfDispatch;
-DP_FLOAT_TYPE* gpfUDSolution;
-DP_FLOAT_TYPE* gpfUDOtherSolution;
-DP_FLOAT_TYPE* gpfUDHKSolution;
-
-void ud_malloc( void );
-void ud_cleanup( void );
-void ud_dispatch( void );
+void ud_set_dispatch( DPContext* pDP, DP_FLOAT_TYPE fDispatch );
+void ud_malloc( DPContext* pDP );
+void ud_cleanup( DPContext* pDP );
+void ud_dispatch( DPContext* pDP );
 
 /***************/
 
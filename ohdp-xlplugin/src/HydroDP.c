@@ -201,6 +201,7 @@ static LPSTR rgFuncs[] = {
 HANDLE g_hInst = NULL;
 char* gszInfo = 0;
 DP_FLOAT_TYPE* gpCurveData = 0;
+DPContext* gpDP = 0;
 
 /*******************************************************************/
 
@@ -488,10 +489,10 @@ void* dll_cache_free( void* _pData, int _iFlush )
 
 void DllCleanup( UINT32 uCode )
 {
-	if( uCode & CLEANUP_UD ) { ud_cleanup(); }
-	if( uCode & CLEANUP_OP ) { op_cleanup(); }
-	if( uCode & CLEANUP_CURVE ) { curve_cleanup(); }
-	if( uCode & CLEANUP_TURBINE ) { turbine_cleanup(); }
+	if( uCode & CLEANUP_UD ) { ud_cleanup( gpDP ); }
+	if( uCode & CLEANUP_OP ) { op_cleanup( gpDP ); }
+	if( uCode & CLEANUP_CURVE ) { curve_cleanup( gpDP ); }
+	if( uCode & CLEANUP_TURBINE ) { turbine_cleanup( gpDP ); }
 	if( uCode & CLEANUP_DLL ) { dll_freeallblocks(); }
 }
 
@@ -504,7 +505,9 @@ BOOL WINAPI DllMain(HANDLE hInstance, ULONG dwReason, LPVOID lpReserved)
 		//
 		CriticalSection( 0 );
 		g_hInst = hInstance;
-		dp_malloc_control( 1 );
+		if( !gpDP ) { gpDP = dp_context_alloc(); }
+		if( !gpDP ) { return FALSE; }
+		dp_malloc_control( gpDP, 1 );
 		//
 		if( !gszInfo )
 		{
@@ -517,8 +520,10 @@ BOOL WINAPI DllMain(HANDLE hInstance, ULONG dwReason, LPVOID lpReserved)
 		break;
 	case DLL_PROCESS_DETACH:
 		CriticalSection( 1 );
-		dp_malloc_control( 2 );
+		dp_malloc_control( gpDP, 2 );
 		DllCleanup( CLEANUP_ALL );
+		dp_context_free( gpDP );
+		gpDP = 0;
 		//
 		CriticalSection( 2 );
 			free( gszInfo );
@@ -644,7 +649,7 @@ DLLEXPORT int WINAPI xlAutoAdd(void)
 	interpret_xlret( xlret );
 	xloper_free( &xlStr );
 #endif
-	curve_register_builtins();
+	curve_register_builtins( gpDP );
 
 	return 1;
 }
@@ -759,9 +764,9 @@ LPXLOPER privateParse(
 	//////////////////////////////////
 	// parse scalar args
 
-	gfConvFactor = (DP_FLOAT_TYPE)DP_CONV_IMPERIAL;
-	gfHeadCurr = (DP_FLOAT_TYPE)fHead;
-	guUserStepCount = uSteps;
+	dp_set_convfactor( gpDP, (DP_FLOAT_TYPE)DP_CONV_IMPERIAL );
+	dp_set_head( gpDP, (DP_FLOAT_TYPE)fHead );
+	dp_set_unitsteps( gpDP, uSteps );
 
 	if( !xloper_ismissing( pxOptionalUnits ) )
 	{
@@ -774,7 +779,7 @@ LPXLOPER privateParse(
 		interpret_xlret( xlret );
 		if( xBoolVal.val.bool )
 		{
-			gfConvFactor = (DP_FLOAT_TYPE)DP_CONV_METRIC;
+			dp_set_convfactor( gpDP, (DP_FLOAT_TYPE)DP_CONV_METRIC );
 		}
 	}
 
@@ -818,8 +823,7 @@ LPXLOPER privateParse(
 			}
 
 			// throw curve data at dp
-			curve_register_n(
-				uPoints,
+			curve_register_n( gpDP, uPoints,
 				&(gpCurveData[ (2 * uCurve + 0) * uMaxPoints ]),
 				&(gpCurveData[ (2 * uCurve + 0) * uMaxPoints ]),
 				&(gpCurveData[ (2 * uCurve + 1) * uMaxPoints ]) /* peff */
@@ -843,23 +847,22 @@ LPXLOPER privateParse(
 			UINT32 uCurveNumber = (UINT32)(pfpUnits->array[ uUnit * uCols + 0 ]);
 			if( uCurveNumber > uCurves ) { goto cleanup_and_exit; } // too many curves
 			{
-				UINT32 uUnitNumber = turbine_register_n(
-					uCurveNumber - 1, // zero based
+				UINT32 uUnitNumber = turbine_register_n( gpDP, uCurveNumber - 1, // zero based
 					(DP_FLOAT_TYPE)pfpUnits->array[ uUnit * uCols + 1 ],
 					(DP_FLOAT_TYPE)pfpUnits->array[ uUnit * uCols + 2 ],
 					(DP_FLOAT_TYPE)pfpUnits->array[ uUnit * uCols + 3 ]
 				);
 
 				/* non-optional arg: optional columns */
-				if( uCols > 4 ) { turbine_headloss( uUnitNumber, (DP_FLOAT_TYPE)pfpUnits->array[ uUnit * uCols + 4 ] ); }
-				if( uCols > 5 ) { turbine_geneff( uUnitNumber, (DP_FLOAT_TYPE)pfpUnits->array[ uUnit * uCols + 5 ] ); }
-				if( uCols > 6 ) { turbine_gencap( uUnitNumber, (DP_FLOAT_TYPE)pfpUnits->array[ uUnit * uCols + 6 ] ); }
+				if( uCols > 4 ) { turbine_headloss( gpDP, uUnitNumber, (DP_FLOAT_TYPE)pfpUnits->array[ uUnit * uCols + 4 ] ); }
+				if( uCols > 5 ) { turbine_geneff( gpDP, uUnitNumber, (DP_FLOAT_TYPE)pfpUnits->array[ uUnit * uCols + 5 ] ); }
+				if( uCols > 6 ) { turbine_gencap( gpDP, uUnitNumber, (DP_FLOAT_TYPE)pfpUnits->array[ uUnit * uCols + 6 ] ); }
 
 				/* optional args */
 				if( !xloper_ismissing( pxOptionalWeights ) )
 				{
 					LPXLOPER pxWeights = pxOptionalWeights->val.array.lparray;
-					turbine_weight( uUnitNumber, (DP_FLOAT_TYPE)pxWeights[ uUnit ].val.num );
+					turbine_weight( gpDP, uUnitNumber, (DP_FLOAT_TYPE)pxWeights[ uUnit ].val.num );
 				}
 			}
 		}
@@ -935,9 +938,9 @@ LPXLOPER privateParse2(
 	//////////////////////////////////
 	// parse scalar args
 
-	gfConvFactor = (DP_FLOAT_TYPE)DP_CONV_IMPERIAL;
-	gfHeadCurr = (DP_FLOAT_TYPE)fHead;
-	guUserStepCount = uSteps;
+	dp_set_convfactor( gpDP, (DP_FLOAT_TYPE)DP_CONV_IMPERIAL );
+	dp_set_head( gpDP, (DP_FLOAT_TYPE)fHead );
+	dp_set_unitsteps( gpDP, uSteps );
 
 	if( !xloper_ismissing( pxOptionalUnits ) )
 	{
@@ -951,7 +954,7 @@ LPXLOPER privateParse2(
 		interpret_xlret( xlret );
 		if( xBoolVal.val.bool )
 		{
-			gfConvFactor = (DP_FLOAT_TYPE)DP_CONV_METRIC;
+			dp_set_convfactor( gpDP, (DP_FLOAT_TYPE)DP_CONV_METRIC );
 		}
 	}
 
@@ -995,8 +998,7 @@ LPXLOPER privateParse2(
 			}
 
 			// throw curve data at dp
-			curve_register_n(
-				uPoints,
+			curve_register_n( gpDP, uPoints,
 				&(gpCurveData[ (2 * uCurve + 0) * uMaxPoints ]),
 				&(gpCurveData[ (2 * uCurve + 0) * uMaxPoints ]),
 				&(gpCurveData[ (2 * uCurve + 1) * uMaxPoints ]) /* peff */
@@ -1020,33 +1022,32 @@ LPXLOPER privateParse2(
 			UINT32 uCurveNumber = (UINT32)(pfpUnits->array[ uUnit * uCols + 0 ]);
 			if( uCurveNumber > uCurves ) { goto cleanup_and_exit; } // too many curves
 			{
-				UINT32 uUnitNumber = turbine_register_n(
-					uCurveNumber - 1, // zero based
+				UINT32 uUnitNumber = turbine_register_n( gpDP, uCurveNumber - 1, // zero based
 					(DP_FLOAT_TYPE)pfpUnits->array[ uUnit * uCols + 1 ],
 					(DP_FLOAT_TYPE)pfpUnits->array[ uUnit * uCols + 2 ],
 					(DP_FLOAT_TYPE)pfpUnits->array[ uUnit * uCols + 3 ]
 				);
 
 				/* non-optional arg: optional columns */
-				if( uCols > 4 ) { turbine_headloss( uUnitNumber, (DP_FLOAT_TYPE)pfpUnits->array[ uUnit * uCols + 4 ] ); }
+				if( uCols > 4 ) { turbine_headloss( gpDP, uUnitNumber, (DP_FLOAT_TYPE)pfpUnits->array[ uUnit * uCols + 4 ] ); }
 				if( uCols > 5 )
 				{
 					UINT32 uGenCurve = (UINT32)pfpUnits->array[ uUnit * uCols + 5 ];
 					if( uGenCurve > uCurves ) { goto cleanup_and_exit; } // too many curves
-					turbine_gencurve( uUnitNumber, uGenCurve - 1 ); /* zero based */
+					turbine_gencurve( gpDP, uUnitNumber, uGenCurve - 1 ); /* zero based */
 				}
-				if( uCols > 6 ) { turbine_gencap( uUnitNumber, (DP_FLOAT_TYPE)pfpUnits->array[ uUnit * uCols + 6 ] ); }
+				if( uCols > 6 ) { turbine_gencap( gpDP, uUnitNumber, (DP_FLOAT_TYPE)pfpUnits->array[ uUnit * uCols + 6 ] ); }
 
 				/* optional args */
 				if( !xloper_ismissing( pxOptionalWeights ) )
 				{
 					LPXLOPER pxWeights = pxOptionalWeights->val.array.lparray;
-					turbine_weight( uUnitNumber, (DP_FLOAT_TYPE)pxWeights[ uUnit ].val.num );
+					turbine_weight( gpDP, uUnitNumber, (DP_FLOAT_TYPE)pxWeights[ uUnit ].val.num );
 				}
 				if( !xloper_ismissing( pxOptionalGenCaps ) )
 				{
 					LPXLOPER pxGenCaps = pxOptionalGenCaps->val.array.lparray;
-					turbine_gencap( uUnitNumber, (DP_FLOAT_TYPE)pxGenCaps[ uUnit ].val.num );
+					turbine_gencap( gpDP, uUnitNumber, (DP_FLOAT_TYPE)pxGenCaps[ uUnit ].val.num );
 				}
 			}
 		}
@@ -1067,16 +1068,16 @@ LPXLOPER privateSolve()
 	// run
 
 	ex_clear();
-	dp_cleanup();
+	dp_cleanup( gpDP );
 	if( ex_didFail() ) { goto cleanup_and_exit; }
-	dp_assign_weights();
+	dp_assign_weights( gpDP );
 	if( ex_didFail() ) { goto cleanup_and_exit; }
-	dp_resize();
-	if( guStates > MAX_EXCEL_ROWS ) { goto cleanup_and_exit; }
+	dp_resize( gpDP );
+	if( dp_get_states( gpDP ) > MAX_EXCEL_ROWS ) { goto cleanup_and_exit; }
 	if( ex_didFail() ) { goto cleanup_and_exit; }
-	dp_malloc();
+	dp_malloc( gpDP );
 	if( ex_didFail() ) { goto cleanup_and_exit; }
-	dp();
+	dp( gpDP );
 	if( ex_didFail() ) { goto cleanup_and_exit; }
 
 	return 0;
@@ -1100,11 +1101,11 @@ LPXLOPER privatePackageAllResults()
 
 		// 3 blocks: solution, other solution and H/K solution
 		uBlock0 = 0;
-		uBlock1 = (UINT16)guStages + 1; // +1 for summary column
+		uBlock1 = (UINT16)dp_get_stages( gpDP ) + 1; // +1 for summary column
 		uBlock2 = uBlock1 * 2;
 		uCols = uBlock1 * 3;
 
-		uStates = (unsigned short)guStates;
+		uStates = (unsigned short)dp_get_states( gpDP );
 		uCells = uCols * uStates; // use UINT32 to handle wraparound
 
 		pxReturn = xloper_malloc_array( 1 + uCells ); // + 1 for root
@@ -1115,11 +1116,11 @@ LPXLOPER privatePackageAllResults()
 			UINT16 uStage, uState;
 			for( uState = 0; uState < uStates; uState++ )
 			{
-				xloper_num( &(pxReturnData[ uState * uCols + uBlock0 ]), (XL_FLOAT_TYPE) gpfSolutionAllocations[ uState ] );
-				xloper_num( &(pxReturnData[ uState * uCols + uBlock1 ]), (XL_FLOAT_TYPE) gpfOtherSolutionAllocations[ uState ] );
-				xloper_num( &(pxReturnData[ uState * uCols + uBlock2 ]), (XL_FLOAT_TYPE) gpfHKSolutionAverages[ uState ] );
+				xloper_num( &(pxReturnData[ uState * uCols + uBlock0 ]), (XL_FLOAT_TYPE) dp_get_result( gpDP, DP_RESULT_SOLUTIONALLOCATIONS )[ uState ] );
+				xloper_num( &(pxReturnData[ uState * uCols + uBlock1 ]), (XL_FLOAT_TYPE) dp_get_result( gpDP, DP_RESULT_OTHERSOLUTIONALLOCATIONS )[ uState ] );
+				xloper_num( &(pxReturnData[ uState * uCols + uBlock2 ]), (XL_FLOAT_TYPE) dp_get_result( gpDP, DP_RESULT_HKSOLUTIONAVERAGES )[ uState ] );
 
-				for( uStage = 0; uStage < guStages; uStage++ )
+				for( uStage = 0; uStage < dp_get_stages( gpDP ); uStage++ )
 				{
 					UINT32 uSRC, uDST;
 
@@ -1127,9 +1128,9 @@ LPXLOPER privatePackageAllResults()
 					uSRC = uStage * uStates + uState; // column major
 
 					// allways add + 1 for the block summary column
-					xloper_num( &(pxReturnData[ uDST + (uBlock0 + 1) ]), (XL_FLOAT_TYPE) gpfSolution[ uSRC ] );
-					xloper_num( &(pxReturnData[ uDST + (uBlock1 + 1) ]), (XL_FLOAT_TYPE) gpfOtherSolution[ uSRC ] );
-					xloper_num( &(pxReturnData[ uDST + (uBlock2 + 1) ]), (XL_FLOAT_TYPE) gpfHKSolution[ uSRC ] );
+					xloper_num( &(pxReturnData[ uDST + (uBlock0 + 1) ]), (XL_FLOAT_TYPE) dp_get_result( gpDP, DP_RESULT_SOLUTION )[ uSRC ] );
+					xloper_num( &(pxReturnData[ uDST + (uBlock1 + 1) ]), (XL_FLOAT_TYPE) dp_get_result( gpDP, DP_RESULT_OTHERSOLUTION )[ uSRC ] );
+					xloper_num( &(pxReturnData[ uDST + (uBlock2 + 1) ]), (XL_FLOAT_TYPE) dp_get_result( gpDP, DP_RESULT_HKSOLUTION )[ uSRC ] );
 				}
 			}
 		}
@@ -1155,10 +1156,10 @@ LPXLOPER privatePackageHKResult(
 	//////////////////////////////////
 	// call dispatch
 
-	gfDispatch = (DP_FLOAT_TYPE) fValue;
+	ud_set_dispatch( gpDP, (DP_FLOAT_TYPE) fValue );
 
-	ud_malloc();
-	ud_dispatch();
+	ud_malloc( gpDP );
+	ud_dispatch( gpDP );
 
 	if( ex_didFail() ) { goto cleanup_and_exit; }
 
@@ -1168,10 +1169,10 @@ LPXLOPER privatePackageHKResult(
 		XL_FLOAT_TYPE fSumSoln = 0;
 		XL_FLOAT_TYPE fSumOtherSoln = 0;
 		UINT16 uStage;
-		for( uStage = 0; uStage < guStages; uStage++ )
+		for( uStage = 0; uStage < dp_get_stages( gpDP ); uStage++ )
 		{
-			fSumSoln += (XL_FLOAT_TYPE) gpfUDSolution[ uStage ];
-			fSumOtherSoln += (XL_FLOAT_TYPE) gpfUDOtherSolution[ uStage ];
+			fSumSoln += (XL_FLOAT_TYPE) dp_get_result( gpDP, DP_RESULT_UDSOLUTION )[ uStage ];
+			fSumOtherSoln += (XL_FLOAT_TYPE) dp_get_result( gpDP, DP_RESULT_UDOTHERSOLUTION )[ uStage ];
 		}
 
 		if( fSumOtherSoln <= fTol || fSumSoln <= fTol ) {
@@ -1207,10 +1208,10 @@ LPXLOPER privatePackageSpecificResult(
 	//////////////////////////////////
 	// call dispatch
 
-	gfDispatch = (DP_FLOAT_TYPE) fValue;
+	ud_set_dispatch( gpDP, (DP_FLOAT_TYPE) fValue );
 
-	ud_malloc();
-	ud_dispatch();
+	ud_malloc( gpDP );
+	ud_dispatch( gpDP );
 
 	if( ex_didFail() ) { goto cleanup_and_exit; }
 
@@ -1223,7 +1224,7 @@ LPXLOPER privatePackageSpecificResult(
 		// 3 blocks: solution, other solution and H/K solution
 		uRows = 1;
 		uBlock0 = 0;
-		uBlock1 = (UINT16)guStages + 1; // +1 for summary column
+		uBlock1 = (UINT16)dp_get_stages( gpDP ) + 1; // +1 for summary column
 		uBlock2 = uBlock1 * 2;
 		uCells = uCols = uBlock1 * 3;
 
@@ -1235,15 +1236,15 @@ LPXLOPER privatePackageSpecificResult(
 			XL_FLOAT_TYPE fSumSoln = 0;
 			XL_FLOAT_TYPE fSumOtherSoln = 0;
 			UINT16 uStage;
-			for( uStage = 0; uStage < guStages; uStage++ )
+			for( uStage = 0; uStage < dp_get_stages( gpDP ); uStage++ )
 			{
 				// allways add + 1 for the block summary column
-				xloper_num( &(pxReturnData[ uStage + (uBlock0 + 1) ]), (XL_FLOAT_TYPE) gpfUDSolution[ uStage ] );
-				xloper_num( &(pxReturnData[ uStage + (uBlock1 + 1) ]), (XL_FLOAT_TYPE) gpfUDOtherSolution[ uStage ] );
-				xloper_num( &(pxReturnData[ uStage + (uBlock2 + 1) ]), (XL_FLOAT_TYPE) gpfUDHKSolution[ uStage ] );
+				xloper_num( &(pxReturnData[ uStage + (uBlock0 + 1) ]), (XL_FLOAT_TYPE) dp_get_result( gpDP, DP_RESULT_UDSOLUTION )[ uStage ] );
+				xloper_num( &(pxReturnData[ uStage + (uBlock1 + 1) ]), (XL_FLOAT_TYPE) dp_get_result( gpDP, DP_RESULT_UDOTHERSOLUTION )[ uStage ] );
+				xloper_num( &(pxReturnData[ uStage + (uBlock2 + 1) ]), (XL_FLOAT_TYPE) dp_get_result( gpDP, DP_RESULT_UDHKSOLUTION )[ uStage ] );
 				//
-				fSumSoln += (XL_FLOAT_TYPE) gpfUDSolution[ uStage ];
-				fSumOtherSoln += (XL_FLOAT_TYPE) gpfUDOtherSolution[ uStage ];
+				fSumSoln += (XL_FLOAT_TYPE) dp_get_result( gpDP, DP_RESULT_UDSOLUTION )[ uStage ];
+				fSumOtherSoln += (XL_FLOAT_TYPE) dp_get_result( gpDP, DP_RESULT_UDOTHERSOLUTION )[ uStage ];
 			}
 
 			xloper_num( &(pxReturnData[ uBlock0 ]), (XL_FLOAT_TYPE) fSumSoln );
@@ -1273,16 +1274,16 @@ LPXLOPER privatePackageOPResult()
 	//////////////////////////////////
 	// fill return array
 
-	pxReturn = xloper_malloc_array( 1 + 2 * (UINT16)guOPoints ); // + 1 for root
-	xloper_multi( pxReturn, 1, 2 * (UINT16)guOPoints, &(pxReturn[1]) );
+	pxReturn = xloper_malloc_array( 1 + 2 * (UINT16)op_get_points( gpDP ) ); // + 1 for root
+	xloper_multi( pxReturn, 1, 2 * (UINT16)op_get_points( gpDP ), &(pxReturn[1]) );
 	pxReturnData = &(pxReturn[1]);
 
 	{
 		UINT16 u;
-		for( u = 0; u < (UINT16)guOPoints; u++ )
+		for( u = 0; u < (UINT16)op_get_points( gpDP ); u++ )
 		{
-			xloper_num( &(pxReturnData[ 2 * u + 0 ]), (XL_FLOAT_TYPE) gpfOPCoefB[ u ] );
-			xloper_num( &(pxReturnData[ 2 * u + 1 ]), (XL_FLOAT_TYPE) gpfOPCoefM[ u ] );
+			xloper_num( &(pxReturnData[ 2 * u + 0 ]), (XL_FLOAT_TYPE) dp_get_result( gpDP, DP_RESULT_OPCOEFB )[ u ] );
+			xloper_num( &(pxReturnData[ 2 * u + 1 ]), (XL_FLOAT_TYPE) dp_get_result( gpDP, DP_RESULT_OPCOEFM )[ u ] );
 		}
 	}
 
@@ -1369,7 +1370,7 @@ DLLEXPORT LPXLOPER WINAPI
 	)
 {
 	LPXLOPER pxRC;
-	guSolveMode = DP_SOLVE_POWER_USE_HK;
+	dp_set_solvemode( gpDP, DP_SOLVE_POWER_USE_HK );
 	pxRC = privateParse( pfpCurves, pfpUnits, fHead, uSteps, pxOptionalWeights, pxOptionalUnits );
 	if( !pxRC || !xloper_iserr( pxRC ) )
 	{
@@ -1395,7 +1396,7 @@ DLLEXPORT LPXLOPER WINAPI
 	)
 {
 	LPXLOPER pxRC;
-	guSolveMode = DP_SOLVE_FLOW_USE_HK;
+	dp_set_solvemode( gpDP, DP_SOLVE_FLOW_USE_HK );
 	pxRC = privateParse( pfpCurves, pfpUnits, fHead, uSteps, pxOptionalWeights, pxOptionalUnits );
 	if( !pxRC || !xloper_iserr( pxRC ) )
 	{
@@ -1422,7 +1423,7 @@ DLLEXPORT LPXLOPER WINAPI
 	)
 {
 	LPXLOPER pxRC;
-	guSolveMode = DP_SOLVE_FLOW_USE_HK;
+	dp_set_solvemode( gpDP, DP_SOLVE_FLOW_USE_HK );
 	pxRC = privateParse( pfpCurves, pfpUnits, fHead, uSteps, pxOptionalWeights, pxOptionalUnits );
 	if( !pxRC || !xloper_iserr( pxRC ) )
 	{
@@ -1450,7 +1451,7 @@ DLLEXPORT LPXLOPER WINAPI
 {
 	XLOPER xlMissing;
 	LPXLOPER pxRC;
-	guSolveMode = DP_SOLVE_FLOW_USE_HK;
+	dp_set_solvemode( gpDP, DP_SOLVE_FLOW_USE_HK );
 	xloper_init( &xlMissing );
 	xloper_missing( &xlMissing );
 	pxRC = privateParse2( pfpCurves, pfpUnits, fHead, uSteps, &xlMissing, pxOptionalWeights, pxOptionalUnits );
@@ -1480,7 +1481,7 @@ DLLEXPORT LPXLOPER WINAPI
 	)
 {
 	LPXLOPER pxRC;
-	guSolveMode = DP_SOLVE_FLOW_USE_HK;
+	dp_set_solvemode( gpDP, DP_SOLVE_FLOW_USE_HK );
 	pxRC = privateParse2( pfpCurves, pfpUnits, fHead, uSteps, pxOptionalGenCaps, pxOptionalWeights, pxOptionalUnits );
 	if( !pxRC || !xloper_iserr( pxRC ) )
 	{
@@ -1508,7 +1509,7 @@ DLLEXPORT LPXLOPER WINAPI
 {
 	XLOPER xlMissing;
 	LPXLOPER pxRC;
-	guSolveMode = DP_SOLVE_POWER_USE_HK;
+	dp_set_solvemode( gpDP, DP_SOLVE_POWER_USE_HK );
 	xloper_init( &xlMissing );
 	xloper_missing( &xlMissing );
 	pxRC = privateParse2( pfpCurves, pfpUnits, fHead, uSteps, &xlMissing, pxOptionalWeights, pxOptionalUnits );
@@ -1538,7 +1539,7 @@ DLLEXPORT LPXLOPER WINAPI
 	)
 {
 	LPXLOPER pxRC;
-	guSolveMode = DP_SOLVE_POWER_USE_HK;
+	dp_set_solvemode( gpDP, DP_SOLVE_POWER_USE_HK );
 	pxRC = privateParse2( pfpCurves, pfpUnits, fHead, uSteps, pxOptionalGenCaps, pxOptionalWeights, pxOptionalUnits );
 	if( !pxRC || !xloper_iserr( pxRC ) )
 	{
@@ -1566,7 +1567,7 @@ DLLEXPORT LPXLOPER WINAPI
 {
 	XLOPER xlMissing;
 	LPXLOPER pxRC;
-	guSolveMode = DP_SOLVE_FLOW_USE_HK;
+	dp_set_solvemode( gpDP, DP_SOLVE_FLOW_USE_HK );
 	xloper_init( &xlMissing );
 	xloper_missing( &xlMissing );
 	pxRC = privateParse2( pfpCurves, pfpUnits, fHead, uSteps, &xlMissing, pxOptionalWeights, pxOptionalUnits );
@@ -1596,7 +1597,7 @@ DLLEXPORT LPXLOPER WINAPI
 	)
 {
 	LPXLOPER pxRC;
-	guSolveMode = DP_SOLVE_FLOW_USE_HK;
+	dp_set_solvemode( gpDP, DP_SOLVE_FLOW_USE_HK );
 	pxRC = privateParse2( pfpCurves, pfpUnits, fHead, uSteps, pxOptionalGenCaps, pxOptionalWeights, pxOptionalUnits );
 	if( !pxRC || !xloper_iserr( pxRC ) )
 	{
@@ -1627,29 +1628,29 @@ DLLEXPORT LPXLOPER WINAPI
 	DP_FLOAT_TYPE fOPCaps[20];
 	UINT16 u;
 
-	guSolveMode = DP_SOLVE_FLOW_USE_HK;
+	dp_set_solvemode( gpDP, DP_SOLVE_FLOW_USE_HK );
 
 	for( u = 0; u < pfpCapacities->columns; u++ )
 	{ fOPCaps[ u ] = (DP_FLOAT_TYPE)pfpCapacities->array[ u ]; }
-	op_set_operating_capacities( pfpCapacities->columns, fOPCaps );
+	op_set_operating_capacities( gpDP, pfpCapacities->columns, fOPCaps );
 #if 0
-	op_set_dependent( (DP_FLOAT_TYPE) fHead1 );
+	op_set_dependent( gpDP, (DP_FLOAT_TYPE) fHead1 );
 	pxRC = privateParse2( pfpCurves, pfpUnits, fHead1, uSteps, xloper_missing( &xlMissing ), pxOptionalWeights, pxOptionalUnits );
 	if( !pxRC || !xloper_iserr( pxRC ) )
 	{
 		pxRC = privateSolve();
 		if( !pxRC || !xloper_iserr( pxRC ) )
 		{
-			op_regress();
+			op_regress( gpDP );
 			DllCleanup( CLEANUP_ALL & ( ~CLEANUP_OP ) );
-			op_set_dependent( (DP_FLOAT_TYPE) fHead2 );
+			op_set_dependent( gpDP, (DP_FLOAT_TYPE) fHead2 );
 			pxRC = privateParse( pfpCurves, pfpUnits, fHead2, uSteps, pxOptionalWeights, pxOptionalUnits );
 			if( !pxRC || !xloper_iserr( pxRC ) )
 			{
 				pxRC = privateSolve();
 				if( !pxRC || !xloper_iserr( pxRC ) )
 				{
-					op_regress();
+					op_regress( gpDP );
 					pxRC = privatePackageOPResult();
 				}
 			}
@@ -1666,14 +1667,14 @@ DLLEXPORT LPXLOPER WINAPI
 		{
 			XL_FLOAT_TYPE fHeadTrial = (uIter == 0)? fHead1 : fHead2;
 
-			op_set_dependent( (DP_FLOAT_TYPE) fHeadTrial );
+			op_set_dependent( gpDP, (DP_FLOAT_TYPE) fHeadTrial );
 			pxRC = privateParse2( pfpCurves, pfpUnits, fHeadTrial, uSteps, &xlMissing, pxOptionalWeights, pxOptionalUnits );
 			if( !pxRC || !xloper_iserr( pxRC ) )
 			{
 				pxRC = privateSolve();
 				if( !pxRC || !xloper_iserr( pxRC ) )
 				{
-					op_regress();
+					op_regress( gpDP );
 				} else { break; }
 			} else { break; }
 			if( uIter == 0 ) {
@@ -1705,11 +1706,11 @@ DLLEXPORT LPXLOPER WINAPI
 	DP_FLOAT_TYPE fOPCaps[20];
 	UINT16 u;
 
-	guSolveMode = DP_SOLVE_FLOW_USE_HK;
+	dp_set_solvemode( gpDP, DP_SOLVE_FLOW_USE_HK );
 
 	for( u = 0; u < pfpCapacities->columns; u++ )
 	{ fOPCaps[ u ] = (DP_FLOAT_TYPE)pfpCapacities->array[ u ]; }
-	op_set_operating_capacities( pfpCapacities->columns, fOPCaps );
+	op_set_operating_capacities( gpDP, pfpCapacities->columns, fOPCaps );
 	{
 		UINT32 uIter = 0;
 
@@ -1717,14 +1718,14 @@ DLLEXPORT LPXLOPER WINAPI
 		{
 			XL_FLOAT_TYPE fHeadTrial = (uIter == 0)? fHead1 : fHead2;
 
-			op_set_dependent( (DP_FLOAT_TYPE) fHeadTrial );
+			op_set_dependent( gpDP, (DP_FLOAT_TYPE) fHeadTrial );
 			pxRC = privateParse2( pfpCurves, pfpUnits, fHeadTrial, uSteps, pxOptionalGenCaps, pxOptionalWeights, pxOptionalUnits );
 			if( !pxRC || !xloper_iserr( pxRC ) )
 			{
 				pxRC = privateSolve();
 				if( !pxRC || !xloper_iserr( pxRC ) )
 				{
-					op_regress();
+					op_regress( gpDP );
 				} else { break; }
 			} else { break; }
 			if( uIter == 0 ) {
@@ -1754,29 +1755,29 @@ DLLEXPORT LPXLOPER WINAPI
 	DP_FLOAT_TYPE fOPCaps[20];
 	UINT16 u;
 
-	guSolveMode = DP_SOLVE_FLOW_USE_HK;
+	dp_set_solvemode( gpDP, DP_SOLVE_FLOW_USE_HK );
 
 	for( u = 0; u < pfpCapacities->columns; u++ )
 	{ fOPCaps[ u ] = (DP_FLOAT_TYPE)pfpCapacities->array[ u ]; }
-	op_set_operating_capacities( pfpCapacities->columns, fOPCaps );
+	op_set_operating_capacities( gpDP, pfpCapacities->columns, fOPCaps );
 
-	op_set_dependent( (DP_FLOAT_TYPE) fHead1 );
+	op_set_dependent( gpDP, (DP_FLOAT_TYPE) fHead1 );
 	pxRC = privateParse( pfpCurves, pfpUnits, fHead1, uSteps, pxOptionalWeights, pxOptionalUnits );
 	if( !pxRC || !xloper_iserr( pxRC ) )
 	{
 		pxRC = privateSolve();
 		if( !pxRC || !xloper_iserr( pxRC ) )
 		{
-			op_regress();
+			op_regress( gpDP );
 			DllCleanup( CLEANUP_ALL & ( ~CLEANUP_OP ) );
-			op_set_dependent( (DP_FLOAT_TYPE) fHead2 );
+			op_set_dependent( gpDP, (DP_FLOAT_TYPE) fHead2 );
 			pxRC = privateParse( pfpCurves, pfpUnits, fHead2, uSteps, pxOptionalWeights, pxOptionalUnits );
 			if( !pxRC || !xloper_iserr( pxRC ) )
 			{
 				pxRC = privateSolve();
 				if( !pxRC || !xloper_iserr( pxRC ) )
 				{
-					op_regress();
+					op_regress( gpDP );
 					pxRC = privatePackageOPResult();
 				}
 			}